@@ -0,0 +1,50 @@
+#include <batch_runner.h>
+#include <fstream>
+#include <iostream>
+
+using idealgas::BatchOptions;
+using idealgas::BatchRunner;
+
+int main(int argc, char **argv) {
+  BatchOptions options;
+  try {
+    options = idealgas::ParseBatchOptions(
+        std::vector<std::string>(argv + 1, argv + argc));
+  } catch (const std::invalid_argument &error) {
+    std::cerr << error.what() << "\n\n" << idealgas::GetBatchUsage();
+    return 2;
+  }
+  
+  try {
+    BatchRunner runner(options);
+    runner.Run();
+    
+    if (!options.particles_path.empty()) {
+      std::ofstream particles_file(options.particles_path);
+      runner.WriteParticles(particles_file);
+      if (!particles_file) {
+        std::cerr << "Could not write " << options.particles_path << "\n";
+        return 1;
+      }
+    }
+    
+    std::string statistics = runner.GetStatistics().dump(2);
+    if (options.statistics_path.empty()) {
+      std::cout << statistics << "\n";
+    } else {
+      std::ofstream statistics_file(options.statistics_path);
+      statistics_file << statistics << "\n";
+      if (!statistics_file) {
+        std::cerr << "Could not write " << options.statistics_path << "\n";
+        return 1;
+      }
+    }
+  } catch (const std::invalid_argument &error) {
+    std::cerr << error.what() << "\n";
+    return 2;
+  } catch (const std::runtime_error &error) {
+    std::cerr << error.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,313 @@
+#include <batch_runner.h>
+#include <histogram.h>
+#include <integrator.h>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+using namespace idealgas;
+
+namespace {
+
+/**
+ * A mix of the species from IdealGasApp, given as the fraction of the 
+ * particles each species gets
+ */
+struct Mix {
+  std::string name;
+  std::vector<double> fractions;
+};
+
+/**
+ * Settings that apply to the whole benchmark run
+ */
+struct BenchmarkOptions {
+  size_t max_particles = 1000000;
+  std::vector<size_t> thread_counts = {1};
+  double min_seconds = 0.5;
+  std::string output_path;
+};
+
+SpeciesOptions MakeAppSpecies(double radius, double mass, 
+                              const std::string &color) {
+  SpeciesOptions species;
+  species.radius = radius;
+  species.mass = mass;
+  species.color = color;
+  return species;
+}
+
+// The small, medium and big particles from IdealGasApp
+const std::vector<SpeciesOptions> kAppSpecies = {
+    MakeAppSpecies(8, 5, "red"), MakeAppSpecies(12, 25, "green"), 
+    MakeAppSpecies(20, 100, "blue")};
+
+const std::vector<Mix> kMixes = {
+    {"small-only", {1, 0, 0}},
+    {"equal-thirds", {1.0 / 3, 1.0 / 3, 1.0 / 3}},
+    {"mostly-small", {0.8, 0.15, 0.05}}};
+
+// The fraction of the container covered by particles
+const std::vector<double> kPackingFractions = {0.05, 0.2, 0.4};
+
+const std::vector<size_t> kParticleCounts = {100, 1000, 10000, 100000, 
+                                             1000000};
+
+const double kPi = std::acos(-1.0);
+
+// The smallest radius the simulator accepts
+constexpr double kMinRadius = 0.1;
+
+// Stops a benchmark after this many steps even if it is fast
+const size_t kMaxSteps = 1000;
+
+double GetContainerArea() {
+  return (double) (ParticleSimulator::kXUpperBound - 
+      ParticleSimulator::kXLowerBound) * (ParticleSimulator::kYUpperBound - 
+      ParticleSimulator::kYLowerBound);
+}
+
+/**
+ * Splits the particles between the species of a mix and scales the radii 
+ * so the particles cover the given fraction of the container
+ */
+std::vector<SpeciesOptions> MakeSpecies(const Mix &mix, size_t count,
+                                        double packing_fraction) {
+  std::vector<SpeciesOptions> species;
+  size_t remaining = count;
+  double covered_area = 0;
+  for (size_t i = 0; i < kAppSpecies.size(); i++) {
+    if (mix.fractions[i] == 0) {
+      continue;
+    }
+    SpeciesOptions options = kAppSpecies[i];
+    options.count = i + 1 == kAppSpecies.size() ? remaining : 
+        std::min(remaining, (size_t) std::round(count * mix.fractions[i]));
+    remaining -= options.count;
+    covered_area += kPi * options.radius * options.radius * options.count;
+    species.push_back(options);
+  }
+  
+  double scale = std::sqrt(packing_fraction * GetContainerArea() / 
+      covered_area);
+  for (SpeciesOptions &options : species) {
+    options.radius = std::max(options.radius * scale, kMinRadius);
+  }
+  return species;
+}
+
+double FindPackingFraction(const std::vector<SpeciesOptions> &species) {
+  double covered_area = 0;
+  for (const SpeciesOptions &options : species) {
+    covered_area += kPi * options.radius * options.radius * options.count;
+  }
+  return covered_area / GetContainerArea();
+}
+
+nlohmann::json BenchmarkUpdate(const Mix &mix, size_t count, 
+                               double packing_fraction, size_t thread_count,
+                               double min_seconds) {
+  BatchOptions options;
+  options.species = MakeSpecies(mix, count, packing_fraction);
+  options.thread_count = thread_count;
+  
+  BatchRunner runner(options);
+  
+  // The first steps push apart the particles that were placed on top of 
+  // each other, so they aren't timed
+  runner.Run(2);
+  runner.ResetStatistics();
+  size_t steps = 0;
+  while (steps < kMaxSteps && (steps < 3 || 
+      runner.GetRunSeconds() < min_seconds)) {
+    runner.Run(1);
+    steps++;
+  }
+  
+  nlohmann::json statistics = runner.GetStatistics();
+  nlohmann::json result = {
+      {"benchmark", "update"},
+      {"mix", mix.name},
+      {"particles", count},
+      {"packing_fraction", FindPackingFraction(options.species)},
+      {"threads", thread_count},
+      {"steps", steps},
+      {"seconds", statistics["run_seconds"]},
+      {"ns_per_particle_step", statistics["nanoseconds_per_particle_step"]},
+      {"pairs_per_step", statistics["pairs_per_step"]}
+  };
+  if (statistics.count("instrumentation")) {
+    result["instrumentation"] = statistics["instrumentation"];
+  }
+  return result;
+}
+
+nlohmann::json BenchmarkFillBins(size_t count, double min_seconds) {
+  BatchOptions options;
+  options.species = MakeSpecies(kMixes[1], count, kPackingFractions[1]);
+  BatchRunner runner(options);
+  const ParticleStore &particles = runner.GetSimulator().GetParticles();
+  
+  // One histogram per species in the store, filled together like the app
+  // does. The radii were scaled for the packing fraction, so the species 
+  // are taken from the store rather than from kAppSpecies
+  std::vector<Histogram> histograms;
+  const std::vector<Species> &species = particles.GetSpecies();
+  for (size_t s = 0; s < species.size(); s++) {
+    histograms.push_back(Histogram((uint32_t) s, species[s].mass));
+  }
+  
+  size_t repetitions = 0;
+  std::chrono::steady_clock::time_point start = 
+      std::chrono::steady_clock::now();
+  double seconds = 0;
+  while (repetitions < kMaxSteps && (repetitions < 3 || 
+      seconds < min_seconds)) {
+    Histogram::FillBins(particles, histograms);
+    repetitions++;
+    seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+  }
+  
+  // Every particle has to land in a histogram, or the time means nothing
+  size_t binned = 0;
+  for (const Histogram &histogram : histograms) {
+    binned += histogram.GetParticleCount();
+  }
+  if (binned != count) {
+    throw std::runtime_error("The fill_bins benchmark only binned " + 
+                             std::to_string(binned) + " of " + 
+                             std::to_string(count) + " particles!");
+  }
+  
+  nlohmann::json result = {
+      {"benchmark", "fill_bins"},
+      {"particles", count},
+      {"repetitions", repetitions},
+      {"seconds", seconds},
+      {"ns_per_particle", seconds * 1e9 / ((double) count * repetitions)}
+  };
+  if (Instrumentation::kEnabled) {
+    result["instrumentation"] = FormatInstrumentation(
+        histograms.front().GetInstrumentationSnapshot());
+  }
+  return result;
+}
+
+nlohmann::json BenchmarkAddParticles(size_t count) {
+  ParticleSimulator simulator;
+  std::chrono::steady_clock::time_point start = 
+      std::chrono::steady_clock::now();
+  simulator.AddParticles(count, kAppSpecies[0].radius, kAppSpecies[0].mass,
+                         kAppSpecies[0].color);
+  double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  
+  return {
+      {"benchmark", "add_particles"},
+      {"particles", count},
+      {"seconds", seconds},
+      {"ns_per_particle", seconds * 1e9 / count}
+  };
+}
+
+BenchmarkOptions ParseOptions(const std::vector<std::string> &arguments) {
+  BenchmarkOptions options;
+  for (size_t i = 0; i + 1 < arguments.size(); i += 2) {
+    const std::string &option = arguments[i];
+    const std::string &value = arguments[i + 1];
+    if (option == "--max-particles") {
+      options.max_particles = std::stoul(value);
+    } else if (option == "--min-seconds") {
+      options.min_seconds = std::stod(value);
+    } else if (option == "--output") {
+      options.output_path = value;
+    } else if (option == "--threads") {
+      options.thread_counts.clear();
+      std::stringstream stream(value);
+      std::string thread_count;
+      while (std::getline(stream, thread_count, ',')) {
+        options.thread_counts.push_back(std::stoul(thread_count));
+      }
+    } else {
+      throw std::invalid_argument("Unknown option " + option + "!");
+    }
+  }
+  if (arguments.size() % 2 != 0) {
+    throw std::invalid_argument("Please give a value for " + 
+                                arguments.back() + "!");
+  }
+  return options;
+}
+
+/**
+ * Runs every benchmark up to the maximum amount of particles
+ * @param options the options of the benchmark
+ * @param results where the result of each benchmark is added
+ * @throws std::runtime_error if a benchmark didn't measure what it should
+ */
+void RunBenchmarks(const BenchmarkOptions &options, nlohmann::json &results) {
+  for (size_t count : kParticleCounts) {
+    if (count > options.max_particles) {
+      continue;
+    }
+    
+    for (const Mix &mix : kMixes) {
+      for (double packing_fraction : kPackingFractions) {
+        for (size_t thread_count : options.thread_counts) {
+          std::cerr << "update " << mix.name << " " << count << " particles "
+                    << packing_fraction << " packed " << thread_count 
+                    << " threads\n";
+          results.push_back(BenchmarkUpdate(mix, count, packing_fraction,
+                                            thread_count, 
+                                            options.min_seconds));
+        }
+      }
+    }
+    
+    std::cerr << "fill_bins " << count << " particles\n";
+    results.push_back(BenchmarkFillBins(count, options.min_seconds));
+    std::cerr << "add_particles " << count << " particles\n";
+    results.push_back(BenchmarkAddParticles(count));
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  BenchmarkOptions options;
+  try {
+    options = ParseOptions(std::vector<std::string>(argv + 1, argv + argc));
+  } catch (const std::exception &error) {
+    std::cerr << error.what() << "\n\nUsage: ideal-gas-benchmark "
+              << "[--max-particles N] [--threads 1,2,4] [--min-seconds S] "
+              << "[--output PATH]\n";
+    return 2;
+  }
+  
+  nlohmann::json results = nlohmann::json::array();
+  try {
+    RunBenchmarks(options, results);
+  } catch (const std::exception &error) {
+    std::cerr << error.what() << "\n";
+    return 1;
+  }
+  
+  nlohmann::json report = {
+      {"simd", GetSimdInstructionSet()},
+      {"hardware_threads", std::thread::hardware_concurrency()},
+      {"results", results}
+  };
+  
+  if (options.output_path.empty()) {
+    std::cout << report.dump(2) << "\n";
+  } else {
+    std::ofstream output(options.output_path);
+    output << report.dump(2) << "\n";
+  }
+  return 0;
+}
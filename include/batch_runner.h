@@ -0,0 +1,204 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "particle_simulator.h"
+#include "trajectory.h"
+
+namespace idealgas {
+
+/**
+ * One kind of particle to add to a batch run
+ */
+struct SpeciesOptions {
+  size_t count = 0;
+  double radius = 0;
+  double mass = 0;
+  std::string color = "white";
+};
+
+/**
+ * Everything a batch run is set up from
+ */
+struct BatchOptions {
+  std::vector<SpeciesOptions> species;
+  Container container = {
+      ParticleSimulator::kXLowerBound, ParticleSimulator::kYLowerBound,
+      ParticleSimulator::kXUpperBound, ParticleSimulator::kYUpperBound};
+  size_t steps = 1000;
+  
+  // The seed the particles are placed from, if has_seed is set. Batch runs
+  // use a seed of 0 without one, so they always start the same, while the
+  // app picks a new random seed every time
+  uint64_t seed = 0;
+  bool has_seed = false;
+  size_t thread_count = 1;
+  double time_step = 1;
+  Engine engine = Engine::kTimeStepped;
+  CollisionDetection collision_detection = CollisionDetection::kDiscrete;
+  Broadphase broadphase = Broadphase::kUniformGrid;
+  Placement placement = Placement::kRandom;
+  
+  // Where the statistics are written. They go to the standard output if 
+  // this is empty
+  std::string statistics_path;
+  
+  // Where the final state of every particle is written as CSV, if anywhere
+  std::string particles_path;
+  
+  // Where a checkpoint of the final state is written, if anywhere. With an
+  // interval, one is also written whenever the simulator's step count is a
+  // multiple of it, replacing the last one
+  std::string checkpoint_path;
+  size_t checkpoint_interval = 0;
+  
+  // A checkpoint to start from instead of placing the species. The 
+  // particles and settings all come from it, so only the steps, threads 
+  // and outputs are taken from the other options
+  std::string resume_path;
+  
+  // Where the positions and velocities are streamed to, if anywhere. A
+  // frame is taken whenever the simulator's step count is a multiple of
+  // the interval
+  std::string trajectory_path;
+  size_t trajectory_interval = 1;
+  OverflowPolicy trajectory_overflow = OverflowPolicy::kBlock;
+};
+
+/**
+ * Reads the options of a batch run from the command line arguments. A 
+ * --scenario is loaded first, wherever it is, and the other options are 
+ * applied on top of it
+ * @param arguments the arguments after the program name
+ * @return the options
+ * @throws std::invalid_argument if an argument is unknown or malformed
+ */
+BatchOptions ParseBatchOptions(const std::vector<std::string> &arguments);
+
+/**
+ * Reads the options of a run from a JSON scenario. It has a list of 
+ * "species", each with a "count", "radius", "mass" and "color", and can 
+ * also set the "container" walls ("left", "top", "right", "bottom"), the 
+ * "seed", "steps", "threads", "time_step", "engine", "collisions", 
+ * "broadphase" and "placement" with the same values as the command line, 
+ * and the "output" files ("stats", "particles", "checkpoint",
+ * "checkpoint_every", "trajectory", "trajectory_every" and
+ * "trajectory_overflow"). Anything left out keeps its default
+ * @param scenario the scenario
+ * @return the options
+ * @throws std::invalid_argument if a setting is unknown or has the wrong 
+ * type or value
+ */
+BatchOptions ParseScenario(const nlohmann::json &scenario);
+
+/**
+ * Reads the options of a run from a JSON scenario file, see ParseScenario
+ * @param path the scenario file
+ * @return the options
+ * @throws std::runtime_error if the file can't be opened
+ * @throws std::invalid_argument if the file isn't a valid scenario
+ */
+BatchOptions LoadScenario(const std::string &path);
+
+/**
+ * Gets the command line usage of the batch runner
+ */
+std::string GetBatchUsage();
+
+/**
+ * Writes instrumentation totals as JSON, with the seconds of each phase and
+ * the counters by name
+ * @param snapshot the totals to write
+ */
+nlohmann::json FormatInstrumentation(const InstrumentationSnapshot &snapshot);
+
+/**
+ * Runs a simulation without a window, as fast as the machine allows, and 
+ * collects statistics about the final state and how long it took. The 
+ * particles are placed from the seed, so the same options always give the
+ * same starting state
+ */
+class BatchRunner {
+ public:
+  
+  /**
+   * Sets up the simulator and adds the particles of every species, or 
+   * restores them from the checkpoint to resume from
+   * @param options the options of the run
+   */
+  explicit BatchRunner(const BatchOptions &options);
+  
+  /**
+   * Runs all the steps of the simulation, then writes the final checkpoint
+   * and finishes the trajectory if there are any
+   * @throws std::runtime_error if the trajectory couldn't be written
+   */
+  void Run();
+  
+  /**
+   * Runs some more steps of the simulation. The statistics cover every step
+   * run so far
+   * @param steps the amount of steps to run
+   */
+  void Run(size_t steps);
+  
+  /**
+   * Gets how long the steps run so far took, in seconds, not counting the 
+   * time spent writing checkpoints
+   */
+  double GetRunSeconds() const;
+  
+  /**
+   * Forgets the steps run so far, so the statistics only cover the steps 
+   * after this. The particles are left as they are
+   */
+  void ResetStatistics();
+  
+  /**
+   * Gets the statistics of the run as JSON: the timing, the energy and 
+   * momentum of the gas, a speed histogram for each species and how much
+   * of the trajectory was written
+   */
+  nlohmann::json GetStatistics() const;
+  
+  /**
+   * Writes the position, velocity, radius, mass and color of every particle
+   * as CSV
+   * @param output the stream to write to
+   */
+  void WriteParticles(std::ostream &output) const;
+  
+  const ParticleSimulator &GetSimulator() const;
+
+ private:
+  BatchOptions options_;
+  ParticleSimulator simulator_;
+  double setup_seconds_ = 0;
+  double run_seconds_ = 0;
+  double checkpoint_seconds_ = 0;
+  std::unique_ptr<TrajectoryWriter> trajectory_;
+  size_t steps_run_ = 0;
+  size_t pairs_tested_ = 0;
+  
+  /**
+   * Sets up the species options from the species table of a restored 
+   * simulation, so the statistics cover each of them
+   */
+  void AddRestoredSpecies();
+  
+  /**
+   * Writes a checkpoint of the simulation to the checkpoint path
+   * @return how long writing it took, in seconds
+   */
+  double SaveCheckpoint();
+  
+  /**
+   * Starts writing the trajectory, if there is a path for it
+   */
+  void OpenTrajectory();
+};
+
+} // namespace idealgas
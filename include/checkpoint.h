@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "particle_simulator.h"
+#include "particle_store.h"
+
+namespace idealgas {
+
+/**
+ * Everything about a simulation a checkpoint keeps besides its particles.
+ * The thread count isn't kept, since it depends on the machine and doesn't
+ * change the results
+ */
+struct CheckpointState {
+  uint64_t seed = 0;
+
+  // How many random particles were made from the seed, so particles added
+  // after a restore get the same numbers as without one
+  uint64_t random_particles = 0;
+  uint64_t steps = 0;
+  double accumulated_time = 0;
+  double time_step = 1;
+  uint64_t max_substeps = 1;
+  Engine engine = Engine::kTimeStepped;
+  CollisionDetection collision_detection = CollisionDetection::kDiscrete;
+  Broadphase broadphase = Broadphase::kUniformGrid;
+  Placement placement = Placement::kRandom;
+  Container container = {
+      ParticleSimulator::kXLowerBound, ParticleSimulator::kYLowerBound,
+      ParticleSimulator::kXUpperBound, ParticleSimulator::kYUpperBound};
+};
+
+// The version written into new checkpoints. Reading only accepts this one.
+// Version 2 added the container
+const static uint32_t kCheckpointVersion = 2;
+
+/**
+ * Writes a checkpoint file. It starts with a fixed size header holding the
+ * version, the state and where every section is, followed by the species
+ * table, the color names and then each particle column as a raw array. The
+ * sections start on 64 byte boundaries, so the columns can be used straight
+ * from a mapping of the file. The file is written next to the path first
+ * and then moved over it, so a crash while writing never loses the last
+ * checkpoint
+ * @param path where the checkpoint goes
+ * @param particles the particles to keep
+ * @param state the rest of the simulation to keep
+ * @throws std::runtime_error if the file can't be written
+ */
+void WriteCheckpoint(const std::string &path, const ParticleStore &particles,
+                     const CheckpointState &state);
+
+/**
+ * Reads a checkpoint file written by WriteCheckpoint. The file is mapped
+ * into memory and each column is copied into the store in one go
+ * @param path the checkpoint to read
+ * @param particles the store the species and particles are added to, which
+ * has to be empty
+ * @return the rest of the simulation
+ * @throws std::runtime_error if the file can't be read
+ * @throws std::invalid_argument if the file isn't a checkpoint of this
+ * version, or it is cut short or damaged
+ */
+CheckpointState ReadCheckpoint(const std::string &path,
+                               ParticleStore *particles);
+
+} // namespace idealgas
@@ -0,0 +1,211 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+#include "particle_pair.h"
+#include "particle_store.h"
+#include "speed_change.h"
+
+namespace idealgas {
+
+/**
+ * Moves the particles forward one time step with continuous collision 
+ * detection. Instead of moving every particle and then checking for 
+ * overlaps, each particle is swept as a moving circle over the step and the
+ * exact times of its contacts with other particles and with the walls are
+ * found. The contacts are resolved from the earliest to the latest, so a 
+ * fast particle can't pass through another particle or a wall in between 
+ * two steps.
+ *
+ * Only pairs whose swept bounding boxes overlap are checked. Each box 
+ * covers the straight path of a particle from its last bounce to the end of
+ * the step, and the boxes are kept in a uniform grid over the container. 
+ * When a particle bounces off a wall or another particle, its box is 
+ * swept again along its new path and looked up in the grid, so it is 
+ * checked against every particle it can reach before the step ends.
+ */
+class ContinuousCollisions {
+ public:
+
+  /**
+   * Moves the particles forward by a time step, resolving every contact 
+   * inside the step in order
+   * @param particles the particles in the simulator
+   * @param duration how much simulated time the step covers
+   * @param x_lower_bound the left wall of the container
+   * @param y_lower_bound the top wall of the container
+   * @param x_upper_bound the right wall of the container
+   * @param y_upper_bound the bottom wall of the container
+   * @param speed_changes where the speed of each particle that collided is 
+   * reported, or nullptr to not report them
+   * @return the amount of particle collisions that were resolved
+   */
+  size_t Step(ParticleStore &particles, double duration,
+              double x_lower_bound, double y_lower_bound,
+              double x_upper_bound, double y_upper_bound,
+              std::vector<SpeedChange> *speed_changes = nullptr);
+
+  /**
+   * Gets the amount of candidate pairs found at the start of the last step
+   */
+  size_t GetCandidatePairCount() const;
+
+  /**
+   * Gets the amount of wall bounces that were resolved in the last step
+   */
+  size_t GetWallCollisionCount() const;
+
+ private:
+
+  /**
+   * A contact predicted for a time in the step. A wall contact has the same
+   * particle twice. It is only still valid if neither particle has been in
+   * any other contact since it was predicted
+   */
+  struct Event {
+    double time;
+    uint32_t particle1;
+    uint32_t particle2;
+    uint32_t particle1_events;
+    uint32_t particle2_events;
+    bool vertical_wall;
+
+    bool operator>(const Event &other) const {
+      return time > other.time;
+    }
+  };
+
+  // The state of each particle at its own last update time in the step
+  std::vector<double> x_;
+  std::vector<double> y_;
+  std::vector<double> x_velocity_;
+  std::vector<double> y_velocity_;
+  std::vector<double> last_update_;
+  std::vector<uint32_t> event_count_;
+  std::vector<double> radius_;
+
+  // The particles that hit another particle since the velocities were last
+  // written back. Only these can have a new speed
+  std::vector<uint32_t> collided_;
+
+  /**
+   * The swept bounding box of a particle's current path, kept together 
+   * with the last lookup the particle was seen in so a lookup only touches
+   * one place per particle
+   */
+  struct Box {
+    double min_x;
+    double max_x;
+    double min_y;
+    double max_y;
+    uint32_t lookup;
+  };
+  std::vector<Box> boxes_;
+
+  // The grid the boxes are kept in, as the particles in each cell. A 
+  // particle's entries in cells its box has left since are only removed 
+  // when the cell is next looked through
+  double cell_size_ = 1;
+  size_t columns_ = 1;
+  size_t rows_ = 1;
+  std::vector<std::vector<uint32_t>> cells_;
+
+  // The cells each particle's box touches, so a new box is only added to 
+  // the cells it wasn't in yet
+  struct CellRange {
+    size_t first_column;
+    size_t last_column;
+    size_t first_row;
+    size_t last_row;
+  };
+  std::vector<CellRange> cell_ranges_;
+
+  // Counts the lookups, so a particle in several of the cells is only 
+  // reported once
+  uint32_t lookup_count_ = 0;
+  std::vector<uint32_t> overlaps_;
+
+  // The candidate pairs found at the start of the step
+  std::vector<ParticlePair> candidate_pairs_;
+
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+  double time_ = 0;
+  double duration_ = 0;
+  size_t wall_collision_count_ = 0;
+  double x_lower_bound_ = 0;
+  double y_lower_bound_ = 0;
+  double x_upper_bound_ = 0;
+  double y_upper_bound_ = 0;
+
+  // A step stops resolving contacts in order after this many contacts per
+  // particle, so particles stuck in a corner can't stall the step. Anything 
+  // left is caught at the start of the next step
+  const static size_t kMaxEventsPerParticle = 16;
+
+  /**
+   * Sweeps the box of every particle, puts them in the grid and finds the
+   * pairs whose boxes overlap
+   */
+  void FindCandidatePairs();
+
+  /**
+   * Sweeps the bounding box of a particle along its path from the current
+   * time to the end of the step
+   * @param particle the index of the particle, which has to be up to date
+   */
+  void SweepBox(uint32_t particle);
+
+  /**
+   * Adds a particle to every cell its box touches that it isn't in yet
+   */
+  void AddToGrid(uint32_t particle);
+
+  /**
+   * Gets the cells a particle's box touches
+   */
+  CellRange GetCellRange(uint32_t particle) const;
+
+  /**
+   * Finds the particles whose boxes overlap the box of a particle and puts
+   * them in overlaps_
+   */
+  void FindOverlaps(uint32_t particle);
+
+  /**
+   * Gets the column or row of the grid a coordinate is in, clamped to the 
+   * grid since a box can reach past the walls
+   */
+  size_t GetCell(double coordinate, double lower_bound, size_t cells) const;
+
+  /**
+   * Moves a particle forward to the current time in the step
+   */
+  void Synchronize(uint32_t particle);
+
+  /**
+   * Predicts the wall contacts of a particle in the rest of the step and 
+   * its contacts with every particle it can reach along its new path
+   * @param particle the index of the particle, which has to be up to date
+   * @param radii the radii of the particles
+   */
+  void Predict(uint32_t particle, const double *radii);
+
+  /**
+   * Predicts the contact of two particles in the rest of the step, if any
+   * @param particle1 the index of the first particle, which has to be up 
+   * to date
+   * @param particle2 the index of the second particle
+   * @param radii the radii of the particles
+   */
+  void PredictCollision(uint32_t particle1, uint32_t particle2,
+                        const double *radii);
+
+  /**
+   * Adds a contact to the queue if it happens before the end of the step
+   */
+  void AddEvent(double delay, uint32_t particle1, uint32_t particle2,
+                bool vertical_wall);
+};
+
+} // namespace idealgas
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+
+namespace idealgas {
+
+/**
+ * A counter based random number generator. Instead of stepping a state
+ * forward, the number at each position of the sequence is a hash of the
+ * seed and the position, using the SplitMix64 mixing function. Any number
+ * can be made on its own, so threads that fill different parts of an array
+ * get exactly the numbers one thread would have, however the work is split.
+ * It only holds the seed, so it is also much cheaper to create than a
+ * std::mt19937
+ */
+class CounterRng {
+ public:
+
+  /**
+   * Creates a generator for the sequence of a seed
+   * @param seed the seed, where each seed gives a different sequence
+   */
+  explicit CounterRng(uint64_t seed = 0);
+
+  /**
+   * Gets 64 random bits
+   * @param counter the position in the sequence
+   */
+  uint64_t GetBits(uint64_t counter) const;
+
+  /**
+   * Gets a random number from min up to but not including max
+   * @param counter the position in the sequence
+   * @param min the smallest number that can come out
+   * @param max the end of the range
+   */
+  double GetUniform(uint64_t counter, double min, double max) const;
+
+  uint64_t GetSeed() const;
+
+ private:
+  uint64_t seed_;
+
+  // The seed mixed once, so seeds that are close together give sequences
+  // that have nothing in common
+  uint64_t key_;
+
+  /**
+   * The SplitMix64 finalizer, which spreads every input bit over the output
+   */
+  static uint64_t Mix(uint64_t value);
+};
+
+} // namespace idealgas
@@ -0,0 +1,184 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+#include "particle_store.h"
+#include "speed_change.h"
+
+namespace idealgas {
+
+/**
+ * Simulates the particles as hard disks by jumping from one collision to
+ * the next instead of moving every particle a whole step at a time. The
+ * exact times of the particle and wall collisions are kept in a priority
+ * queue, so time only advances to the next event and nothing happens in
+ * between. Since no collision is ever skipped, particles can move as fast
+ * as they want without tunneling.
+ *
+ * Each particle keeps the time its position was last brought up to date,
+ * so an event only has to move the particles it involves. Particles are
+ * also bucketed into a grid of cells, and collisions are only predicted
+ * with particles in neighboring cells, with a cell crossing event whenever
+ * a particle moves into a new cell.
+ */
+class EventDrivenEngine {
+ public:
+
+  /**
+   * Takes over the positions and velocities from the store and predicts
+   * the first events. This has to be called again whenever the particles
+   * are changed outside of the engine
+   * @param particles the particles in the simulator
+   * @param x_lower_bound the left wall of the container
+   * @param y_lower_bound the top wall of the container
+   * @param x_upper_bound the right wall of the container
+   * @param y_upper_bound the bottom wall of the container
+   */
+  void Reset(const ParticleStore &particles, double x_lower_bound,
+             double y_lower_bound, double x_upper_bound,
+             double y_upper_bound);
+
+  /**
+   * Processes every event up to the given amount of time from now, then
+   * writes the positions and velocities back to the store
+   * @param duration how much simulated time to advance by
+   * @param particles the particles in the simulator
+   * @param speed_changes where the speed of each particle that collided is 
+   * reported, or nullptr to not report them
+   */
+  void Advance(double duration, ParticleStore &particles,
+               std::vector<SpeedChange> *speed_changes = nullptr);
+
+  double GetTime() const;
+  size_t GetParticleCollisionCount() const;
+  size_t GetWallCollisionCount() const;
+
+ private:
+
+  /**
+   * The kinds of events in the queue
+   */
+  enum class EventType : uint8_t {
+    kParticle,
+    kVerticalWall,
+    kHorizontalWall,
+    kColumnCrossing,
+    kRowCrossing
+  };
+
+  /**
+   * An event predicted for a time in the future. It is only still valid if
+   * neither particle has been in any other event since it was predicted
+   */
+  struct Event {
+    double time;
+    uint32_t particle1;
+    uint32_t particle2;
+    uint32_t particle1_events;
+    uint32_t particle2_events;
+    EventType type;
+
+    bool operator>(const Event &other) const {
+      return time > other.time;
+    }
+  };
+
+  // The state of each particle at its own last update time
+  std::vector<double> x_;
+  std::vector<double> y_;
+  std::vector<double> x_velocity_;
+  std::vector<double> y_velocity_;
+  std::vector<double> last_update_;
+  std::vector<double> radius_;
+  std::vector<double> inverse_mass_;
+
+  // How many events each particle has been in. Events store these when
+  // they are predicted, so an event is stale if the count has changed
+  std::vector<uint32_t> event_count_;
+
+  // The particles that hit another particle since the velocities were last
+  // written back. Only these can have a new speed
+  std::vector<uint32_t> collided_;
+
+  // The cell of each particle and the particles in each cell. slot_ is the
+  // particle's index in its cell's list so it can be removed quickly
+  std::vector<uint32_t> column_;
+  std::vector<uint32_t> row_;
+  std::vector<uint32_t> slot_;
+  std::vector<std::vector<uint32_t>> cells_;
+  size_t columns_ = 1;
+  size_t rows_ = 1;
+  double cell_size_ = 1;
+
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+  double time_ = 0;
+  double x_lower_bound_ = 0;
+  double y_lower_bound_ = 0;
+  double x_upper_bound_ = 0;
+  double y_upper_bound_ = 0;
+  size_t particle_collision_count_ = 0;
+  size_t wall_collision_count_ = 0;
+
+  // Caps the number of cells, like in UniformGrid
+  const static size_t kMaxCellsPerParticle = 4;
+
+  // Invalid events stay in the queue until they are popped. If there are
+  // this many events per particle, the queue is rebuilt from scratch
+  const static size_t kMaxEventsPerParticle = 32;
+
+  /**
+   * Moves a particle forward to the current time
+   * @param particle the index of the particle
+   */
+  void Synchronize(uint32_t particle);
+
+  /**
+   * Predicts every event of a particle: its wall collisions, its next cell
+   * crossing and its collisions with the particles in neighboring cells
+   * @param particle the index of the particle, which has to be up to date
+   * @param only_later_particles only predict collisions with particles that
+   * have a bigger index, so each pair is only predicted once on a reset
+   */
+  void Predict(uint32_t particle, bool only_later_particles);
+
+  /**
+   * Predicts when two particles will collide, if ever, and adds the event
+   * @param particle1 the index of the first particle, which has to be up
+   * to date
+   * @param particle2 the index of the second particle
+   */
+  void PredictCollision(uint32_t particle1, uint32_t particle2);
+
+  /**
+   * Processes one event that is still valid
+   * @param event the event to process
+   */
+  void Process(const Event &event);
+
+  /**
+   * Moves a particle from its cell to a different one
+   */
+  void MoveToCell(uint32_t particle, uint32_t column, uint32_t row);
+
+  /**
+   * Clears the queue and predicts every event again from the current time
+   */
+  void Rebuild();
+
+  /**
+   * Adds an event to the queue for a time from now, unless the delay is 
+   * infinite because the event never happens
+   */
+  void AddEvent(double delay, EventType type, uint32_t particle1,
+                uint32_t particle2);
+
+  /**
+   * Finds the cell index along one axis, clamping positions outside of the
+   * container into the border cells
+   */
+  uint32_t FindCellIndex(double coordinate, double lower_bound,
+                         size_t cells) const;
+};
+
+} // namespace idealgas
@@ -0,0 +1,52 @@
+#pragma once
+
+namespace idealgas {
+
+/**
+ * Finds when two moving circles first touch
+ * @param x_difference the x position of the second circle minus the first
+ * @param y_difference the y position of the second circle minus the first
+ * @param x_velocity_difference the x velocity of the second circle minus 
+ * the first
+ * @param y_velocity_difference the y velocity of the second circle minus 
+ * the first
+ * @param radii_sum the sum of the radii of the circles
+ * @return how long from now until they touch, which is 0 if they already 
+ * overlap and are moving toward each other, or infinity if they never touch
+ */
+double FindCollisionTime(double x_difference, double y_difference,
+                         double x_velocity_difference,
+                         double y_velocity_difference, double radii_sum);
+
+/**
+ * Finds when a circle moving along one axis touches the wall it is moving 
+ * toward
+ * @param position the position of the circle along the axis
+ * @param velocity the velocity of the circle along the axis
+ * @param radius the radius of the circle
+ * @param lower_bound the wall at the lower end of the axis
+ * @param upper_bound the wall at the upper end of the axis
+ * @return how long from now until it touches the wall, which is 0 if it is
+ * already past it, or infinity if the circle isn't moving along the axis
+ */
+double FindWallCollisionTime(double position, double velocity, double radius,
+                             double lower_bound, double upper_bound);
+
+/**
+ * Changes the velocities of two touching circles in an elastic collision,
+ * using the same equations as ParticleSimulator::Collide
+ * @param x_difference the x position of the first circle minus the second
+ * @param y_difference the y position of the first circle minus the second
+ * @param inverse_mass1 one over the mass of the first circle
+ * @param inverse_mass2 one over the mass of the second circle
+ * @param x_velocity1 the x velocity of the first circle
+ * @param y_velocity1 the y velocity of the first circle
+ * @param x_velocity2 the x velocity of the second circle
+ * @param y_velocity2 the y velocity of the second circle
+ */
+void CollideHardDisks(double x_difference, double y_difference,
+                      double inverse_mass1, double inverse_mass2,
+                      double &x_velocity1, double &y_velocity1,
+                      double &x_velocity2, double &y_velocity2);
+
+} // namespace idealgas
@@ -1,17 +1,35 @@
 #pragma once
 #include <vector>
+#include "instrumentation.h"
 #include "particle.h"
-#include "particle_simulator.h"
+#include "particle_store.h"
+#include "speed_change.h"
 
 namespace idealgas {
 
+/**
+ * Counts the particles of one species into bins by their speed. Drawing the
+ * histogram is left to HistogramRenderer so this builds without Cinder
+ */
 class Histogram {
  public:
   
+  // This is the number of bars you want on the histogram
+  const static size_t kNumberOfPartitions = 10;
+  
+  // The max speed for the histogram. Play around with this number if you 
+  // have bigger particles with higher speeds 
+  const static size_t kMaxSpeed = 50;
+  
   /**
-   * Constructs a histogram based on the mass of a particle 
+   * Constructs a histogram for the particles of a species. Species can 
+   * share a mass, so the particles in a store are picked by their species 
+   * index. The mass is shown in the title and picks the particles out of 
+   * Particle copies, which don't know their species
+   * @param species the index of the species in the particle store
+   * @param mass the mass of the species
    */
-  Histogram(double mass);
+  Histogram(uint32_t species, double mass);
 
   /**
    * Fills the bins with all the particles in the range 
@@ -20,6 +38,49 @@ class Histogram {
    */
   void FillBins(const std::vector<Particle> &particles);
 
+  /**
+   * Fills the bins with the particles in the store that are of the 
+   * histogram's species. This reads the velocity and species columns 
+   * directly instead of copying the particles out first
+   * @param particles the particles in the simulator
+   */
+  void FillBins(const ParticleStore &particles);
+
+  /**
+   * Fills the bins of every histogram in one pass over the store, without 
+   * allocating. Each particle goes straight to the bin of its speed in the 
+   * histogram of its species. The time of the pass is recorded by the first 
+   * histogram, and each one counts its own particles
+   * @param particles the particles in the simulator
+   * @param histograms the histograms to fill
+   */
+  static void FillBins(const ParticleStore &particles,
+                       std::vector<Histogram> &histograms);
+
+  /**
+   * Moves the particles whose speed changed from the bin of their old speed
+   * to the bin of their new one, and counts the added particles. This only
+   * looks at the changes, so once the bins are filled they can be kept up 
+   * to date from the simulator's speed changes without binning every 
+   * particle again. Filling the bins from scratch gives the same bins, 
+   * which makes it a check that no change was missed
+   * @param particles the particles in the simulator
+   * @param speed_changes the changes since the bins were filled or last 
+   * updated
+   */
+  void ApplySpeedChanges(const ParticleStore &particles,
+                         const std::vector<SpeedChange> &speed_changes);
+
+  /**
+   * Applies speed changes to every histogram in one pass over the changes
+   * @param particles the particles in the simulator
+   * @param speed_changes the changes since the bins were last updated
+   * @param histograms the histograms to update
+   */
+  static void ApplySpeedChanges(const ParticleStore &particles,
+                                const std::vector<SpeedChange> &speed_changes,
+                                std::vector<Histogram> &histograms);
+
   /**
    * Finds all the particles that have a given mass
    * @param particles the list of particles in the simulator that have the 
@@ -28,77 +89,91 @@ class Histogram {
   std::vector<Particle> FindAllParticlesWithMass(const std::vector<Particle>&
       particles) const;
   
+  const std::vector<size_t> &GetBins() const;
+  uint32_t GetSpecies() const;
+  double GetMass() const;
+  
+  /**
+   * Gets the amount of particles that were last put in the bins
+   */
+  size_t GetParticleCount() const;
+  
   /**
-   * Draws the histogram
-   * @param position the position on the GUI to be drawn at
-   * @param particles the list of particles from the Particle simulator
+   * Gets the color of the particles that were last put in the bins
    */
-  void Draw(size_t position, const std::vector<Particle> &particles);
+  const std::string &GetColor() const;
 
-  const std::vector<size_t> &GetBins() const;
+  /**
+   * Gets the time spent filling the bins and the amount of particles put in
+   * them since the last reset. Everything is 0 unless the build defines 
+   * IDEAL_GAS_ENABLE_INSTRUMENTATION
+   */
+  InstrumentationSnapshot GetInstrumentationSnapshot() const;
+  
+  /**
+   * Sets the instrumentation totals back to 0
+   */
+  void ResetInstrumentation();
 
  private:
-  std::vector<Particle> particles_;
   std::vector<size_t> bins_;
-  double mass_;
-  double lower_bound_;
-  
-  // These vectors represent the corners of the histogram 
-  glm::vec2 vertical_axis_top_left_;
-  glm::vec2 vertical_axis_bottom_left_;
-  glm::vec2 horizontal_axis_bottom_left_;
-  glm::vec2 horizontal_axis_bottom_right_;
   
+  // The amount and color of the particles that were last put in the bins
+  size_t particle_count_ = 0;
+  std::string color_;
+  uint32_t species_;
+  double mass_;
+  Instrumentation instrumentation_;
   
-  // This is the number of bars you want on the histogram
-  const static size_t kNumberOfPartitions = 10;
-  
-  // The max speed for the histogram. Play around with this number if you 
-  // have bigger particles with higher speeds 
-  const static size_t kMaxSpeed = 50;
-  
-  // Sets the bounds for drawing the histogram 
-  const static size_t kXUpperBound = ParticleSimulator::kXLowerBound * .9; 
-  const static size_t kXLowerBound = ParticleSimulator::kXLowerBound * .1;
-  
-  // The height of a histogram 
-  const static size_t kHeight = ParticleSimulator::kYUpperBound * .25;
+  // The amount of species whose histogram is found with a lookup table 
+  // while filling or updating the bins. The table lives on the stack so it
+  // doesn't allocate, and species past it are searched for instead
+  const static size_t kSpeciesLookupSize = 64;
   
   /**
-   * Finds all the particles in a given speed range
-   * @param min_speed the min speed for the range
-   * @param max_speed the max speed for the range
-   * @return the count of all the particles in the given range
+   * Fills the bins of an array of histograms, see the public overload
    */
-  size_t FindAllParticlesInSpeedRange(const std::vector<Particle> &particles, 
-                                      double min_speed, double max_speed) const;
-  
+  static void FillBins(const ParticleStore &particles, Histogram *histograms,
+                       size_t count);
+
   /**
-   * Updates the histogram by continuously drawing rectangles to match the 
-   * number of particles in a given speed range
+   * Applies speed changes to an array of histograms, see the public 
+   * overload
    */
-  void UpdateHistogram();
+  static void ApplySpeedChanges(const ParticleStore &particles,
+                                const std::vector<SpeedChange> &speed_changes,
+                                Histogram *histograms, size_t count);
 
   /**
-   * Draws the X Axis labels for the histogram
+   * Finds the histogram for a species
+   * @return the index of the histogram, or count if none has the species
    */
-  void DrawXAxisLabels();
+  static size_t FindHistogram(uint32_t species, const Histogram *histograms,
+                              size_t count);
   
   /**
-   * Draws the Y Axis labels for the histogram
+   * Fills a lookup table with the histogram of each of the first 
+   * kSpeciesLookupSize species, or count for the species without one
+   * @param lookup the table to fill, with kSpeciesLookupSize entries
    */
-  void DrawYAxisLabels();
+  static void BuildSpeciesLookup(const Histogram *histograms, size_t count,
+                                 size_t *lookup);
   
   /**
-   * Draws the title for the histogram
+   * Finds the histogram for a species in a table from BuildSpeciesLookup,
+   * or searches for it if the species is past the table
+   * @return the index of the histogram, or count if none has the species
    */
-  void DrawTitle();
-  
+  static size_t LookUpHistogram(uint32_t species, const size_t *lookup,
+                                const Histogram *histograms, size_t count);
+
   /**
-   * Draws the axis titles for the histogram
+   * Finds the bin a speed goes in
+   * @param speed the speed of a particle
+   * @return the index of the bin, or kNumberOfPartitions if the speed is 
+   * past the last bin
    */
-  void DrawAxisTitles();
-  
+  static size_t FindBin(double speed);
 };
 
 } // namespace idealgas
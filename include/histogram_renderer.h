@@ -0,0 +1,68 @@
+#pragma once
+#include "cinder/gl/gl.h"
+#include "histogram.h"
+#include "particle_simulator.h"
+#include "text_cache.h"
+
+namespace idealgas {
+
+/**
+ * Draws a histogram with Cinder: its axes, labels, title and bars
+ */
+class HistogramRenderer {
+ public:
+  
+  /**
+   * Draws the histogram
+   * @param histogram the histogram to draw, with its bins already filled
+   * @param position the position on the GUI to be drawn at
+   */
+  void Draw(const Histogram &histogram, size_t position);
+
+ private:
+  double lower_bound_ = 0;
+  
+  // Every label is drawn in the same font, so all the histograms share 
+  // the rasterized labels
+  TextCache text_cache_ = TextCache("Arial", 15);
+  
+  // These vectors represent the corners of the histogram 
+  glm::vec2 vertical_axis_top_left_;
+  glm::vec2 vertical_axis_bottom_left_;
+  glm::vec2 horizontal_axis_bottom_left_;
+  glm::vec2 horizontal_axis_bottom_right_;
+  
+  // Sets the bounds for drawing the histogram 
+  const static size_t kXUpperBound = ParticleSimulator::kXLowerBound * .9; 
+  const static size_t kXLowerBound = ParticleSimulator::kXLowerBound * .1;
+  
+  // The height of a histogram 
+  const static size_t kHeight = ParticleSimulator::kYUpperBound * .25;
+  
+  /**
+   * Draws rectangles to match the number of particles in each speed range
+   */
+  void DrawBars(const Histogram &histogram);
+
+  /**
+   * Draws the X Axis labels for the histogram
+   */
+  void DrawXAxisLabels();
+  
+  /**
+   * Draws the Y Axis labels for the histogram
+   */
+  void DrawYAxisLabels(const Histogram &histogram);
+  
+  /**
+   * Draws the title for the histogram
+   */
+  void DrawTitle(const Histogram &histogram);
+  
+  /**
+   * Draws the axis titles for the histogram
+   */
+  void DrawAxisTitles();
+};
+
+} // namespace idealgas
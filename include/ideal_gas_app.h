@@ -3,8 +3,14 @@
 #include "cinder/app/App.h"
 #include "cinder/app/RendererGl.h"
 #include "cinder/gl/gl.h"
+#include <memory>
+#include "batch_runner.h"
 #include "particle_simulator.h"
+#include "particle_renderer.h"
 #include "histogram.h"
+#include "histogram_renderer.h"
+#include "simulation_thread.h"
+#include "text_cache.h"
 
 namespace idealgas {
 
@@ -15,31 +21,39 @@ class IdealGasApp : public ci::app::App {
   void draw() override;
   void update() override;
   void setup() override;
+  void cleanup() override;
   void keyDown(ci::app::KeyEvent event) override;
   
  private:
-  ParticleSimulator particle_simulator_;
-  std::vector<Histogram> histograms_;
+  ParticleRenderer particle_renderer_;
+  HistogramRenderer histogram_renderer_;
+  TextCache banner_text_ = TextCache("Times New Roman", 20);
   
-  // Modify these constants to change the different particles' color
-  const std::string kBigParticleColor = "blue";
-  const std::string kMediumParticleColor = "green";
-  const std::string kSmallParticleColor = "red";
+  // Runs the simulation set up in setup, so drawing only reads its 
+  // snapshots. The thread keeps the only copy of the simulation and its 
+  // histograms
+  std::unique_ptr<SimulationThread> simulation_thread_;
   
-  // Modify these constants to change the different particles' mass
-  constexpr static double kBigParticleMass = 100;
-  constexpr static double kMediumParticleMass = 25;
-  constexpr static double kSmallParticleMass = 5;
-
-  // Modify these constants to change the different particles' radii 
-  constexpr static double kBigParticleRadius = 20;
-  constexpr static double kMediumParticleRadius = 12;
-  constexpr static double kSmallParticleRadius = 8;
+  // The velocities are in pixels per time step, and the simulation used to
+  // take one step per frame at 60 frames per second
+  constexpr static double kTicksPerSecond = 60;
+  
+  // The scenario in the app's assets loaded at startup when no other one 
+  // is given on the command line. Its species, container, seed and engine 
+  // can be changed without rebuilding
+  const std::string kDefaultScenarioPath = "ideal_gas.json";
+  
+  /**
+   * Loads the scenario named on the command line or the default one. If it
+   * can't be loaded, the reason is logged and the built in small, medium 
+   * and big particles are used instead, so the app still starts
+   */
+  BatchOptions LoadAppScenario();
 
-  // Modify these constants to change the number of particles in the simulation
-  const static size_t kBigParticleAmount = 25;
-  const static size_t kMediumParticleAmount = 25;
-  const static size_t kSmallParticleAmount = 25;
+  // The walls of the scenario's container, for drawing
+  Container container_ = {
+      ParticleSimulator::kXLowerBound, ParticleSimulator::kYLowerBound,
+      ParticleSimulator::kXUpperBound, ParticleSimulator::kYUpperBound};
 };
 
 }  // namespace idealgas
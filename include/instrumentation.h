@@ -0,0 +1,159 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace idealgas {
+
+/**
+ * The parts of an update and of the histograms that are timed separately
+ */
+enum class Phase {
+  // Building the grid or sweeping the x intervals to find candidate pairs
+  kBroadphase,
+
+  // Testing the candidate pairs for overlaps
+  kNarrowphase,
+
+  // Calculating the new velocities of the colliding pairs
+  kCollisionResponse,
+
+  // Moving the particles and bouncing them off the walls
+  kIntegration,
+
+  // The whole swept step of continuous collision detection
+  kContinuousCollisions,
+
+  // Processing the events of the event driven engine
+  kEventProcessing,
+
+  // Putting the particles into the histogram bins
+  kBinning
+};
+
+/**
+ * The things that are counted alongside the phase times
+ */
+enum class Counter {
+  kUpdates,
+  kCandidatePairs,
+  kCollisions,
+  kWallBounces,
+  kBinnedParticles
+};
+
+const static size_t kPhaseCount = 7;
+const static size_t kCounterCount = 5;
+
+/**
+ * Gets the name of a phase, for reports
+ */
+const char *GetPhaseName(Phase phase);
+
+/**
+ * Gets the name of a counter, for reports
+ */
+const char *GetCounterName(Counter counter);
+
+/**
+ * The totals recorded since the last reset
+ */
+struct InstrumentationSnapshot {
+  double seconds[kPhaseCount] = {};
+  uint64_t counts[kCounterCount] = {};
+
+  double GetSeconds(Phase phase) const {
+    return seconds[static_cast<size_t>(phase)];
+  }
+
+  uint64_t GetCount(Counter counter) const {
+    return counts[static_cast<size_t>(counter)];
+  }
+};
+
+/**
+ * Adds up the time spent in each phase and the counters. It only records
+ * anything when the build defines IDEAL_GAS_ENABLE_INSTRUMENTATION.
+ * Otherwise every method is an empty inline function, so the calls compile
+ * away and the snapshots stay at zero
+ */
+class Instrumentation {
+ public:
+
+#ifdef IDEAL_GAS_ENABLE_INSTRUMENTATION
+  const static bool kEnabled = true;
+#else
+  const static bool kEnabled = false;
+#endif
+
+  void AddTime(Phase phase, double seconds) {
+#ifdef IDEAL_GAS_ENABLE_INSTRUMENTATION
+    totals_.seconds[static_cast<size_t>(phase)] += seconds;
+#else
+    (void) phase;
+    (void) seconds;
+#endif
+  }
+
+  void AddCount(Counter counter, uint64_t amount) {
+#ifdef IDEAL_GAS_ENABLE_INSTRUMENTATION
+    totals_.counts[static_cast<size_t>(counter)] += amount;
+#else
+    (void) counter;
+    (void) amount;
+#endif
+  }
+
+  InstrumentationSnapshot GetSnapshot() const {
+#ifdef IDEAL_GAS_ENABLE_INSTRUMENTATION
+    return totals_;
+#else
+    return InstrumentationSnapshot();
+#endif
+  }
+
+  void Reset() {
+#ifdef IDEAL_GAS_ENABLE_INSTRUMENTATION
+    totals_ = InstrumentationSnapshot();
+#endif
+  }
+
+ private:
+#ifdef IDEAL_GAS_ENABLE_INSTRUMENTATION
+  InstrumentationSnapshot totals_;
+#endif
+};
+
+/**
+ * Times a phase from its construction until it goes out of scope. Empty
+ * when instrumentation is compiled out, so it doesn't even read the clock
+ */
+class PhaseTimer {
+ public:
+
+#ifdef IDEAL_GAS_ENABLE_INSTRUMENTATION
+  PhaseTimer(Instrumentation &instrumentation, Phase phase)
+      : instrumentation_(instrumentation), phase_(phase),
+        start_(std::chrono::steady_clock::now()) {}
+
+  ~PhaseTimer() {
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start_;
+    instrumentation_.AddTime(phase_, elapsed.count());
+  }
+#else
+  PhaseTimer(Instrumentation &, Phase) {}
+#endif
+
+  PhaseTimer(const PhaseTimer &) = delete;
+  PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+#ifdef IDEAL_GAS_ENABLE_INSTRUMENTATION
+ private:
+  Instrumentation &instrumentation_;
+  Phase phase_;
+  std::chrono::steady_clock::time_point start_;
+#endif
+};
+
+} // namespace idealgas
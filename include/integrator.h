@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace idealgas {
+
+/**
+ * Moves a whole array of particles by their velocities and bounces them off
+ * the container walls. This gives exactly the same results as calling
+ * Particle::Update on every particle, but uses SSE2 or AVX2 lanes when the
+ * build has them, with masks instead of branches for the wall checks
+ * @param x the x coordinates of the particles
+ * @param y the y coordinates of the particles
+ * @param x_velocity the horizontal velocities of the particles
+ * @param y_velocity the vertical velocities of the particles
+ * @param species the species index of each particle
+ * @param species_radii the radius of each species
+ * @param count the amount of particles in the arrays
+ * @param time_step how much time passes
+ * @param x_lower_bound the left wall of the container
+ * @param y_lower_bound the top wall of the container
+ * @param x_upper_bound the right wall of the container
+ * @param y_upper_bound the bottom wall of the container
+ */
+void MoveParticles(float *x, float *y, float *x_velocity, float *y_velocity,
+                   const uint32_t *species, const double *species_radii,
+                   size_t count, float time_step,
+                   double x_lower_bound, double y_lower_bound,
+                   double x_upper_bound, double y_upper_bound);
+
+/**
+ * The same as MoveParticles, but also counts how many times a particle 
+ * bounced off a wall. Only used by instrumented builds, so the plain 
+ * version doesn't pay for the counting
+ * @return the amount of wall bounces
+ */
+size_t MoveParticlesCountingWallBounces(float *x, float *y, float *x_velocity,
+                                        float *y_velocity,
+                                        const uint32_t *species,
+                                        const double *species_radii,
+                                        size_t count,
+                                        float time_step, double x_lower_bound,
+                                        double y_lower_bound,
+                                        double x_upper_bound,
+                                        double y_upper_bound);
+
+/**
+ * The scalar version of MoveParticles. It is used for the particles left
+ * over after the SIMD lanes are filled and on machines without SIMD
+ */
+void MoveParticlesScalar(float *x, float *y, float *x_velocity,
+                         float *y_velocity, const uint32_t *species,
+                         const double *species_radii, size_t count,
+                         float time_step, double x_lower_bound,
+                         double y_lower_bound, double x_upper_bound,
+                         double y_upper_bound);
+
+/**
+ * Gets the name of the instruction set MoveParticles was built with
+ * @return "avx2", "sse2" or "scalar"
+ */
+std::string GetSimdInstructionSet();
+
+} // namespace idealgas
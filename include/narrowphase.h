@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include "particle_pair.h"
+#include "particle_store.h"
+#include "speed_change.h"
+
+namespace idealgas {
+
+/**
+ * Finds the candidate pairs whose particles overlap. Whether they are 
+ * moving toward each other is left to ResolveCollisions, since a collision
+ * earlier in the step can change that. The distance is compared squared so
+ * no square root is taken, and with AVX2 eight pairs are tested at once
+ * @param pairs the candidate pairs from the broadphase
+ * @param count the amount of candidate pairs
+ * @param particles the particles in the simulator
+ * @param colliding where the colliding pairs are written, in the same order
+ * as they were in pairs. It needs room for count pairs
+ * @return the amount of colliding pairs written
+ */
+size_t FindCollidingPairs(const ParticlePair *pairs, size_t count,
+                          const ParticleStore &particles,
+                          ParticlePair *colliding);
+
+/**
+ * The scalar version of FindCollidingPairs. It is used for the pairs left
+ * over after the SIMD lanes are filled and on machines without AVX2
+ */
+size_t FindCollidingPairsScalar(const ParticlePair *pairs, size_t count,
+                                const ParticleStore &particles,
+                                ParticlePair *colliding);
+
+/**
+ * Collides two particles if they overlap and are moving toward each other
+ * with their current velocities, and calculates their new velocities
+ * @param first the index of the first particle
+ * @param second the index of the second particle
+ * @param particles the particles in the simulator
+ * @param speed_changes where the speed of each particle that collided is 
+ * reported, or nullptr to not report them
+ * @return whether the particles collided
+ */
+bool ResolveCollision(uint32_t first, uint32_t second, 
+                      ParticleStore &particles,
+                      std::vector<SpeedChange> *speed_changes = nullptr);
+
+/**
+ * Calls ResolveCollision on each pair, one after another. Every overlapping
+ * pair is in the list, so a pair that only starts moving toward each other
+ * after an earlier collision in the list is still collided, like in the 
+ * brute force loop
+ * @param pairs the overlapping pairs from FindCollidingPairs
+ * @param count the amount of colliding pairs
+ * @param particles the particles in the simulator
+ * @param speed_changes where the speed of each particle that collided is 
+ * reported, or nullptr to not report them
+ * @return the amount of pairs that actually collided
+ */
+size_t ResolveCollisions(const ParticlePair *pairs, size_t count,
+                         ParticleStore &particles,
+                         std::vector<SpeedChange> *speed_changes = nullptr);
+
+} // namespace idealgas
@@ -1,8 +1,5 @@
 #pragma once
-#include "cinder/gl/gl.h"
-#include "cinder/app/App.h"
-#include "cinder/gl/gl.h"
-#include "../../../include/glm/glm.hpp"
+#include <glm/glm.hpp>
 #include <string>
 
 namespace idealgas {
@@ -17,14 +14,38 @@ class Particle {
   radius, double mass, const std::string& color);
   
   /**
-   * Draws the actual particle to the screen
+   * Updates the particle's position and velocity 
+   * @param time_step how much time passes, which scales how far the 
+   * particle moves
    */
-  void DrawParticle();
+  void Update(float time_step = 1);
   
   /**
-   * Updates the particle's position and velocity 
+   * Moves a particle by its velocity and bounces it off the container 
+   * walls. Update() uses this, and so does the simulator, which keeps its 
+   * particles' values in separate columns instead of Particle objects
+   * @param x the x coordinate of the particle
+   * @param y the y coordinate of the particle
+   * @param x_velocity the horizontal velocity of the particle
+   * @param y_velocity the vertical velocity of the particle
+   * @param radius the radius of the particle
+   * @param time_step how much time passes
+   */
+  static void Move(float &x, float &y, float &x_velocity, float &y_velocity,
+                   double radius, float time_step);
+  
+  /**
+   * Moves a particle like the overload above, but inside a container with 
+   * the given walls instead of the default one
+   * @param x_lower_bound the left wall of the container
+   * @param y_lower_bound the top wall of the container
+   * @param x_upper_bound the right wall of the container
+   * @param y_upper_bound the bottom wall of the container
    */
-  void Update();
+  static void Move(float &x, float &y, float &x_velocity, float &y_velocity,
+                   double radius, float time_step, double x_lower_bound,
+                   double y_lower_bound, double x_upper_bound,
+                   double y_upper_bound);
   
   /**
    * Speeds up the particle
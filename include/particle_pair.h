@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+
+namespace idealgas {
+
+/**
+ * A pair of particle indices that might be colliding. The indices are kept
+ * as 32 bits so a list of pairs is packed tightly and the SIMD narrowphase
+ * can load them straight into its lanes
+ */
+struct ParticlePair {
+  uint32_t first;
+  uint32_t second;
+
+  ParticlePair() = default;
+  ParticlePair(uint32_t first_index, uint32_t second_index)
+      : first(first_index), second(second_index) {}
+
+  bool operator<(const ParticlePair &other) const {
+    return first < other.first || (first == other.first && second <
+        other.second);
+  }
+
+  bool operator==(const ParticlePair &other) const {
+    return first == other.first && second == other.second;
+  }
+};
+
+} // namespace idealgas
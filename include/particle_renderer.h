@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include "cinder/gl/gl.h"
+#include "particle_simulator.h"
+#include "particle_store.h"
+
+namespace idealgas {
+
+/**
+ * Draws the container and the particles in it with Cinder. The simulation
+ * doesn't know about Cinder, so it can be built and run without a window.
+ * Every particle of a species is drawn with one instanced draw call: the
+ * positions are uploaded into a per-instance vertex buffer each frame and
+ * a shared circle mesh is scaled by the species radius in the shader
+ */
+class ParticleRenderer {
+ public:
+
+  /**
+   * Draws the container walls and every particle inside
+   * @param particles the particles in the simulator
+   * @param container the walls of the simulator's container
+   */
+  void Draw(const ParticleStore &particles, const Container &container);
+
+ private:
+
+  /**
+   * What it takes to draw every particle of a species. The color is parsed
+   * from its name once, when the species is first drawn
+   */
+  struct SpeciesBatch {
+    ci::ColorA color;
+    float radius = 0;
+    std::vector<glm::vec2> positions;
+    ci::gl::VboRef instances;
+    size_t capacity = 0;
+    ci::gl::BatchRef batch;
+  };
+
+  // How many segments the shared circle mesh has
+  const static int kCircleSegments = 24;
+
+  ci::gl::GlslProgRef shader_;
+  std::vector<SpeciesBatch> batches_;
+
+  /**
+   * Sets up the batch of every species that hasn't been drawn before
+   * @param particles the particles in the simulator
+   */
+  void AddSpeciesBatches(const ParticleStore &particles);
+};
+
+} // namespace idealgas
@@ -1,17 +1,113 @@
 #pragma once
+#include "continuous_collisions.h"
+#include "counter_rng.h"
+#include "event_driven_engine.h"
+#include "instrumentation.h"
 #include "particle.h"
+#include "particle_pair.h"
+#include "particle_store.h"
+#include "speed_change.h"
+#include "sort_and_sweep.h"
+#include "thread_pool.h"
+#include "uniform_grid.h"
+#include <functional>
+#include <memory>
 #include <vector>
 
 namespace idealgas {
 
+/**
+ * The different ways of finding the pairs of particles that might be 
+ * colliding before checking them with ResolveCollision
+ */
+enum class Broadphase {
+  // Checks every pair of particles. This is slow but is kept as a reference
+  kBruteForce,
+  
+  // Only checks pairs of particles in the same or neighboring grid cells
+  kUniformGrid,
+  
+  // Only checks pairs of particles whose x intervals overlap. Uses less 
+  // memory than the grid for wide or sparse containers
+  kSortAndSweep
+};
+
+/**
+ * The different ways the time stepped engine finds collisions
+ */
+enum class CollisionDetection {
+  // Moves every particle a whole step and then bounces the particles that 
+  // overlap. Velocities have to stay below the radius to avoid tunneling
+  kDiscrete,
+  
+  // Sweeps every particle over the step and resolves its contacts with 
+  // other particles and the walls at their exact times, so particles can 
+  // move at any velocity
+  kContinuous
+};
+
+/**
+ * The different ways of moving the simulation forward in time
+ */
+enum class Engine {
+  // Moves every particle by its velocity each update and then bounces the
+  // particles that overlap. Velocities have to stay below the radius so 
+  // particles don't tunnel through each other
+  kTimeStepped,
+  
+  // Jumps from one exact collision time to the next, so particles can move
+  // at any velocity. Much cheaper when collisions are rare
+  kEventDriven
+};
+
+/**
+ * The different ways AddParticles places random particles
+ */
+enum class Placement {
+  // Anywhere in the container, even on top of other particles
+  kRandom,
+  
+  // Never overlapping the other particles or the walls, using 
+  // PlaceWithoutOverlaps. Adding more particles than fit throws an error
+  kNonOverlapping
+};
+
+/**
+ * The walls of the box the particles move in, in pixels
+ */
+struct Container {
+  double x_lower_bound;
+  double y_lower_bound;
+  double x_upper_bound;
+  double y_upper_bound;
+};
+
 class ParticleSimulator {
  public:
   
   /**
-   * Updates the simulation
+   * Creates an empty simulation with a random seed
+   */
+  ParticleSimulator();
+  
+  /**
+   * Updates the simulation by one time step
    */
   void Update();
   
+  /**
+   * Advances the simulation by an amount of time, running as many whole 
+   * time steps as fit. Time that doesn't fill a whole step is kept and used 
+   * by the next call, so the simulation runs at the same speed no matter 
+   * how often this is called. If more than the maximum amount of substeps 
+   * would be needed, the extra time is dropped so a slow frame can't make 
+   * the next one even slower
+   * @param elapsed_time the time that passed, in the same units as the 
+   * time step
+   * @return the amount of time steps that were run
+   */
+  size_t Advance(double elapsed_time);
+  
   /**
    * Adds particles to the simulation that spawn at random locations with random
    * initial velocities
@@ -22,6 +118,18 @@ class ParticleSimulator {
    */
   void AddParticles(size_t amount, double radius, double mass, const std::string& color);
   
+  /**
+   * Adds particles like AddParticles, but each part of their velocity is
+   * negated half of the time, so they start moving in any direction instead
+   * of only down and to the right
+   * @param amount the amount of particles desired to add
+   * @param radius the radius of the particles added
+   * @param mass the mass of the particles added
+   * @param color the color of the particles added
+   */
+  void AddParticlesInAnyDirection(size_t amount, double radius, double mass,
+                                  const std::string &color);
+  
   /**
    * Overload method that allows user to specify the spawn location and 
    * initial velocities when adding particles
@@ -39,9 +147,52 @@ class ParticleSimulator {
                     double initial_x_vel, double initial_y_vel);
   
   /**
-   * Draws the particles onto the simulation
+   * Overload method that takes the spawn locations and initial velocities 
+   * of the particles from arrays, which is the fastest way to add a lot of
+   * particles with a known state. Every particle is checked like in the 
+   * overload above before any of them are added
+   * @param amount the amount of particles desired to add
+   * @param radius the radius of the particles added
+   * @param mass the mass of the particles added
+   * @param color the color of the particles added 
+   * @param x_coords the spawn x coordinates, one for each particle
+   * @param y_coords the spawn y coordinates, one for each particle
+   * @param x_velocities the initial horizontal velocities
+   * @param y_velocities the initial vertical velocities
+   */
+  void AddParticles(size_t amount, double radius, double mass,
+                    const std::string &color, const float *x_coords,
+                    const float *y_coords, const float *x_velocities,
+                    const float *y_velocities);
+  
+  /**
+   * Sets where AddParticles puts the particles it places randomly
+   * @param placement the placement to use from the next call on
+   */
+  void SetPlacement(Placement placement);
+  
+  Placement GetPlacement() const;
+  
+  /**
+   * Finds positions for particles that don't overlap each other, the 
+   * particles in the simulation or the walls, so they can be added with 
+   * the overload that takes arrays. Uses the same random numbers as 
+   * AddParticles
+   * @param amount the amount of positions to find
+   * @param radius the radius of the particles
+   * @param x_coords where the x coordinates are written
+   * @param y_coords where the y coordinates are written
+   * @throws std::invalid_argument if that many particles don't fit
    */
-  void Draw();
+  void FindFreePositions(size_t amount, double radius, float *x_coords,
+                         float *y_coords);
+  
+  /**
+   * Makes room for a total amount of particles up front, so adding them 
+   * in several calls doesn't have to grow the columns more than once
+   * @param amount the total amount of particles to make room for
+   */
+  void Reserve(size_t amount);
   
   /**
    * Speeds up all the particles
@@ -53,50 +204,358 @@ class ParticleSimulator {
    */
   void SlowDown();
 
-  const std::vector<Particle> &GetParticles() const;
+  /**
+   * Sets how the simulation finds the pairs of particles that might collide
+   * @param broadphase the broadphase to use from the next update on
+   */
+  void SetBroadphase(Broadphase broadphase);
+  
+  Broadphase GetBroadphase() const;
+  
+  /**
+   * Sets how many threads each update runs on. With more than one thread,
+   * the uniform grid broadphase splits the container into strips of cells 
+   * and finds, resolves and moves the particles of the strips in parallel.
+   * The results only depend on the strips, so they are the same for any 
+   * thread count above one, but the collisions are resolved in a different
+   * order than with a single thread. The other broadphases always run on one
+   * thread
+   * @param thread_count the amount of threads, or 0 to use one per core
+   */
+  void SetThreadCount(size_t thread_count);
+  
+  size_t GetThreadCount() const;
+  
+  /**
+   * Gets how many pairs of particles the last update tested for a 
+   * collision. The event driven engine doesn't test pairs each update, so 
+   * this is 0 with it
+   */
+  size_t GetCandidatePairCount() const;
+
+  /**
+   * Gets the time spent in each phase of the updates and the amount of 
+   * updates, candidate pairs, collisions and wall bounces since the last 
+   * reset. Everything is 0 unless the build defines 
+   * IDEAL_GAS_ENABLE_INSTRUMENTATION. The brute force update mixes all of 
+   * its phases in one loop, so it only records the counters
+   */
+  InstrumentationSnapshot GetInstrumentationSnapshot() const;
+  
+  /**
+   * Sets the instrumentation totals back to 0
+   */
+  void ResetInstrumentation();
+
+  /**
+   * Sets if the simulator keeps a list of the particles whose speed 
+   * changed: the ones that collide or are added, and every particle when 
+   * they are sped up or slowed down. Bouncing off a wall only flips the 
+   * sign of a velocity, so it never changes a speed. A histogram can then
+   * move just those particles between its bins instead of binning every 
+   * particle again. Turning tracking off clears the list
+   * @param tracking whether to record the speed changes
+   */
+  void SetSpeedChangeTracking(bool tracking);
+  
+  bool GetSpeedChangeTracking() const;
+  
+  /**
+   * Gets the speed changes since the list was last cleared, in the order 
+   * they happened
+   */
+  const std::vector<SpeedChange> &GetSpeedChanges() const;
+  
+  /**
+   * Empties the list of speed changes, once they have been applied
+   */
+  void ClearSpeedChanges();
+
+  /**
+   * Sets how much time each update simulates. Particles move by their 
+   * velocity times the time step, so a time step of 1 moves them by their 
+   * whole velocity like before. Smaller steps are more accurate and bigger 
+   * ones are faster. The tunneling limit on the velocities of added 
+   * particles scales with the time step
+   * @param time_step the time each update simulates, which has to be 
+   * positive
+   */
+  void SetTimeStep(double time_step);
+  
+  double GetTimeStep() const;
+  
+  /**
+   * Sets the most time steps a single call to Advance runs
+   * @param max_substeps the most time steps per call, at least 1
+   */
+  void SetMaxSubsteps(size_t max_substeps);
+  
+  size_t GetMaxSubsteps() const;
+
+  /**
+   * Sets how the time stepped engine finds collisions. The continuous mode
+   * uses its own broadphase and runs on one thread, and like the event 
+   * driven engine it doesn't limit the velocity of the particles added with
+   * AddParticles
+   * @param collision_detection the mode to use from the next update on
+   */
+  void SetCollisionDetection(CollisionDetection collision_detection);
+  
+  CollisionDetection GetCollisionDetection() const;
+
+  /**
+   * Sets how the simulation moves forward in time. Each update advances the
+   * simulation by one time step with either engine. The event driven 
+   * engine doesn't limit the velocity of the particles added with 
+   * AddParticles, but those particles may tunnel if the engine is switched
+   * back to the time stepped one
+   * @param engine the engine to use from the next update on
+   */
+  void SetEngine(Engine engine);
+  
+  Engine GetEngine() const;
+
+  /**
+   * Seeds the random positions and velocities of the particles added with 
+   * AddParticles. The same seed and the same calls always give the same 
+   * particles, so runs can be reproduced
+   * @param seed the seed, which starts the random numbers over
+   */
+  void SetSeed(uint64_t seed);
+  
+  uint64_t GetSeed() const;
+
+  /**
+   * Gets how many updates the simulation has run since it was created, 
+   * counting the ones before the checkpoint it was restored from
+   */
+  uint64_t GetStepCount() const;
+
+  /**
+   * Saves the particles, the species, the random number state, the step 
+   * count and the settings to a checkpoint file, so the run can be resumed
+   * later with LoadCheckpoint. See WriteCheckpoint for the format
+   * @param path where the checkpoint goes
+   * @throws std::runtime_error if the file can't be written
+   */
+  void SaveCheckpoint(const std::string &path) const;
+
+  /**
+   * Replaces the simulation with the one saved in a checkpoint file. The 
+   * thread count and speed change tracking are left as they are, and any 
+   * recorded speed changes are dropped, so histograms have to be filled 
+   * again afterwards
+   * @param path the checkpoint to read
+   * @throws std::runtime_error if the file can't be read
+   * @throws std::invalid_argument if the file isn't a valid checkpoint
+   */
+  void LoadCheckpoint(const std::string &path);
+
+  /**
+   * Moves the walls of the container. The particles already in it stay 
+   * where they are, so this is meant to be called before adding any
+   * @param container the new walls, see IsValidContainer
+   * @throws std::invalid_argument if the container isn't valid
+   */
+  void SetContainer(const Container &container);
+  
+  const Container &GetContainer() const;
+  
+  /**
+   * Checks that a container starts at 0 or more and leaves room for random
+   * particles on both axes. They are placed on whole pixels at least 2 
+   * pixels inside the walls, so there have to be at least 4 whole pixels 
+   * between the walls
+   */
+  static bool IsValidContainer(const Container &container);
+
+  /**
+   * Gets the particles in the simulation. The store can be indexed and 
+   * iterated like a std::vector<Particle> and converts to one
+   */
+  const ParticleStore &GetParticles() const;
   
   // Sets the window size of the GUI
   const static size_t kWindowSizeWidth = 1500;
   const static size_t kWindowSizeHeight = 800;
   
-  // These constants establish the boundaries of the inner container 
+  // These constants establish the boundaries of the default container 
   const static size_t kXLowerBound = kWindowSizeWidth * .3;
   const static size_t kXUpperBound = kWindowSizeWidth * .9;
   const static size_t kYLowerBound = kWindowSizeHeight * .1;
   const static size_t kYUpperBound = kWindowSizeHeight * .9;
 
  private:
-  std::vector<Particle> particles_;
+  ParticleStore particles_;
+  Container container_ = {kXLowerBound, kYLowerBound, kXUpperBound, 
+                          kYUpperBound};
+  Broadphase broadphase_ = Broadphase::kUniformGrid;
+  UniformGrid grid_;
+  SortAndSweep sort_and_sweep_;
+  double time_step_ = 1;
+  size_t max_substeps_ = kDefaultMaxSubsteps;
+  
+  // Time passed to Advance that hasn't been simulated yet
+  double accumulated_time_ = 0;
+  uint64_t steps_ = 0;
+  
+  CollisionDetection collision_detection_ = CollisionDetection::kDiscrete;
+  ContinuousCollisions continuous_collisions_;
+  Engine engine_ = Engine::kTimeStepped;
+  EventDrivenEngine event_engine_;
+  
+  // Set whenever the particles change outside of the event driven engine, 
+  // so it takes over the new state before its next update
+  bool event_engine_outdated_ = true;
+  
+  // Reused every frame so the broadphase and narrowphase don't allocate on 
+  // each update
+  std::vector<ParticlePair> candidate_pairs_;
+  std::vector<ParticlePair> colliding_pairs_;
+  size_t candidate_pair_count_ = 0;
+  Instrumentation instrumentation_;
+  bool speed_change_tracking_ = false;
+  std::vector<SpeedChange> speed_changes_;
   constexpr static double kMinimumVelocity = 0.5;
+  const static size_t kDefaultMaxSubsteps = 8;
+  
+  /**
+   * The work of the parallel update for one vertical strip of grid cells
+   */
+  struct Strip {
+    size_t first_column = 0;
+    size_t end_column = 0;
+    std::vector<ParticlePair> candidate_pairs;
+    std::vector<ParticlePair> colliding_pairs;
+    size_t colliding_count = 0;
+    size_t resolved_count = 0;
+    std::vector<SpeedChange> speed_changes;
+  };
+  
+  // The pool is shared between copies of the simulator. It only runs one 
+  // job at a time, so that is safe, just not any faster
+  std::shared_ptr<ThreadPool> thread_pool_;
+  std::vector<Strip> strips_;
+  
+  // The container is split into at most this many strips no matter how 
+  // many threads there are, which keeps the results independent of the 
+  // thread count
+  const static size_t kMaxStrips = 64;
+  
+  // The amount of particles each thread moves or adds at a time
+  const static size_t kMoveChunkSize = 4096;
+  
+  /**
+   * Splits a range of particles into chunks and runs a task on each of 
+   * them, on the thread pool if there is one
+   * @param count the amount of particles
+   * @param task gets the first index of a chunk and the index after its end
+   */
+  void ForEachChunk(size_t count,
+                    const std::function<void(size_t, size_t)> &task);
+
+  // Generates the random particles. Each one uses its own numbers of the
+  // sequence, picked by how many random particles came before it
+  CounterRng random_;
+  uint64_t random_particles_ = 0;
+  const static uint64_t kRandomNumbersPerParticle = 5;
+  Placement placement_ = Placement::kRandom;
 
   /**
    * Generates a random XY position in the range of the container boundaries
+   * @param particle how many random particles were generated before this one
    * @return a random XY position pair
    */
-  static std::pair<size_t, size_t> GenerateRandomXYPosition();
+  std::pair<size_t, size_t> GenerateRandomXYPosition(uint64_t particle) const;
   
   /**
    * Generates a random XY initial velocity based on the constants defined 
    * above the maximum velocity the particle should have to prevent tunneling
+   * in one time step
+   * @param particle how many random particles were generated before this one
    * @param radius the radius of the particle being generated to calculate 
+   * @param any_direction whether each part of the velocity can be negative
    * @return a pair of the random XY initial velocities
    */
-  static std::pair<double, double> GenerateRandomXYVelocity(double radius);
+  std::pair<double, double> GenerateRandomXYVelocity(uint64_t particle,
+                                                     double radius,
+                                                     bool any_direction) const;
+  
+  /**
+   * Adds particles at random or free positions with random velocities, 
+   * filling them in chunks on the thread pool
+   * @param any_direction whether each part of the velocities can be negative
+   */
+  void AddRandomParticles(size_t amount, double radius, double mass,
+                          const std::string &color, bool any_direction);
+
+  /**
+   * Checks every pair of particles for collisions with a nested loop
+   */
+  void UpdateBruteForce();
+  
+  /**
+   * Checks only the candidate pairs found by the broadphase for collisions, 
+   * filtering them with the narrowphase kernel first
+   */
+  void UpdateCandidatePairs();
+
+  /**
+   * Moves the particles with continuous collision detection
+   */
+  void UpdateContinuous();
 
   /**
-   * Checks if two particles are able to collide
-   * @param particle1 the first particle to check
-   * @param particle2 the second particle to check with
-   * @return a bool on whether or not they can collide
+   * Advances the event driven engine by one time step
+   */
+  void UpdateEventDriven();
+
+  /**
+   * Checks if particles may move faster than the tunneling limit with the 
+   * current engine and collision detection
+   */
+  bool AllowsAnyVelocity() const;
+  
+  /**
+   * Runs the uniform grid update on all the threads of the pool
+   */
+  void UpdateParallel();
+  
+  /**
+   * Moves every particle by its velocity and bounces it off the walls
+   */
+  void MoveParticles();
+  
+  /**
+   * Moves a range of particles by their velocities and bounces them off 
+   * the walls
+   * @param begin the index of the first particle to move
+   * @param count the amount of particles to move
+   * @return the amount of wall bounces, which is only counted in 
+   * instrumented builds
+   */
+  size_t MoveParticles(size_t begin, size_t count);
+
+  /**
+   * Gets where the speed changes are recorded
+   * @return the list of speed changes, or nullptr if they aren't tracked
+   */
+  std::vector<SpeedChange> *GetSpeedChangeLog();
+  
+  /**
+   * Records the particles from first to the end of the store as added, if 
+   * speed changes are tracked
+   * @param first the index of the first added particle
    */
-  bool CanCollide(const Particle& particle1, const Particle& particle2) const;
+  void RecordAddedParticles(size_t first);
   
   /**
-   * Allows the particles to collide and calculates their new velocities
-   * @param particle1 the first particle that collides 
-   * @param particle2 the second particle that collides 
+   * Sets the velocity of a particle, recording the change in its speed if 
+   * speed changes are tracked
+   * @param particle the index of the particle
+   * @param velocity the new velocity
    */
-  void Collide(Particle& particle1, Particle& particle2);
+  void SetTrackedVelocity(size_t particle, const glm::vec2 &velocity);
 
   /**
    * Overload method that allows user to specify the spawn location and 
@@ -111,8 +570,8 @@ class ParticleSimulator {
    * @param initial_y_vel the initial vertical velocity
    */
   void ValidateAddParticleArguments(double radius, double mass,
-                                    size_t x_coord,
-                                    size_t y_coord, double initial_x_vel, double 
+                                    double x_coord,
+                                    double y_coord, double initial_x_vel, double 
                                     initial_y_vel) const;
   
 };
@@ -0,0 +1,202 @@
+#pragma once
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "particle.h"
+
+namespace idealgas {
+
+/**
+ * A kind of particle. Every particle of a species has the same radius, mass
+ * and color, so they are only stored once in the species table
+ */
+struct Species {
+  double radius;
+  double mass;
+  double inverse_mass;
+  std::string color;
+};
+
+/**
+ * Stores particles as a structure of arrays. The values the simulation loops
+ * over every frame (position and velocity) are kept in their own contiguous
+ * columns so those loops don't have to pull the rest of the particle through
+ * the cache. The radius, mass and color are looked up in a small table of 
+ * species through the species index of each particle, so a particle only 
+ * takes 20 bytes. Indexing or iterating gives back Particle copies, so the 
+ * store can be used like a std::vector<Particle> by code that doesn't care 
+ * about speed
+ */
+class ParticleStore {
+ public:
+
+  /**
+   * Iterates over the store, building a Particle for each index
+   */
+  class ConstIterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef Particle value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const Particle *pointer;
+    typedef Particle reference;
+
+    ConstIterator(const ParticleStore *store, size_t index);
+
+    Particle operator*() const;
+    ConstIterator &operator++();
+    ConstIterator operator++(int);
+    bool operator==(const ConstIterator &other) const;
+    bool operator!=(const ConstIterator &other) const;
+
+   private:
+    const ParticleStore *store_;
+    size_t index_;
+  };
+
+  /**
+   * Finds the species with a radius, mass and color, adding it to the 
+   * table if there isn't one yet
+   * @param radius the radius of the species
+   * @param mass the mass of the species
+   * @param color the color of the species
+   * @return the index of the species
+   */
+  uint32_t AddSpecies(double radius, double mass, const std::string &color);
+  
+  /**
+   * Finds the species with a radius, mass and color
+   * @return the index of the species, or the amount of species if there 
+   * isn't one
+   */
+  uint32_t FindSpecies(double radius, double mass, 
+                       const std::string &color) const;
+
+  /**
+   * Adds a particle to the end of the store
+   * @param position the position of the particle
+   * @param velocity the velocity of the particle
+   * @param radius the radius of the particle
+   * @param mass the mass of the particle
+   * @param color the color of the particle
+   */
+  void AddParticle(const glm::vec2 &position, const glm::vec2 &velocity,
+                   double radius, double mass, const std::string &color);
+
+  /**
+   * Adds a particle of a species that is already in the table
+   * @param position the position of the particle
+   * @param velocity the velocity of the particle
+   * @param species the index of the particle's species
+   */
+  void AddParticle(const glm::vec2 &position, const glm::vec2 &velocity,
+                   uint32_t species);
+
+  /**
+   * Adds many particles of the same kind to the end of the store at once.
+   * Their positions and velocities start at 0 and are meant to be filled in
+   * afterwards through the columns, which can be done in parallel
+   * @param amount the amount of particles to add
+   * @param radius the radius of the particles
+   * @param mass the mass of the particles
+   * @param color the color of the particles
+   * @return the index of the first particle added
+   */
+  size_t AddParticles(size_t amount, double radius, double mass,
+                      const std::string &color);
+
+  /**
+   * Adds many particles of a species that is already in the table, like 
+   * the overload above
+   * @param amount the amount of particles to add
+   * @param species the index of the particles' species
+   * @return the index of the first particle added
+   */
+  size_t AddParticles(size_t amount, uint32_t species);
+
+  /**
+   * Adds many particles straight from columns of values, copying each 
+   * column in one go. This is how a checkpoint is restored
+   * @param amount the amount of particles to add
+   * @param x the x coordinates of the particles
+   * @param y the y coordinates of the particles
+   * @param x_velocity the x velocities of the particles
+   * @param y_velocity the y velocities of the particles
+   * @param species the species indices of the particles, which have to be 
+   * in the table already
+   * @return the index of the first particle added
+   * @throws std::invalid_argument if a species index isn't in the table
+   */
+  size_t AddParticles(size_t amount, const float *x, const float *y,
+                      const float *x_velocity, const float *y_velocity,
+                      const uint32_t *species);
+
+  /**
+   * Reserves room in every column for the given amount of particles
+   * @param amount the total amount of particles to make room for
+   */
+  void Reserve(size_t amount);
+
+  // These mirror std::vector so the store can stand in for one
+  size_t size() const;
+  bool empty() const;
+  Particle operator[](size_t index) const;
+  Particle at(size_t index) const;
+  ConstIterator begin() const;
+  ConstIterator end() const;
+
+  /**
+   * Copies every particle out of the store
+   */
+  operator std::vector<Particle>() const;
+
+  glm::vec2 GetPosition(size_t index) const;
+  glm::vec2 GetVelocity(size_t index) const;
+  void SetVelocity(size_t index, const glm::vec2 &velocity);
+  double GetRadius(size_t index) const;
+  double GetMass(size_t index) const;
+  double GetInverseMass(size_t index) const;
+  const std::string &GetColor(size_t index) const;
+  uint32_t GetSpeciesIndex(size_t index) const;
+  
+  /**
+   * Gets every species in the store, in the order they were added
+   */
+  const std::vector<Species> &GetSpecies() const;
+
+  // Direct access to the columns for the hot loops
+  float *GetX();
+  float *GetY();
+  float *GetXVelocity();
+  float *GetYVelocity();
+  const float *GetX() const;
+  const float *GetY() const;
+  const float *GetXVelocity() const;
+  const float *GetYVelocity() const;
+  const uint32_t *GetSpeciesIndices() const;
+  
+  // The columns of the species table, indexed by species
+  const double *GetSpeciesRadii() const;
+  const double *GetSpeciesInverseMasses() const;
+  const double *GetSpeciesMasses() const;
+
+ private:
+  std::vector<float> x_;
+  std::vector<float> y_;
+  std::vector<float> x_velocity_;
+  std::vector<float> y_velocity_;
+  
+  // The index is 32 bits like the particle indices, so the SIMD kernels can
+  // gather with it directly
+  std::vector<uint32_t> species_index_;
+  
+  // The species table, with the numbers also kept in their own columns for 
+  // the kernels to look up
+  std::vector<Species> species_;
+  std::vector<double> species_radius_;
+  std::vector<double> species_inverse_mass_;
+  std::vector<double> species_mass_;
+};
+
+} // namespace idealgas
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "counter_rng.h"
+#include "particle_store.h"
+
+namespace idealgas {
+
+/**
+ * Finds positions for new particles that don't overlap each other, the
+ * particles already in the store or the walls. The candidate sites are the
+ * points of a hexagonal lattice, spaced as far apart as the amount of
+ * particles allows. Sites that overlap a particle in the store are skipped
+ * with a grid lookup, the particles take random free sites and each one is
+ * then moved by a random amount that stays inside half the gap between
+ * sites. Sparse particles end up spread out randomly and dense ones close
+ * to a hexagonal packing, and everything is linear in the amount of sites
+ * and particles.
+ * @param particles the particles that are already in the container
+ * @param amount the amount of new particles
+ * @param radius the radius of the new particles
+ * @param random the generator to pick and move the sites with
+ * @param first_counter the position in the random sequence of the first
+ * new particle
+ * @param counter_stride how far apart the positions of consecutive particles
+ * are. Each particle uses the first two positions and the fifth one from
+ * its own, so the stride has to be at least 5
+ * @param x_lower_bound the left wall of the container
+ * @param y_lower_bound the top wall of the container
+ * @param x_upper_bound the right wall of the container
+ * @param y_upper_bound the bottom wall of the container
+ * @param x_coords where the x coordinates are written, with room for amount
+ * @param y_coords where the y coordinates are written, with room for amount
+ * @throws std::invalid_argument if the particles don't fit even on the
+ * densest lattice, with the packing fraction that was asked for
+ */
+void PlaceWithoutOverlaps(const ParticleStore &particles, size_t amount,
+                          double radius, const CounterRng &random,
+                          uint64_t first_counter, uint64_t counter_stride,
+                          double x_lower_bound, double y_lower_bound,
+                          double x_upper_bound, double y_upper_bound,
+                          float *x_coords, float *y_coords);
+
+} // namespace idealgas
@@ -0,0 +1,121 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "histogram.h"
+#include "particle_simulator.h"
+#include "particle_store.h"
+#include "triple_buffer.h"
+
+namespace idealgas {
+
+/**
+ * The state of the simulation at one moment, for drawing. The simulation
+ * thread fills it, so the particles and histograms always belong together
+ */
+struct SimulationSnapshot {
+  ParticleStore particles;
+  std::vector<Histogram> histograms;
+
+  // How many time steps the simulation had run
+  uint64_t steps = 0;
+};
+
+/**
+ * Runs a simulation on its own thread, in real time, and publishes a
+ * snapshot after every advance through a triple buffer. Drawing only reads
+ * the newest snapshot, so a slow frame doesn't hold back the simulation and
+ * a slow step doesn't hold back the frames. The histograms are kept up to
+ * date from the speed changes on the simulation thread, so the snapshot's
+ * bins match its particles
+ */
+class SimulationThread {
+ public:
+
+  /**
+   * Takes over a simulation. It doesn't run until Start is called
+   * @param simulator the simulation, with its particles already added
+   * @param histograms the histograms to keep filled, one for each species
+   * @param ticks_per_second how many units of simulated time pass each
+   * second
+   */
+  SimulationThread(const ParticleSimulator &simulator,
+                   const std::vector<Histogram> &histograms,
+                   double ticks_per_second);
+
+  /**
+   * Stops the simulation thread if it is running
+   */
+  ~SimulationThread();
+
+  SimulationThread(const SimulationThread &) = delete;
+  SimulationThread &operator=(const SimulationThread &) = delete;
+
+  /**
+   * Publishes the current state and starts advancing the simulation with
+   * the time that passes
+   */
+  void Start();
+
+  /**
+   * Stops advancing the simulation and waits for the thread to end
+   */
+  void Stop();
+
+  /**
+   * Runs a change to the simulation on the simulation thread, before its
+   * next advance, like speeding up the particles
+   * @param command the change to make
+   */
+  void Post(const std::function<void(ParticleSimulator &)> &command);
+
+  /**
+   * Gets the newest published snapshot. It stays valid and unchanged until
+   * the next call, and only one thread may call this
+   * @throws the exception the simulation thread stopped with, if it threw
+   */
+  const SimulationSnapshot &GetLatestSnapshot();
+
+ private:
+  ParticleSimulator simulator_;
+  std::vector<Histogram> histograms_;
+  double ticks_per_second_;
+  uint64_t steps_ = 0;
+  TripleBuffer<SimulationSnapshot> snapshots_;
+
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+
+  // Guards the commands posted from other threads
+  std::mutex command_mutex_;
+  std::vector<std::function<void(ParticleSimulator &)>> commands_;
+
+  // Guards the exception the simulation thread stopped with
+  std::mutex error_mutex_;
+  std::exception_ptr error_;
+
+  // How long the thread sleeps when not enough time passed for a step
+  const static int kIdleMicroseconds = 500;
+
+  /**
+   * Advances the simulation until it is stopped
+   */
+  void Run();
+
+  /**
+   * Runs the posted commands, on the simulation thread
+   */
+  void RunCommands();
+
+  /**
+   * Copies the particles and histograms into the write buffer and
+   * publishes it
+   */
+  void PublishSnapshot();
+};
+
+} // namespace idealgas
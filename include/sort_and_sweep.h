@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include "particle_pair.h"
+#include "particle_store.h"
+
+namespace idealgas {
+
+/**
+ * A sort and sweep broadphase for collision detection. The particles are
+ * kept sorted by the left edge of their x interval (position - radius), and
+ * a sweep over that order only reports pairs whose x intervals overlap.
+ * Unlike a grid it doesn't need any memory for empty space, so it works
+ * well for wide or sparse containers
+ */
+class SortAndSweep {
+ public:
+
+  /**
+   * Finds every pair of particles whose x intervals overlap. Each pair is
+   * only reported once with the smaller index first
+   * @param particles the list of particles in the simulator
+   * @param pairs the list the candidate pairs are written to. It is cleared
+   * first so the same vector can be reused every frame
+   */
+  void FindCandidatePairs(const ParticleStore &particles,
+                          std::vector<ParticlePair> &pairs);
+
+  /**
+   * Gets the particle indices in the order of the last sweep
+   */
+  const std::vector<size_t> &GetOrder() const;
+
+ private:
+
+  // The particle indices sorted by the left edge of their interval. This is
+  // kept between frames since particles only move a little each frame, so
+  // it is almost sorted already when the next sweep starts
+  std::vector<size_t> order_;
+  std::vector<double> min_x_;
+  std::vector<double> max_x_;
+
+  /**
+   * Sorts order_ by the left edge of the intervals with an insertion sort,
+   * which takes close to linear time when the order is almost the same as
+   * the last frame
+   */
+  void SortIntervals();
+};
+
+} // namespace idealgas
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace idealgas {
+
+/**
+ * A particle whose speed changed, so a histogram can move it from the bin
+ * of its old speed to the bin of its new one without looking at every
+ * other particle
+ */
+struct SpeedChange {
+  uint32_t particle;
+
+  // kNoSpeed for a particle that was just added
+  float old_speed;
+  float new_speed;
+};
+
+// The old speed of particles that didn't exist before the change
+const float kNoSpeed = -1;
+
+/**
+ * Gets the speed a histogram bins a velocity by. Everything that bins or
+ * reports speeds goes through here, so the same velocity always lands in
+ * the same bin
+ */
+inline float GetSpeed(float x_velocity, float y_velocity) {
+  return glm::length(glm::vec2(x_velocity, y_velocity));
+}
+
+/**
+ * Adds a speed change to a list, unless the speed stayed the same
+ * @param speed_changes the list, or nullptr if nothing is recorded
+ * @param particle the index of the particle
+ * @param old_speed the speed before the change
+ * @param new_speed the speed after the change
+ */
+inline void RecordSpeedChange(std::vector<SpeedChange> *speed_changes,
+                              uint32_t particle, float old_speed,
+                              float new_speed) {
+  if (speed_changes != nullptr && old_speed != new_speed) {
+    speed_changes->push_back({particle, old_speed, new_speed});
+  }
+}
+
+} // namespace idealgas
@@ -0,0 +1,68 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include "cinder/Font.h"
+#include "cinder/gl/gl.h"
+
+namespace idealgas {
+
+/**
+ * Draws text with Cinder, rasterizing each distinct string into a texture
+ * only the first time it is drawn. ci::gl::drawStringCentered builds a font
+ * and rasterizes the string again on every call, which cost more than
+ * drawing the particles. A label that changes, like a particle count, is
+ * rasterized again only when its text is new
+ */
+class TextCache {
+ public:
+
+  /**
+   * Creates a cache for one font. The font itself is only loaded the first
+   * time something is drawn
+   * @param font_name the name of the font
+   * @param font_size the size of the font
+   */
+  TextCache(const std::string &font_name, float font_size);
+
+  /**
+   * Draws a string centered horizontally on a point, like
+   * ci::gl::drawStringCentered
+   * @param text the string to draw
+   * @param position the point the baseline of the text is centered on
+   * @param color the color of the text
+   */
+  void DrawCentered(const std::string &text, const glm::vec2 &position,
+                    const ci::ColorA &color);
+
+  /**
+   * Gets the amount of strings that have a texture
+   */
+  size_t size() const;
+
+ private:
+
+  /**
+   * A string rasterized in white, so it can be drawn in any color
+   */
+  struct Entry {
+    ci::gl::Texture2dRef texture;
+    float baseline_offset;
+  };
+
+  // Strings that stop being drawn keep their texture, so the cache is
+  // emptied when it gets this big instead of growing without end
+  const static size_t kMaxEntries = 256;
+
+  std::string font_name_;
+  float font_size_;
+  ci::Font font_;
+  bool font_loaded_ = false;
+  std::unordered_map<std::string, Entry> entries_;
+
+  /**
+   * Gets the texture of a string, rasterizing it if it isn't cached yet
+   */
+  const Entry &FindEntry(const std::string &text);
+};
+
+} // namespace idealgas
@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace idealgas {
+
+/**
+ * A pool of worker threads that stay alive between jobs, so splitting each
+ * simulation step across threads doesn't pay for starting new threads
+ */
+class ThreadPool {
+ public:
+
+  /**
+   * Starts the worker threads
+   * @param thread_count the amount of threads that run a job, counting the
+   * thread that calls ParallelFor
+   */
+  explicit ThreadPool(size_t thread_count);
+
+  /**
+   * Stops and joins the worker threads
+   */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /**
+   * Runs task(index) for every index from 0 up to count, spread across the
+   * workers and the calling thread, and returns once all of them finished.
+   * If a task throws, the first exception is rethrown here
+   * @param count the amount of tasks
+   * @param task the function to run for each index
+   */
+  void ParallelFor(size_t count, const std::function<void(size_t)> &task);
+
+  size_t GetThreadCount() const;
+
+ private:
+  std::vector<std::thread> workers_;
+
+  // Guards the fields below that describe the current job
+  std::mutex mutex_;
+  std::condition_variable work_ready_;
+  std::condition_variable work_done_;
+  const std::function<void(size_t)> *task_ = nullptr;
+  size_t task_count_ = 0;
+  size_t busy_workers_ = 0;
+  size_t generation_ = 0;
+  bool stopping_ = false;
+  std::exception_ptr error_;
+
+  // Only one job runs at a time if the pool is shared
+  std::mutex job_mutex_;
+  std::atomic<size_t> next_task_;
+
+  /**
+   * Waits for jobs and helps run them until the pool is destroyed
+   */
+  void WorkerLoop();
+
+  /**
+   * Takes tasks of the current job until there are none left
+   */
+  void RunTasks();
+};
+
+} // namespace idealgas
@@ -0,0 +1,196 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "particle_store.h"
+
+namespace idealgas {
+
+/**
+ * What the trajectory writer does with a frame when every slot of its ring
+ * buffer is still waiting to be written
+ */
+enum class OverflowPolicy {
+  // Waits for the writer thread to free a slot, so no frame is lost but
+  // the simulation slows down to the speed of the disk
+  kBlock,
+
+  // Drops the new frame and counts it, so the simulation never waits
+  kDrop
+};
+
+/**
+ * How a trajectory is buffered and encoded
+ */
+struct TrajectoryOptions {
+  // The amount of frames the ring buffer holds
+  size_t buffer_frames = 8;
+
+  // Positions and velocities are rounded to multiples of these, so each
+  // value read back is at most half of its resolution off
+  double position_resolution = 1.0 / 64;
+  double velocity_resolution = 1.0 / 1024;
+
+  // Every this many frames is stored whole instead of as the change from
+  // the frame before, so a damaged frame only spoils the frames until the
+  // next whole one
+  size_t keyframe_interval = 100;
+
+  OverflowPolicy overflow_policy = OverflowPolicy::kBlock;
+};
+
+/**
+ * The positions and velocities of every particle at one step
+ */
+struct TrajectoryFrame {
+  uint64_t step = 0;
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> x_velocity;
+  std::vector<float> y_velocity;
+};
+
+/**
+ * Streams the trajectory of a simulation to a file without holding up the
+ * simulation. AddFrame only copies the columns into a free slot of a ring
+ * buffer allocated up front, and a background thread encodes and writes
+ * the frames in order. Each value is rounded to its resolution and stored
+ * as the change from the same particle's value in the frame before, as a
+ * variable length integer, so slow particles take a byte or two instead of
+ * four. If the disk falls behind, the overflow policy decides whether the
+ * simulation waits or frames are dropped
+ */
+class TrajectoryWriter {
+ public:
+
+  /**
+   * Creates the file and starts the writer thread
+   * @param path where the trajectory goes
+   * @param particle_count how many particles the frames will have, which
+   * the ring buffer is allocated for
+   * @param options how the frames are buffered and encoded
+   * @throws std::invalid_argument if an option is out of range
+   * @throws std::runtime_error if the file can't be created
+   */
+  TrajectoryWriter(const std::string &path, size_t particle_count,
+                   const TrajectoryOptions &options = TrajectoryOptions());
+
+  /**
+   * Writes the frames still in the buffer and stops the writer thread.
+   * Errors are only reported by Close, so call it to find out about them
+   */
+  ~TrajectoryWriter();
+
+  TrajectoryWriter(const TrajectoryWriter &) = delete;
+  TrajectoryWriter &operator=(const TrajectoryWriter &) = delete;
+
+  /**
+   * Copies the positions and velocities of the particles into the ring
+   * buffer to be written. Only one thread may add frames
+   * @param particles the particles of the simulation
+   * @param step the step the simulation is at
+   * @return whether the frame was kept, which is only false when it was
+   * dropped by the overflow policy
+   * @throws the exception the writer thread stopped with, if it threw
+   */
+  bool AddFrame(const ParticleStore &particles, uint64_t step);
+
+  /**
+   * Writes the frames still in the buffer, stops the writer thread and
+   * closes the file. Frames can't be added afterwards
+   * @throws the exception the writer thread stopped with, if it threw
+   */
+  void Close();
+
+  uint64_t GetWrittenFrameCount() const;
+  uint64_t GetDroppedFrameCount() const;
+
+  /**
+   * Gets how many bytes were written to the file so far
+   */
+  uint64_t GetWrittenBytes() const;
+
+ private:
+  TrajectoryOptions options_;
+  std::ofstream output_;
+
+  // The ring buffer. Slots from first_ on, wrapping around, hold count_
+  // frames waiting to be written
+  std::vector<TrajectoryFrame> slots_;
+  size_t first_ = 0;
+  size_t count_ = 0;
+  bool closing_ = false;
+  std::mutex mutex_;
+  std::condition_variable frame_added_;
+  std::condition_variable slot_freed_;
+  std::exception_ptr error_;
+  std::thread thread_;
+
+  std::atomic<uint64_t> written_frames_{0};
+  std::atomic<uint64_t> dropped_frames_{0};
+  std::atomic<uint64_t> written_bytes_{0};
+
+  // Only used by the writer thread. The rounded values of the last frame
+  // written, which the next frame is stored as the change from
+  std::vector<int64_t> previous_;
+  std::vector<uint8_t> encoded_;
+
+  /**
+   * Writes frames as they come until the writer is closed
+   */
+  void Run();
+
+  /**
+   * Encodes a frame and writes it to the file
+   */
+  void WriteFrame(const TrajectoryFrame &frame);
+
+  /**
+   * Throws the exception the writer thread stopped with, if there is one.
+   * The mutex has to be held
+   */
+  void RethrowError();
+};
+
+/**
+ * Reads back the frames of a trajectory written by TrajectoryWriter, in
+ * order
+ */
+class TrajectoryReader {
+ public:
+
+  /**
+   * Opens a trajectory and reads its header
+   * @param path the trajectory to read
+   * @throws std::runtime_error if the file can't be opened
+   * @throws std::invalid_argument if the file isn't a trajectory of this
+   * version
+   */
+  explicit TrajectoryReader(const std::string &path);
+
+  /**
+   * Reads the next frame
+   * @param frame where the frame is decoded into, reusing its memory
+   * @return whether there was another frame
+   * @throws std::invalid_argument if the frame is cut short or damaged
+   */
+  bool ReadFrame(TrajectoryFrame *frame);
+
+  double GetPositionResolution() const;
+  double GetVelocityResolution() const;
+
+ private:
+  std::ifstream input_;
+  double position_resolution_ = 0;
+  double velocity_resolution_ = 0;
+  std::vector<int64_t> previous_;
+  std::vector<uint8_t> encoded_;
+};
+
+} // namespace idealgas
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace idealgas {
+
+/**
+ * Hands values from one writer thread to one reader thread without locks.
+ * The writer fills its own buffer and publishes it, the reader takes the
+ * newest published buffer, and the third buffer holds the value in between.
+ * Neither thread ever waits for the other or sees a half written value, and
+ * values published faster than they are read are skipped. The buffers are
+ * reused, so values that keep their memory, like vectors, don't allocate
+ * once they are big enough
+ */
+template <typename T>
+class TripleBuffer {
+ public:
+
+  /**
+   * Gets the buffer the writer fills. It belongs to the writer until it is
+   * published
+   */
+  T &GetWriteBuffer() {
+    return buffers_[write_];
+  }
+
+  /**
+   * Makes the write buffer the newest value, and gives the writer the
+   * buffer that was in between to fill next. Only the writer calls this
+   */
+  void Publish() {
+    write_ = middle_.exchange((uint8_t) (write_ | kFresh),
+                              std::memory_order_acq_rel) & kIndex;
+  }
+
+  /**
+   * Takes the newest published value if there is one the reader hasn't
+   * seen. Only the reader calls this
+   * @return whether there was a new value
+   */
+  bool Update() {
+    if ((middle_.load(std::memory_order_acquire) & kFresh) == 0) {
+      return false;
+    }
+    read_ = middle_.exchange(read_, std::memory_order_acq_rel) & kIndex;
+    return true;
+  }
+
+  /**
+   * Gets the value the reader last took. It stays the same until the next
+   * Update
+   */
+  const T &GetReadBuffer() const {
+    return buffers_[read_];
+  }
+
+ private:
+
+  // The middle buffer's index is kept with a flag that is set when it
+  // holds a value the reader hasn't taken yet
+  const static uint8_t kIndex = 3;
+  const static uint8_t kFresh = 4;
+
+  T buffers_[3];
+  uint8_t write_ = 0;
+  std::atomic<uint8_t> middle_{1};
+  uint8_t read_ = 2;
+};
+
+} // namespace idealgas
@@ -0,0 +1,88 @@
+#pragma once
+#include <vector>
+#include "particle_pair.h"
+#include "particle_store.h"
+
+namespace idealgas {
+
+/**
+ * A uniform cell list used as a broadphase for collision detection. The
+ * particles are bucketed into square cells that are at least as wide as the
+ * largest particle diameter, so two particles can only be touching if they
+ * are in the same cell or in neighboring cells
+ */
+class UniformGrid {
+ public:
+
+  /**
+   * Buckets all the particles into the cells of the grid
+   * @param particles the list of particles in the simulator
+   * @param x_lower_bound the left wall of the container
+   * @param y_lower_bound the top wall of the container
+   * @param x_upper_bound the right wall of the container
+   * @param y_upper_bound the bottom wall of the container
+   */
+  void Build(const ParticleStore &particles, double x_lower_bound,
+             double y_lower_bound, double x_upper_bound,
+             double y_upper_bound);
+
+  /**
+   * Finds every pair of particles that are in the same or neighboring cells.
+   * Each pair is only reported once with the smaller index first
+   * @param pairs the list the candidate pairs are written to. It is cleared
+   * first so the same vector can be reused every frame
+   */
+  void FindCandidatePairs(std::vector<ParticlePair> &pairs) const;
+
+  /**
+   * Finds the candidate pairs that have at least one particle in the given 
+   * columns of cells. Pairs are only found from a cell toward the cells on 
+   * its right and below it, so every pair found here has its particles in 
+   * these columns or the column right after them
+   * @param first_column the first column to look at
+   * @param end_column the column after the last one to look at
+   * @param pairs the list the candidate pairs are written to. It is cleared
+   * first so the same vector can be reused every frame
+   */
+  void FindCandidatePairs(size_t first_column, size_t end_column,
+                          std::vector<ParticlePair> &pairs) const;
+
+  double GetCellSize() const;
+  size_t GetColumns() const;
+  size_t GetRows() const;
+
+ private:
+  double cell_size_ = 0;
+  size_t columns_ = 0;
+  size_t rows_ = 0;
+
+  // The particles are stored sorted by cell. The particles of cell c are
+  // found in cell_particles_ from cell_start_[c] up to cell_start_[c + 1]
+  std::vector<size_t> cell_start_;
+  std::vector<size_t> cell_particles_;
+  std::vector<size_t> particle_cells_;
+  std::vector<size_t> cell_fill_;
+
+  // Caps the number of cells so that tiny particles in a big container
+  // don't allocate a huge amount of mostly empty cells
+  const static size_t kMaxCellsPerParticle = 4;
+
+  /**
+   * Adds a pair to the list with the smaller index first
+   */
+  void AddPair(size_t particle1, size_t particle2,
+               std::vector<ParticlePair> &pairs) const;
+
+  /**
+   * Finds the cell index along one axis for a coordinate, clamping
+   * particles that are slightly outside the container into the border cells
+   * @param coordinate the x or y coordinate of the particle
+   * @param lower_bound the lower bound of the container along that axis
+   * @param cells the number of cells along that axis
+   * @return the cell index along that axis
+   */
+  size_t FindCellIndex(double coordinate, double lower_bound,
+                       size_t cells) const;
+};
+
+} // namespace idealgas
@@ -0,0 +1,743 @@
+#include <batch_runner.h>
+#include <histogram.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace idealgas {
+
+namespace {
+
+/**
+ * Reads a whole string as a finite number, throwing if anything is left 
+ * over. std::stod reads "nan" and "inf" too, so those are turned away here
+ */
+double ParseNumber(const std::string &text, const std::string &option) {
+  size_t length = 0;
+  double value;
+  try {
+    value = std::stod(text, &length);
+  } catch (const std::exception &) {
+    length = 0;
+  }
+  if (length == 0 || length != text.size() || !std::isfinite(value)) {
+    throw std::invalid_argument("Please make sure " + option + 
+                                " is a number, not \"" + text + "\"!");
+  }
+  return value;
+}
+
+/**
+ * Reads a whole string of digits as a number no bigger than max. Only 
+ * digits are taken, since std::stoull would wrap a leading minus sign around
+ */
+uint64_t ParseWholeNumber(const std::string &text, const std::string &option,
+                          uint64_t max) {
+  bool valid = !text.empty() && 
+      text.find_first_not_of("0123456789") == std::string::npos;
+  uint64_t value = 0;
+  if (valid) {
+    try {
+      value = std::stoull(text);
+    } catch (const std::out_of_range &) {
+      valid = false;
+    }
+  }
+  if (!valid || value > max) {
+    throw std::invalid_argument("Please make sure " + option + 
+                                " is a whole number from 0 to " + 
+                                std::to_string(max) + "!");
+  }
+  return value;
+}
+
+size_t ParseCount(const std::string &text, const std::string &option) {
+  return (size_t) ParseWholeNumber(text, option, 
+                                   std::numeric_limits<size_t>::max());
+}
+
+/**
+ * Checks that a species has a radius and mass of at least 0.1, like 
+ * ParticleSimulator::ValidateAddParticleArguments. Written so that NaN 
+ * fails too
+ */
+void CheckSpecies(const SpeciesOptions &species) {
+  if (!(species.radius >= 0.1)) {
+    throw std::invalid_argument("Please make sure the radius of each "
+                                "species is at least 0.1!");
+  } else if (!(species.mass >= 0.1)) {
+    throw std::invalid_argument("Please make sure the mass of each species "
+                                "is at least 0.1!");
+  }
+}
+
+/**
+ * Reads a species written as COUNT:RADIUS:MASS or COUNT:RADIUS:MASS:COLOR
+ */
+SpeciesOptions ParseSpecies(const std::string &text) {
+  std::vector<std::string> fields;
+  std::stringstream stream(text);
+  std::string field;
+  while (std::getline(stream, field, ':')) {
+    fields.push_back(field);
+  }
+  if (fields.size() < 3 || fields.size() > 4) {
+    throw std::invalid_argument("Please write each species as "
+                                "COUNT:RADIUS:MASS[:COLOR], not \"" + text +
+                                "\"!");
+  }
+  
+  SpeciesOptions species;
+  species.count = ParseCount(fields[0], "the species count");
+  species.radius = ParseNumber(fields[1], "the species radius");
+  species.mass = ParseNumber(fields[2], "the species mass");
+  if (fields.size() == 4) {
+    species.color = fields[3];
+  }
+  CheckSpecies(species);
+  return species;
+}
+
+Engine ParseEngine(const std::string &value) {
+  if (value == "time-stepped") {
+    return Engine::kTimeStepped;
+  } else if (value == "event-driven") {
+    return Engine::kEventDriven;
+  }
+  throw std::invalid_argument("Please make sure the engine is "
+                              "time-stepped or event-driven!");
+}
+
+CollisionDetection ParseCollisionDetection(const std::string &value) {
+  if (value == "discrete") {
+    return CollisionDetection::kDiscrete;
+  } else if (value == "continuous") {
+    return CollisionDetection::kContinuous;
+  }
+  throw std::invalid_argument("Please make sure the collisions are "
+                              "discrete or continuous!");
+}
+
+Broadphase ParseBroadphase(const std::string &value) {
+  if (value == "grid") {
+    return Broadphase::kUniformGrid;
+  } else if (value == "sweep") {
+    return Broadphase::kSortAndSweep;
+  } else if (value == "brute-force") {
+    return Broadphase::kBruteForce;
+  }
+  throw std::invalid_argument("Please make sure the broadphase is "
+                              "grid, sweep or brute-force!");
+}
+
+Placement ParsePlacement(const std::string &value) {
+  if (value == "random") {
+    return Placement::kRandom;
+  } else if (value == "non-overlapping") {
+    return Placement::kNonOverlapping;
+  }
+  throw std::invalid_argument("Please make sure the placement is "
+                              "random or non-overlapping!");
+}
+
+OverflowPolicy ParseOverflowPolicy(const std::string &value) {
+  if (value == "block") {
+    return OverflowPolicy::kBlock;
+  } else if (value == "drop") {
+    return OverflowPolicy::kDrop;
+  }
+  throw std::invalid_argument("Please make sure the trajectory overflow is "
+                              "block or drop!");
+}
+
+/**
+ * Throws if a scenario object has a key that isn't one of the known ones, 
+ * so a misspelled setting isn't silently left at its default
+ */
+void CheckScenarioKeys(const nlohmann::json &object, const std::string &name,
+                       const std::vector<std::string> &keys) {
+  if (!object.is_object()) {
+    throw std::invalid_argument("Please make sure " + name + 
+                                " is a JSON object!");
+  }
+  for (nlohmann::json::const_iterator it = object.begin(); 
+       it != object.end(); ++it) {
+    if (std::find(keys.begin(), keys.end(), it.key()) == keys.end()) {
+      throw std::invalid_argument("Unknown setting " + it.key() + " in " + 
+                                  name + "!");
+    }
+  }
+}
+
+/**
+ * Reads a number from a scenario object, or gives back the fallback if the
+ * key isn't there
+ */
+double ReadNumber(const nlohmann::json &object, const std::string &key,
+                  double fallback) {
+  if (!object.contains(key)) {
+    return fallback;
+  }
+  if (!object[key].is_number()) {
+    throw std::invalid_argument("Please make sure " + key + 
+                                " is a number!");
+  }
+  return object[key].get<double>();
+}
+
+uint64_t ReadWholeNumber(const nlohmann::json &object, const std::string &key,
+                         uint64_t fallback, uint64_t max) {
+  if (!object.contains(key)) {
+    return fallback;
+  }
+  
+  // Numbers parsed from text are unsigned when they aren't negative, but 
+  // ones built in code are signed, so both are taken
+  if (!object[key].is_number_integer() || 
+      (!object[key].is_number_unsigned() && object[key].get<int64_t>() < 0) ||
+      object[key].get<uint64_t>() > max) {
+    throw std::invalid_argument("Please make sure " + key + 
+                                " is a whole number from 0 to " + 
+                                std::to_string(max) + "!");
+  }
+  return object[key].get<uint64_t>();
+}
+
+size_t ReadCount(const nlohmann::json &object, const std::string &key,
+                 size_t fallback) {
+  return (size_t) ReadWholeNumber(object, key, fallback, 
+                                  std::numeric_limits<size_t>::max());
+}
+
+std::string ReadString(const nlohmann::json &object, const std::string &key,
+                       const std::string &fallback) {
+  if (!object.contains(key)) {
+    return fallback;
+  }
+  if (!object[key].is_string()) {
+    throw std::invalid_argument("Please make sure " + key + 
+                                " is a string!");
+  }
+  return object[key].get<std::string>();
+}
+
+} // namespace
+
+BatchOptions ParseBatchOptions(const std::vector<std::string> &arguments) {
+  
+  // The scenario is read first wherever it is given, so every other option 
+  // changes it instead of being replaced by it
+  std::string scenario_path;
+  for (size_t i = 0; i + 1 < arguments.size(); i += 2) {
+    if (arguments[i] == "--scenario") {
+      if (!scenario_path.empty()) {
+        throw std::invalid_argument("Please give only one --scenario!");
+      }
+      scenario_path = arguments[i + 1];
+    }
+  }
+  BatchOptions options;
+  if (!scenario_path.empty()) {
+    options = LoadScenario(scenario_path);
+  }
+  
+  for (size_t i = 0; i < arguments.size(); i++) {
+    const std::string &option = arguments[i];
+    if (i + 1 == arguments.size()) {
+      throw std::invalid_argument("Please give a value for " + option + "!");
+    }
+    const std::string &value = arguments[++i];
+    
+    if (option == "--scenario") {
+      continue;
+    } else if (option == "--species") {
+      options.species.push_back(ParseSpecies(value));
+    } else if (option == "--steps") {
+      options.steps = ParseCount(value, option);
+    } else if (option == "--seed") {
+      options.seed = ParseWholeNumber(value, option, 
+                                      std::numeric_limits<uint64_t>::max());
+      options.has_seed = true;
+    } else if (option == "--threads") {
+      options.thread_count = ParseCount(value, option);
+    } else if (option == "--time-step") {
+      options.time_step = ParseNumber(value, option);
+    } else if (option == "--engine") {
+      options.engine = ParseEngine(value);
+    } else if (option == "--collisions") {
+      options.collision_detection = ParseCollisionDetection(value);
+    } else if (option == "--broadphase") {
+      options.broadphase = ParseBroadphase(value);
+    } else if (option == "--placement") {
+      options.placement = ParsePlacement(value);
+    } else if (option == "--stats") {
+      options.statistics_path = value;
+    } else if (option == "--particles") {
+      options.particles_path = value;
+    } else if (option == "--checkpoint") {
+      options.checkpoint_path = value;
+    } else if (option == "--checkpoint-every") {
+      options.checkpoint_interval = ParseCount(value, option);
+    } else if (option == "--resume") {
+      options.resume_path = value;
+    } else if (option == "--trajectory") {
+      options.trajectory_path = value;
+    } else if (option == "--trajectory-every") {
+      options.trajectory_interval = ParseCount(value, option);
+    } else if (option == "--trajectory-overflow") {
+      options.trajectory_overflow = ParseOverflowPolicy(value);
+    } else {
+      throw std::invalid_argument("Unknown option " + option + "!");
+    }
+  }
+  
+  if (options.species.empty() && options.resume_path.empty()) {
+    throw std::invalid_argument("Please add at least one species!");
+  }
+  if (options.checkpoint_interval > 0 && options.checkpoint_path.empty()) {
+    throw std::invalid_argument("Please give a --checkpoint path to write "
+                                "the checkpoints to!");
+  }
+  if (options.trajectory_interval == 0) {
+    throw std::invalid_argument("Please make sure --trajectory-every is at "
+                                "least 1!");
+  }
+  return options;
+}
+
+BatchOptions ParseScenario(const nlohmann::json &scenario) {
+  CheckScenarioKeys(scenario, "the scenario", {
+      "species", "container", "seed", "steps", "threads", "time_step", 
+      "engine", "collisions", "broadphase", "placement", "output"});
+  
+  BatchOptions options;
+  if (scenario.contains("species")) {
+    if (!scenario["species"].is_array()) {
+      throw std::invalid_argument("Please make sure species is a list!");
+    }
+    for (const nlohmann::json &kind : scenario["species"]) {
+      CheckScenarioKeys(kind, "a species", 
+                        {"count", "radius", "mass", "color"});
+      SpeciesOptions species;
+      species.count = ReadCount(kind, "count", species.count);
+      species.radius = ReadNumber(kind, "radius", species.radius);
+      species.mass = ReadNumber(kind, "mass", species.mass);
+      species.color = ReadString(kind, "color", species.color);
+      CheckSpecies(species);
+      options.species.push_back(species);
+    }
+  }
+  if (options.species.empty()) {
+    throw std::invalid_argument("Please add at least one species!");
+  }
+  
+  if (scenario.contains("container")) {
+    const nlohmann::json &container = scenario["container"];
+    CheckScenarioKeys(container, "the container", 
+                      {"left", "top", "right", "bottom"});
+    options.container.x_lower_bound = ReadNumber(
+        container, "left", options.container.x_lower_bound);
+    options.container.y_lower_bound = ReadNumber(
+        container, "top", options.container.y_lower_bound);
+    options.container.x_upper_bound = ReadNumber(
+        container, "right", options.container.x_upper_bound);
+    options.container.y_upper_bound = ReadNumber(
+        container, "bottom", options.container.y_upper_bound);
+    if (!ParticleSimulator::IsValidContainer(options.container)) {
+      throw std::invalid_argument("Please make sure the container starts at "
+                                  "0 or more and is at least 4 pixels wide "
+                                  "and tall!");
+    }
+  }
+  
+  // Checked here as well as when the particles are added, so the app can
+  // fall back to its defaults instead
+  const Container &walls = options.container;
+  for (const SpeciesOptions &species : options.species) {
+    if (2 * species.radius > walls.x_upper_bound - walls.x_lower_bound ||
+        2 * species.radius > walls.y_upper_bound - walls.y_lower_bound) {
+      throw std::invalid_argument("Please make sure the particles fit in the "
+                                  "container!");
+    }
+  }
+  
+  if (scenario.contains("seed")) {
+    options.seed = ReadWholeNumber(scenario, "seed", options.seed, 
+                                   std::numeric_limits<uint64_t>::max());
+    options.has_seed = true;
+  }
+  options.steps = ReadCount(scenario, "steps", options.steps);
+  options.thread_count = ReadCount(scenario, "threads", 
+                                   options.thread_count);
+  options.time_step = ReadNumber(scenario, "time_step", options.time_step);
+  if (scenario.contains("engine")) {
+    options.engine = ParseEngine(ReadString(scenario, "engine", ""));
+  }
+  if (scenario.contains("collisions")) {
+    options.collision_detection = ParseCollisionDetection(
+        ReadString(scenario, "collisions", ""));
+  }
+  if (scenario.contains("broadphase")) {
+    options.broadphase = ParseBroadphase(
+        ReadString(scenario, "broadphase", ""));
+  }
+  if (scenario.contains("placement")) {
+    options.placement = ParsePlacement(ReadString(scenario, "placement", ""));
+  }
+  
+  if (scenario.contains("output")) {
+    const nlohmann::json &output = scenario["output"];
+    CheckScenarioKeys(output, "the output", 
+                      {"stats", "particles", "checkpoint", 
+                       "checkpoint_every", "trajectory", "trajectory_every",
+                       "trajectory_overflow"});
+    options.statistics_path = ReadString(output, "stats", 
+                                         options.statistics_path);
+    options.particles_path = ReadString(output, "particles", 
+                                        options.particles_path);
+    options.checkpoint_path = ReadString(output, "checkpoint", 
+                                         options.checkpoint_path);
+    options.checkpoint_interval = ReadCount(output, "checkpoint_every", 
+                                            options.checkpoint_interval);
+    options.trajectory_path = ReadString(output, "trajectory", 
+                                         options.trajectory_path);
+    options.trajectory_interval = ReadCount(output, "trajectory_every", 
+                                            options.trajectory_interval);
+    if (options.trajectory_interval == 0) {
+      throw std::invalid_argument("Please make sure trajectory_every is at "
+                                  "least 1!");
+    }
+    if (output.contains("trajectory_overflow")) {
+      options.trajectory_overflow = ParseOverflowPolicy(
+          ReadString(output, "trajectory_overflow", ""));
+    }
+  }
+  return options;
+}
+
+BatchOptions LoadScenario(const std::string &path) {
+  std::ifstream input(path);
+  if (!input) {
+    throw std::runtime_error("Could not open " + path);
+  }
+  
+  nlohmann::json scenario;
+  try {
+    input >> scenario;
+  } catch (const nlohmann::json::exception &error) {
+    throw std::invalid_argument("Please make sure " + path + 
+                                " is valid JSON! " + error.what());
+  }
+  return ParseScenario(scenario);
+}
+
+std::string GetBatchUsage() {
+  return "Usage: ideal-gas-batch --species COUNT:RADIUS:MASS[:COLOR] ...\n"
+         "  --scenario PATH                      reads the options from a "
+         "JSON\n"
+         "                                       scenario first, with the "
+         "other\n"
+         "                                       options changing it "
+         "wherever they\n"
+         "                                       are given, and --species "
+         "adding to\n"
+         "                                       its species\n"
+         "  --species COUNT:RADIUS:MASS[:COLOR]  adds a kind of particle, "
+         "can be repeated\n"
+         "  --steps N                            time steps to run (1000)\n"
+         "  --seed N                             seed for the starting "
+         "state (0)\n"
+         "  --threads N                          threads, 0 for one per "
+         "core (1)\n"
+         "  --time-step DT                       time per step (1)\n"
+         "  --engine time-stepped|event-driven\n"
+         "  --collisions discrete|continuous\n"
+         "  --broadphase grid|sweep|brute-force\n"
+         "  --placement random|non-overlapping\n"
+         "  --stats PATH                         statistics JSON, standard "
+         "output if not given\n"
+         "  --particles PATH                     final particles as CSV\n"
+         "  --checkpoint PATH                    checkpoint of the final "
+         "state\n"
+         "  --checkpoint-every N                 also a checkpoint every N "
+         "steps\n"
+         "  --resume PATH                        start from a checkpoint "
+         "instead\n"
+         "                                       of the species and "
+         "settings\n"
+         "  --trajectory PATH                    streams the positions and "
+         "velocities\n"
+         "  --trajectory-every N                 steps between trajectory "
+         "frames (1)\n"
+         "  --trajectory-overflow block|drop     waits for the disk or "
+         "drops frames\n";
+}
+
+nlohmann::json FormatInstrumentation(const InstrumentationSnapshot &snapshot) {
+  nlohmann::json seconds = nlohmann::json::object();
+  for (size_t phase = 0; phase < kPhaseCount; phase++) {
+    seconds[GetPhaseName(static_cast<Phase>(phase))] = 
+        snapshot.seconds[phase];
+  }
+  
+  nlohmann::json counts = nlohmann::json::object();
+  for (size_t counter = 0; counter < kCounterCount; counter++) {
+    counts[GetCounterName(static_cast<Counter>(counter))] = 
+        snapshot.counts[counter];
+  }
+  return {{"seconds", seconds}, {"counts", counts}};
+}
+
+BatchRunner::BatchRunner(const BatchOptions &options) : options_(options) {
+  std::chrono::steady_clock::time_point start = 
+      std::chrono::steady_clock::now();
+  
+  simulator_.SetThreadCount(options_.thread_count);
+  if (!options_.resume_path.empty()) {
+    simulator_.LoadCheckpoint(options_.resume_path);
+    options_.time_step = simulator_.GetTimeStep();
+    options_.container = simulator_.GetContainer();
+    options_.seed = simulator_.GetSeed();
+    options_.has_seed = true;
+    AddRestoredSpecies();
+    OpenTrajectory();
+    setup_seconds_ = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    return;
+  }
+  
+  simulator_.SetContainer(options_.container);
+  simulator_.SetTimeStep(options_.time_step);
+  simulator_.SetEngine(options_.engine);
+  simulator_.SetCollisionDetection(options_.collision_detection);
+  simulator_.SetBroadphase(options_.broadphase);
+  simulator_.SetPlacement(options_.placement);
+  simulator_.SetSeed(options_.seed);
+  
+  size_t total = 0;
+  for (const SpeciesOptions &species : options_.species) {
+    total += species.count;
+  }
+  simulator_.Reserve(total);
+  
+  // The simulator draws every particle from the seed on its own, so the 
+  // particles are the same with any amount of threads
+  for (const SpeciesOptions &species : options_.species) {
+    simulator_.AddParticlesInAnyDirection(species.count, species.radius, 
+                                          species.mass, species.color);
+  }
+  OpenTrajectory();
+  
+  setup_seconds_ = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+void BatchRunner::AddRestoredSpecies() {
+  const ParticleStore &particles = simulator_.GetParticles();
+  const std::vector<Species> &species = particles.GetSpecies();
+  options_.species.assign(species.size(), SpeciesOptions());
+  for (size_t s = 0; s < species.size(); s++) {
+    options_.species[s].radius = species[s].radius;
+    options_.species[s].mass = species[s].mass;
+    options_.species[s].color = species[s].color;
+  }
+  
+  const uint32_t *species_index = particles.GetSpeciesIndices();
+  for (size_t i = 0; i < particles.size(); i++) {
+    options_.species[species_index[i]].count++;
+  }
+}
+
+void BatchRunner::OpenTrajectory() {
+  if (options_.trajectory_path.empty()) {
+    return;
+  }
+  TrajectoryOptions trajectory_options;
+  trajectory_options.overflow_policy = options_.trajectory_overflow;
+  trajectory_.reset(new TrajectoryWriter(options_.trajectory_path,
+                                         simulator_.GetParticles().size(),
+                                         trajectory_options));
+}
+
+void BatchRunner::Run() {
+  Run(options_.steps);
+  
+  // The last step may have been checkpointed by the interval already
+  bool saved = options_.checkpoint_interval > 0 && options_.steps > 0 &&
+      simulator_.GetStepCount() % options_.checkpoint_interval == 0;
+  if (!options_.checkpoint_path.empty() && !saved) {
+    SaveCheckpoint();
+  }
+  if (trajectory_) {
+    trajectory_->Close();
+  }
+}
+
+void BatchRunner::Run(size_t steps) {
+  std::chrono::steady_clock::time_point start = 
+      std::chrono::steady_clock::now();
+  double checkpoint_seconds = 0;
+  for (size_t step = 0; step < steps; step++) {
+    simulator_.Update();
+    pairs_tested_ += simulator_.GetCandidatePairCount();
+    
+    // Goes by the simulator's step count, so a resumed run keeps the 
+    // schedule of the run it was saved from
+    if (options_.checkpoint_interval > 0 && 
+        simulator_.GetStepCount() % options_.checkpoint_interval == 0) {
+      checkpoint_seconds += SaveCheckpoint();
+    }
+    
+    // Only copies the frame, the writer thread does the rest
+    if (trajectory_ && 
+        simulator_.GetStepCount() % options_.trajectory_interval == 0) {
+      trajectory_->AddFrame(simulator_.GetParticles(), 
+                            simulator_.GetStepCount());
+    }
+  }
+  run_seconds_ += std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count() - checkpoint_seconds;
+  steps_run_ += steps;
+}
+
+double BatchRunner::SaveCheckpoint() {
+  std::chrono::steady_clock::time_point start = 
+      std::chrono::steady_clock::now();
+  simulator_.SaveCheckpoint(options_.checkpoint_path);
+  double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  checkpoint_seconds_ += seconds;
+  return seconds;
+}
+
+double BatchRunner::GetRunSeconds() const {
+  return run_seconds_;
+}
+
+void BatchRunner::ResetStatistics() {
+  run_seconds_ = 0;
+  checkpoint_seconds_ = 0;
+  steps_run_ = 0;
+  pairs_tested_ = 0;
+  simulator_.ResetInstrumentation();
+}
+
+nlohmann::json BatchRunner::GetStatistics() const {
+  const ParticleStore &particles = simulator_.GetParticles();
+  const float *x_velocity = particles.GetXVelocity();
+  const float *y_velocity = particles.GetYVelocity();
+  const uint32_t *species_index = particles.GetSpeciesIndices();
+  const double *masses = particles.GetSpeciesMasses();
+  
+  // The species are summed up by their index in the same pass, since 
+  // species can share a mass
+  size_t species_count = particles.GetSpecies().size();
+  std::vector<double> species_energies(species_count);
+  std::vector<double> speed_sums(species_count);
+  std::vector<size_t> counts(species_count);
+  double x_momentum = 0;
+  double y_momentum = 0;
+  for (size_t i = 0; i < particles.size(); i++) {
+    uint32_t s = species_index[i];
+    double mass = masses[s];
+    double speed_squared = x_velocity[i] * x_velocity[i] + 
+        y_velocity[i] * y_velocity[i];
+    species_energies[s] += 0.5 * mass * speed_squared;
+    speed_sums[s] += std::sqrt(speed_squared);
+    counts[s]++;
+    x_momentum += mass * x_velocity[i];
+    y_momentum += mass * y_velocity[i];
+  }
+  
+  double kinetic_energy = 0;
+  for (double species_energy : species_energies) {
+    kinetic_energy += species_energy;
+  }
+  
+  std::vector<Histogram> histograms;
+  std::vector<uint32_t> indices;
+  for (const SpeciesOptions &species : options_.species) {
+    indices.push_back(particles.FindSpecies(species.radius, species.mass, 
+                                            species.color));
+    histograms.push_back(Histogram(indices.back(), species.mass));
+  }
+  Histogram::FillBins(particles, histograms);
+  
+  nlohmann::json species_statistics = nlohmann::json::array();
+  for (size_t s = 0; s < options_.species.size(); s++) {
+    const SpeciesOptions &species = options_.species[s];
+    
+    // A species without any particles may not be in the store at all
+    bool stored = indices[s] < species_count;
+    size_t count = stored ? counts[indices[s]] : 0;
+    double species_energy = stored ? species_energies[indices[s]] : 0;
+    double speed_sum = stored ? speed_sums[indices[s]] : 0;
+    
+    species_statistics.push_back({
+        {"count", count},
+        {"radius", species.radius},
+        {"mass", species.mass},
+        {"color", species.color},
+        {"mean_speed", count == 0 ? 0 : speed_sum / count},
+        {"kinetic_energy", species_energy},
+        {"histogram", histograms[s].GetBins()}
+    });
+  }
+  
+  double particle_steps = (double) particles.size() * steps_run_;
+  nlohmann::json statistics = {
+      {"particles", particles.size()},
+      {"steps", steps_run_},
+      {"simulated_time", steps_run_ * options_.time_step},
+      {"seed", options_.seed},
+      {"threads", simulator_.GetThreadCount()},
+      {"setup_seconds", setup_seconds_},
+      {"run_seconds", run_seconds_},
+      {"checkpoint_seconds", checkpoint_seconds_},
+      {"total_steps", simulator_.GetStepCount()},
+      {"steps_per_second", run_seconds_ > 0 ? 
+          steps_run_ / run_seconds_ : 0},
+      {"nanoseconds_per_particle_step", particle_steps > 0 ? 
+          run_seconds_ * 1e9 / particle_steps : 0},
+      {"pairs_per_step", steps_run_ > 0 ? 
+          (double) pairs_tested_ / steps_run_ : 0},
+      {"kinetic_energy", kinetic_energy},
+      {"momentum", {x_momentum, y_momentum}},
+      {"species", species_statistics}
+  };
+  
+  if (trajectory_) {
+    statistics["trajectory"] = {
+        {"frames", trajectory_->GetWrittenFrameCount()},
+        {"dropped", trajectory_->GetDroppedFrameCount()},
+        {"bytes", trajectory_->GetWrittenBytes()}
+    };
+  }
+  if (Instrumentation::kEnabled) {
+    statistics["instrumentation"] = FormatInstrumentation(
+        simulator_.GetInstrumentationSnapshot());
+  }
+  return statistics;
+}
+
+void BatchRunner::WriteParticles(std::ostream &output) const {
+  const ParticleStore &particles = simulator_.GetParticles();
+  output << "x,y,x_velocity,y_velocity,radius,mass,color\n";
+  for (size_t i = 0; i < particles.size(); i++) {
+    glm::vec2 position = particles.GetPosition(i);
+    glm::vec2 velocity = particles.GetVelocity(i);
+    output << position.x << ',' << position.y << ',' << velocity.x << ',' 
+           << velocity.y << ',' << particles.GetRadius(i) << ',' 
+           << particles.GetMass(i) << ',' << particles.GetColor(i) << '\n';
+  }
+}
+
+const ParticleSimulator &BatchRunner::GetSimulator() const {
+  return simulator_;
+}
+
+} // namespace idealgas
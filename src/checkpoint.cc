@@ -0,0 +1,417 @@
+#include <checkpoint.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#include <iterator>
+
+// Only for MoveFileExA, so none of the rest of the Windows headers or 
+// their min and max macros are pulled in
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace idealgas {
+
+namespace {
+
+const char kMagic[8] = {'I', 'G', 'A', 'S', 'C', 'K', 'P', 'T'};
+
+// Written as a number and compared when reading, so a checkpoint from a
+// machine with the other byte order is refused instead of read as garbage
+const uint32_t kByteOrder = 0x01020304;
+
+// Every section starts on a cache line, which is more than any column needs
+const uint64_t kAlignment = 64;
+
+// The particle columns in the order of their offsets in the header
+enum Column { kX, kY, kXVelocity, kYVelocity, kSpeciesIndex, kColumnCount };
+
+/**
+ * The start of every checkpoint file. Everything in it is 4 or 8 bytes and
+ * laid out without padding, so it is the same on every compiler
+ */
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t file_size;
+  uint64_t particle_count;
+  uint64_t species_count;
+  uint64_t seed;
+  uint64_t random_particles;
+  uint64_t steps;
+  double accumulated_time;
+  double time_step;
+  uint64_t max_substeps;
+  uint32_t engine;
+  uint32_t collision_detection;
+  uint32_t broadphase;
+  uint32_t placement;
+  double x_lower_bound;
+  double y_lower_bound;
+  double x_upper_bound;
+  double y_upper_bound;
+  uint64_t species_offset;
+  uint64_t colors_offset;
+  uint64_t colors_size;
+  uint64_t column_offsets[kColumnCount];
+};
+
+static_assert(sizeof(Header) == 200, "The checkpoint header has padding");
+
+/**
+ * One species in the table. The color is stored with the other names and
+ * found by its offset from the start of the names
+ */
+struct SpeciesRecord {
+  double radius;
+  double mass;
+  uint64_t color_offset;
+  uint64_t color_size;
+};
+
+static_assert(sizeof(SpeciesRecord) == 32, "The species record has padding");
+
+/**
+ * Rounds an offset up to the next section boundary
+ */
+uint64_t Align(uint64_t offset) {
+  return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+/**
+ * Checks that a section is aligned and fits in the file
+ * @param offset where the section starts
+ * @param count the amount of elements in it
+ * @param element_size the size of each element
+ * @param file_size the size of the whole file
+ * @throws std::invalid_argument if it doesn't fit
+ */
+void CheckSection(uint64_t offset, uint64_t count, uint64_t element_size,
+                  uint64_t file_size) {
+
+  // Dividing instead of multiplying, so a damaged count can't overflow
+  if (offset % kAlignment != 0 || offset > file_size ||
+      count > (file_size - offset) / element_size) {
+    throw std::invalid_argument("Please make sure the checkpoint is "
+                                "complete and undamaged!");
+  }
+}
+
+/**
+ * Writes zeros up to an offset
+ */
+void PadTo(std::ofstream &output, uint64_t offset) {
+  const char zeros[kAlignment] = {};
+  if (!output) {
+    return;
+  }
+  uint64_t position = (uint64_t) output.tellp();
+  output.write(zeros, (std::streamsize) (offset - position));
+}
+
+/**
+ * A whole file mapped into memory for reading. The pages are only read
+ * from the disk when they are first used, and they are shared with the
+ * file cache instead of copied into the process
+ */
+class MappedFile {
+ public:
+
+  /**
+   * Maps a file
+   * @param path the file to map
+   * @throws std::runtime_error if the file can't be opened or mapped
+   */
+  explicit MappedFile(const std::string &path);
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  const char *data() const {
+    return data_;
+  }
+
+  uint64_t size() const {
+    return size_;
+  }
+
+ private:
+  const char *data_ = nullptr;
+  uint64_t size_ = 0;
+
+#ifdef _WIN32
+  // There is no mmap, so the file is read into memory instead
+  std::vector<char> contents_;
+#else
+  void *mapping_ = nullptr;
+#endif
+};
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string &path) {
+  std::ifstream input(path, std::ios::binary);
+  if (!input) {
+    throw std::runtime_error("Could not open " + path);
+  }
+  contents_.assign(std::istreambuf_iterator<char>(input),
+                   std::istreambuf_iterator<char>());
+  data_ = contents_.data();
+  size_ = contents_.size();
+}
+
+MappedFile::~MappedFile() {}
+
+#else
+
+MappedFile::MappedFile(const std::string &path) {
+  int file = open(path.c_str(), O_RDONLY);
+  if (file < 0) {
+    throw std::runtime_error("Could not open " + path);
+  }
+
+  struct stat status;
+  if (fstat(file, &status) != 0) {
+    close(file);
+    throw std::runtime_error("Could not read " + path);
+  }
+  size_ = (uint64_t) status.st_size;
+
+  // An empty file can't be mapped, and is refused as too short later
+  if (size_ > 0) {
+    mapping_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+    if (mapping_ == MAP_FAILED) {
+      mapping_ = nullptr;
+      close(file);
+      throw std::runtime_error("Could not map " + path);
+    }
+
+    // The columns are read front to back once, so the kernel can read
+    // ahead aggressively and drop the pages behind
+    madvise(mapping_, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char *>(mapping_);
+  }
+
+  // The mapping stays valid after the file is closed
+  close(file);
+}
+
+MappedFile::~MappedFile() {
+  if (mapping_) {
+    munmap(mapping_, size_);
+  }
+}
+
+#endif
+
+} // namespace
+
+void WriteCheckpoint(const std::string &path, const ParticleStore &particles,
+                     const CheckpointState &state) {
+  const std::vector<Species> &species = particles.GetSpecies();
+
+  std::string colors;
+  std::vector<SpeciesRecord> records;
+  for (const Species &kind : species) {
+    records.push_back({kind.radius, kind.mass, colors.size(),
+                       kind.color.size()});
+    colors += kind.color;
+  }
+
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kCheckpointVersion;
+  header.byte_order = kByteOrder;
+  header.particle_count = particles.size();
+  header.species_count = species.size();
+  header.seed = state.seed;
+  header.random_particles = state.random_particles;
+  header.steps = state.steps;
+  header.accumulated_time = state.accumulated_time;
+  header.time_step = state.time_step;
+  header.max_substeps = state.max_substeps;
+  header.engine = static_cast<uint32_t>(state.engine);
+  header.collision_detection =
+      static_cast<uint32_t>(state.collision_detection);
+  header.broadphase = static_cast<uint32_t>(state.broadphase);
+  header.placement = static_cast<uint32_t>(state.placement);
+  header.x_lower_bound = state.container.x_lower_bound;
+  header.y_lower_bound = state.container.y_lower_bound;
+  header.x_upper_bound = state.container.x_upper_bound;
+  header.y_upper_bound = state.container.y_upper_bound;
+
+  // Lays out the sections one after another, each on a boundary
+  header.species_offset = Align(sizeof(Header));
+  header.colors_offset = Align(header.species_offset +
+                               records.size() * sizeof(SpeciesRecord));
+  header.colors_size = colors.size();
+
+  const char *columns[kColumnCount] = {
+      reinterpret_cast<const char *>(particles.GetX()),
+      reinterpret_cast<const char *>(particles.GetY()),
+      reinterpret_cast<const char *>(particles.GetXVelocity()),
+      reinterpret_cast<const char *>(particles.GetYVelocity()),
+      reinterpret_cast<const char *>(particles.GetSpeciesIndices())};
+
+  // Every column has 4 byte values
+  static_assert(sizeof(float) == 4 && sizeof(uint32_t) == 4,
+                "The columns are written as 4 byte values");
+  uint64_t column_size = particles.size() * 4;
+  uint64_t end = header.colors_offset + colors.size();
+  for (size_t column = 0; column < kColumnCount; column++) {
+    header.column_offsets[column] = Align(end);
+    end = header.column_offsets[column] + column_size;
+  }
+  header.file_size = end;
+
+  std::string temporary_path = path + ".tmp";
+  {
+    std::ofstream output(temporary_path, std::ios::binary | std::ios::trunc);
+    output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    PadTo(output, header.species_offset);
+    output.write(reinterpret_cast<const char *>(records.data()),
+                 (std::streamsize) (records.size() * sizeof(SpeciesRecord)));
+    PadTo(output, header.colors_offset);
+    output.write(colors.data(), (std::streamsize) colors.size());
+    for (size_t column = 0; column < kColumnCount; column++) {
+      PadTo(output, header.column_offsets[column]);
+      output.write(columns[column], (std::streamsize) column_size);
+    }
+
+    output.close();
+    if (!output) {
+      std::remove(temporary_path.c_str());
+      throw std::runtime_error("Could not write " + temporary_path);
+    }
+  }
+
+#ifdef _WIN32
+  // std::rename doesn't replace an existing file on Windows, and removing
+  // the old one first would lose it if the program stopped in between
+  bool replaced = MoveFileExA(temporary_path.c_str(), path.c_str(),
+                              MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  bool replaced = std::rename(temporary_path.c_str(), path.c_str()) == 0;
+#endif
+  if (!replaced) {
+    std::remove(temporary_path.c_str());
+    throw std::runtime_error("Could not write " + path);
+  }
+}
+
+CheckpointState ReadCheckpoint(const std::string &path,
+                               ParticleStore *particles) {
+  if (!particles->empty() || !particles->GetSpecies().empty()) {
+    throw std::invalid_argument("Please make sure the checkpoint is read "
+                                "into an empty store!");
+  }
+  MappedFile file(path);
+
+  Header header;
+  if (file.size() < sizeof(Header)) {
+    throw std::invalid_argument("Please make sure " + path +
+                                " is a checkpoint!");
+  }
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    throw std::invalid_argument("Please make sure " + path +
+                                " is a checkpoint!");
+  }
+  if (header.byte_order != kByteOrder) {
+    throw std::invalid_argument("Please make sure the checkpoint was "
+                                "written on a machine with the same byte "
+                                "order!");
+  }
+  if (header.version != kCheckpointVersion) {
+    throw std::invalid_argument("Please make sure the checkpoint is version "
+                                + std::to_string(kCheckpointVersion) + "!");
+  }
+  if (header.file_size != file.size()) {
+    throw std::invalid_argument("Please make sure the checkpoint is "
+                                "complete and undamaged!");
+  }
+
+  CheckSection(header.species_offset, header.species_count,
+               sizeof(SpeciesRecord), file.size());
+  CheckSection(header.colors_offset, header.colors_size, 1, file.size());
+  for (size_t column = 0; column < kColumnCount; column++) {
+    CheckSection(header.column_offsets[column], header.particle_count, 4,
+                 file.size());
+  }
+  if (header.engine > static_cast<uint32_t>(Engine::kEventDriven) ||
+      header.collision_detection >
+          static_cast<uint32_t>(CollisionDetection::kContinuous) ||
+      header.broadphase > static_cast<uint32_t>(Broadphase::kSortAndSweep) ||
+      header.placement > static_cast<uint32_t>(Placement::kNonOverlapping)) {
+    throw std::invalid_argument("Please make sure the checkpoint is "
+                                "complete and undamaged!");
+  }
+
+  const char *colors = file.data() + header.colors_offset;
+  for (uint64_t s = 0; s < header.species_count; s++) {
+    SpeciesRecord record;
+    std::memcpy(&record, file.data() + header.species_offset +
+                s * sizeof(SpeciesRecord), sizeof(record));
+    // Written so that a NaN radius or mass fails too
+    if (record.color_offset > header.colors_size ||
+        record.color_size > header.colors_size - record.color_offset ||
+        !(record.radius >= 0.1) || !(record.mass >= 0.1)) {
+      throw std::invalid_argument("Please make sure the checkpoint is "
+                                  "complete and undamaged!");
+    }
+
+    // The species are added in the order they were saved, so the particles'
+    // species indices still point at the right ones
+    uint32_t index = particles->AddSpecies(record.radius, record.mass,
+        std::string(colors + record.color_offset, record.color_size));
+    if (index != s) {
+      throw std::invalid_argument("Please make sure every species in the "
+                                  "checkpoint is different!");
+    }
+  }
+
+  // The sections are aligned and the mapping starts on a page, so the
+  // columns can be read in place
+  const uint64_t *offsets = header.column_offsets;
+  particles->Reserve(particles->size() + header.particle_count);
+  particles->AddParticles(
+      header.particle_count,
+      reinterpret_cast<const float *>(file.data() + offsets[kX]),
+      reinterpret_cast<const float *>(file.data() + offsets[kY]),
+      reinterpret_cast<const float *>(file.data() + offsets[kXVelocity]),
+      reinterpret_cast<const float *>(file.data() + offsets[kYVelocity]),
+      reinterpret_cast<const uint32_t *>(file.data() +
+                                         offsets[kSpeciesIndex]));
+
+  CheckpointState state;
+  state.seed = header.seed;
+  state.random_particles = header.random_particles;
+  state.steps = header.steps;
+  state.accumulated_time = header.accumulated_time;
+  state.time_step = header.time_step;
+  state.max_substeps = header.max_substeps;
+  state.engine = static_cast<Engine>(header.engine);
+  state.collision_detection =
+      static_cast<CollisionDetection>(header.collision_detection);
+  state.broadphase = static_cast<Broadphase>(header.broadphase);
+  state.placement = static_cast<Placement>(header.placement);
+  state.container = {header.x_lower_bound, header.y_lower_bound,
+                     header.x_upper_bound, header.y_upper_bound};
+  return state;
+}
+
+} // namespace idealgas
@@ -0,0 +1,323 @@
+#include <continuous_collisions.h>
+#include <hard_disk_collisions.h>
+#include <algorithm>
+#include <cmath>
+
+namespace idealgas {
+
+size_t ContinuousCollisions::Step(ParticleStore &particles, double duration,
+                                  double x_lower_bound, double y_lower_bound,
+                                  double x_upper_bound, double y_upper_bound,
+                                  std::vector<SpeedChange> *speed_changes) {
+  x_lower_bound_ = x_lower_bound;
+  y_lower_bound_ = y_lower_bound;
+  x_upper_bound_ = x_upper_bound;
+  y_upper_bound_ = y_upper_bound;
+  duration_ = duration;
+  time_ = 0;
+  wall_collision_count_ = 0;
+  collided_.clear();
+
+  size_t count = particles.size();
+  float *x = particles.GetX();
+  float *y = particles.GetY();
+  float *x_velocity = particles.GetXVelocity();
+  float *y_velocity = particles.GetYVelocity();
+
+  x_.assign(x, x + count);
+  y_.assign(y, y + count);
+  x_velocity_.assign(x_velocity, x_velocity + count);
+  y_velocity_.assign(y_velocity, y_velocity + count);
+  last_update_.assign(count, 0);
+  event_count_.assign(count, 0);
+
+  // Looked up from the species table once, since the events need them over
+  // and over
+  const uint32_t *species = particles.GetSpeciesIndices();
+  const double *species_radii = particles.GetSpeciesRadii();
+  radius_.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    radius_[i] = species_radii[species[i]];
+  }
+  const double *radii = radius_.data();
+
+  FindCandidatePairs();
+
+  events_ = std::priority_queue<Event, std::vector<Event>,
+                                std::greater<Event>>();
+  for (uint32_t i = 0; i < count; i++) {
+    AddEvent(FindWallCollisionTime(x_[i], x_velocity_[i], radii[i],
+                                   x_lower_bound_, x_upper_bound_),
+             i, i, true);
+    AddEvent(FindWallCollisionTime(y_[i], y_velocity_[i], radii[i],
+                                   y_lower_bound_, y_upper_bound_),
+             i, i, false);
+  }
+  for (const ParticlePair &pair : candidate_pairs_) {
+    PredictCollision(pair.first, pair.second, radii);
+  }
+
+  size_t collisions = 0;
+  size_t max_events = kMaxEventsPerParticle * count;
+  for (size_t processed = 0; !events_.empty() && processed < max_events;
+       processed++) {
+    Event event = events_.top();
+    events_.pop();
+
+    uint32_t particle1 = event.particle1;
+    uint32_t particle2 = event.particle2;
+    if (event.particle1_events != event_count_[particle1] ||
+        event.particle2_events != event_count_[particle2]) {
+      continue;
+    }
+
+    time_ = event.time;
+    Synchronize(particle1);
+    if (particle1 == particle2) {
+      if (event.vertical_wall) {
+        x_velocity_[particle1] = -x_velocity_[particle1];
+      } else {
+        y_velocity_[particle1] = -y_velocity_[particle1];
+      }
+      wall_collision_count_++;
+    } else {
+      Synchronize(particle2);
+      CollideHardDisks(x_[particle1] - x_[particle2],
+                       y_[particle1] - y_[particle2],
+                       particles.GetInverseMass(particle1),
+                       particles.GetInverseMass(particle2),
+                       x_velocity_[particle1], y_velocity_[particle1],
+                       x_velocity_[particle2], y_velocity_[particle2]);
+      collided_.push_back(particle1);
+      collided_.push_back(particle2);
+      collisions++;
+    }
+
+    // Everything predicted for these particles before is out of date now
+    event_count_[particle1]++;
+    Predict(particle1, radii);
+    if (particle2 != particle1) {
+      event_count_[particle2]++;
+      Predict(particle2, radii);
+    }
+  }
+
+  time_ = duration_;
+
+  // The particles that collided get their velocities first so their speed
+  // changes can be reported. A particle that collided more than once only
+  // has a change the first time, since its velocity is already written
+  if (speed_changes != nullptr) {
+    for (uint32_t particle : collided_) {
+      float old_speed = GetSpeed(x_velocity[particle], y_velocity[particle]);
+      x_velocity[particle] = (float) x_velocity_[particle];
+      y_velocity[particle] = (float) y_velocity_[particle];
+      RecordSpeedChange(speed_changes, particle, old_speed, 
+                        GetSpeed(x_velocity[particle], y_velocity[particle]));
+    }
+  }
+  collided_.clear();
+
+  for (uint32_t i = 0; i < count; i++) {
+    Synchronize(i);
+    x[i] = (float) x_[i];
+    y[i] = (float) y_[i];
+    x_velocity[i] = (float) x_velocity_[i];
+    y_velocity[i] = (float) y_velocity_[i];
+  }
+  return collisions;
+}
+
+size_t ContinuousCollisions::GetCandidatePairCount() const {
+  return candidate_pairs_.size();
+}
+
+size_t ContinuousCollisions::GetWallCollisionCount() const {
+  return wall_collision_count_;
+}
+
+void ContinuousCollisions::FindCandidatePairs() {
+  size_t count = x_.size();
+  boxes_.resize(count);
+  double box_sides = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    SweepBox(i);
+    const Box &box = boxes_[i];
+    box_sides += std::max(box.max_x - box.min_x, box.max_y - box.min_y);
+    boxes_[i].lookup = 0;
+  }
+
+  // Cells about as big as the average box, so most boxes touch only a few 
+  // cells, but never more cells than particles
+  double width = x_upper_bound_ - x_lower_bound_;
+  double height = y_upper_bound_ - y_lower_bound_;
+  cell_size_ = count == 0 ? std::max(width, height) : std::max(
+      box_sides / count, std::sqrt(width * height / count));
+  columns_ = std::max((size_t) std::ceil(width / cell_size_), (size_t) 1);
+  rows_ = std::max((size_t) std::ceil(height / cell_size_), (size_t) 1);
+  // The cells are cleared rather than replaced to keep their memory
+  cells_.resize(columns_ * rows_);
+  for (std::vector<uint32_t> &cell : cells_) {
+    cell.clear();
+  }
+  lookup_count_ = 0;
+  
+  // No particle is in any cell yet
+  cell_ranges_.assign(count, {1, 0, 1, 0});
+  for (uint32_t i = 0; i < count; i++) {
+    AddToGrid(i);
+  }
+
+  candidate_pairs_.clear();
+  for (uint32_t i = 0; i < count; i++) {
+    FindOverlaps(i);
+    for (uint32_t other : overlaps_) {
+      if (other > i) {
+        candidate_pairs_.emplace_back(i, other);
+      }
+    }
+  }
+}
+
+void ContinuousCollisions::SweepBox(uint32_t particle) {
+  double remaining = duration_ - time_;
+  double end_x = x_[particle] + x_velocity_[particle] * remaining;
+  double end_y = y_[particle] + y_velocity_[particle] * remaining;
+  Box &box = boxes_[particle];
+  box.min_x = std::min(x_[particle], end_x) - radius_[particle];
+  box.max_x = std::max(x_[particle], end_x) + radius_[particle];
+  box.min_y = std::min(y_[particle], end_y) - radius_[particle];
+  box.max_y = std::max(y_[particle], end_y) + radius_[particle];
+}
+
+void ContinuousCollisions::AddToGrid(uint32_t particle) {
+  CellRange range = GetCellRange(particle);
+  const CellRange &added = cell_ranges_[particle];
+  for (size_t row = range.first_row; row <= range.last_row; row++) {
+    for (size_t column = range.first_column; column <= range.last_column; 
+         column++) {
+      if (row < added.first_row || row > added.last_row ||
+          column < added.first_column || column > added.last_column) {
+        cells_[row * columns_ + column].push_back(particle);
+      }
+    }
+  }
+  cell_ranges_[particle] = range;
+}
+
+void ContinuousCollisions::FindOverlaps(uint32_t particle) {
+  overlaps_.clear();
+  lookup_count_++;
+  Box &box = boxes_[particle];
+  box.lookup = lookup_count_;
+
+  CellRange range = GetCellRange(particle);
+  for (size_t row = range.first_row; row <= range.last_row; row++) {
+    for (size_t column = range.first_column; column <= range.last_column; 
+         column++) {
+      std::vector<uint32_t> &cell = cells_[row * columns_ + column];
+      size_t i = 0;
+      while (i < cell.size()) {
+        uint32_t other = cell[i];
+        
+        // Drops the entry if the other particle's box has left the cell
+        const CellRange &other_range = cell_ranges_[other];
+        if (row < other_range.first_row || row > other_range.last_row ||
+            column < other_range.first_column || 
+            column > other_range.last_column) {
+          cell[i] = cell.back();
+          cell.pop_back();
+          continue;
+        }
+        i++;
+        
+        Box &other_box = boxes_[other];
+        if (other_box.lookup == lookup_count_) {
+          continue;
+        }
+        other_box.lookup = lookup_count_;
+        if (other_box.min_x <= box.max_x && box.min_x <= other_box.max_x &&
+            other_box.min_y <= box.max_y && box.min_y <= other_box.max_y) {
+          overlaps_.push_back(other);
+        }
+      }
+    }
+  }
+}
+
+ContinuousCollisions::CellRange ContinuousCollisions::GetCellRange(
+    uint32_t particle) const {
+  const Box &box = boxes_[particle];
+  return {GetCell(box.min_x, x_lower_bound_, columns_),
+          GetCell(box.max_x, x_lower_bound_, columns_),
+          GetCell(box.min_y, y_lower_bound_, rows_),
+          GetCell(box.max_y, y_lower_bound_, rows_)};
+}
+
+size_t ContinuousCollisions::GetCell(double coordinate, double lower_bound,
+                                     size_t cells) const {
+  double cell = std::floor((coordinate - lower_bound) / cell_size_);
+  return (size_t) std::min(std::max(cell, 0.0), (double) (cells - 1));
+}
+
+void ContinuousCollisions::Synchronize(uint32_t particle) {
+  double elapsed = time_ - last_update_[particle];
+  x_[particle] += x_velocity_[particle] * elapsed;
+  y_[particle] += y_velocity_[particle] * elapsed;
+  last_update_[particle] = time_;
+}
+
+void ContinuousCollisions::Predict(uint32_t particle, const double *radii) {
+  AddEvent(FindWallCollisionTime(x_[particle], x_velocity_[particle],
+                                 radii[particle], x_lower_bound_,
+                                 x_upper_bound_),
+           particle, particle, true);
+  AddEvent(FindWallCollisionTime(y_[particle], y_velocity_[particle],
+                                 radii[particle], y_lower_bound_,
+                                 y_upper_bound_),
+           particle, particle, false);
+
+  // The old box only covered the path before the bounce
+  SweepBox(particle);
+  AddToGrid(particle);
+  FindOverlaps(particle);
+  for (uint32_t other : overlaps_) {
+    PredictCollision(particle, other, radii);
+  }
+}
+
+void ContinuousCollisions::PredictCollision(uint32_t particle1,
+                                            uint32_t particle2,
+                                            const double *radii) {
+
+  // Where the second particle is now, without changing its stored state
+  double elapsed = time_ - last_update_[particle2];
+  AddEvent(FindCollisionTime(
+               x_[particle2] + x_velocity_[particle2] * elapsed -
+                   x_[particle1],
+               y_[particle2] + y_velocity_[particle2] * elapsed -
+                   y_[particle1],
+               x_velocity_[particle2] - x_velocity_[particle1],
+               y_velocity_[particle2] - y_velocity_[particle1],
+               radii[particle1] + radii[particle2]),
+           particle1, particle2, false);
+}
+
+void ContinuousCollisions::AddEvent(double delay, uint32_t particle1,
+                                    uint32_t particle2, bool vertical_wall) {
+  double time = time_ + delay;
+  if (time > duration_) {
+    return;
+  }
+
+  Event event;
+  event.time = time;
+  event.particle1 = particle1;
+  event.particle2 = particle2;
+  event.particle1_events = event_count_[particle1];
+  event.particle2_events = event_count_[particle2];
+  event.vertical_wall = vertical_wall;
+  events_.push(event);
+}
+
+} // namespace idealgas
@@ -0,0 +1,32 @@
+#include <counter_rng.h>
+
+namespace idealgas {
+
+// The golden ratio step SplitMix64 adds between numbers
+static const uint64_t kGoldenGamma = 0x9E3779B97F4A7C15ULL;
+
+CounterRng::CounterRng(uint64_t seed) : seed_(seed), key_(Mix(seed)) {}
+
+uint64_t CounterRng::GetBits(uint64_t counter) const {
+  return Mix(key_ + (counter + 1) * kGoldenGamma);
+}
+
+double CounterRng::GetUniform(uint64_t counter, double min,
+                              double max) const {
+
+  // The top 53 bits fill the whole mantissa of a double in [0, 1)
+  double unit = (GetBits(counter) >> 11) * (1.0 / 9007199254740992.0);
+  return min + unit * (max - min);
+}
+
+uint64_t CounterRng::GetSeed() const {
+  return seed_;
+}
+
+uint64_t CounterRng::Mix(uint64_t value) {
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+  return value ^ (value >> 31);
+}
+
+} // namespace idealgas
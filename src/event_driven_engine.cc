@@ -0,0 +1,313 @@
+#include <event_driven_engine.h>
+#include <hard_disk_collisions.h>
+#include <algorithm>
+#include <cmath>
+
+namespace idealgas {
+
+void EventDrivenEngine::Reset(const ParticleStore &particles,
+                              double x_lower_bound, double y_lower_bound,
+                              double x_upper_bound, double y_upper_bound) {
+  x_lower_bound_ = x_lower_bound;
+  y_lower_bound_ = y_lower_bound;
+  x_upper_bound_ = x_upper_bound;
+  y_upper_bound_ = y_upper_bound;
+
+  size_t count = particles.size();
+  x_.assign(particles.GetX(), particles.GetX() + count);
+  y_.assign(particles.GetY(), particles.GetY() + count);
+  x_velocity_.assign(particles.GetXVelocity(),
+                     particles.GetXVelocity() + count);
+  y_velocity_.assign(particles.GetYVelocity(),
+                     particles.GetYVelocity() + count);
+  radius_.resize(count);
+  inverse_mass_.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    radius_[i] = particles.GetRadius(i);
+    inverse_mass_[i] = particles.GetInverseMass(i);
+  }
+  last_update_.assign(count, time_);
+  event_count_.assign(count, 0);
+  collided_.clear();
+
+  // The cells are at least as wide as the biggest particle so that two
+  // particles can only touch if they are in neighboring cells
+  double max_radius = 0;
+  for (double radius : radius_) {
+    max_radius = std::max(max_radius, radius);
+  }
+  double width = x_upper_bound - x_lower_bound;
+  double height = y_upper_bound - y_lower_bound;
+  cell_size_ = 2 * max_radius;
+  double max_cells = std::max(count * kMaxCellsPerParticle, (size_t) 1);
+  if ((width / cell_size_) * (height / cell_size_) > max_cells) {
+    cell_size_ = std::sqrt(width * height / max_cells);
+  }
+  columns_ = std::max((size_t) std::ceil(width / cell_size_), (size_t) 1);
+  rows_ = std::max((size_t) std::ceil(height / cell_size_), (size_t) 1);
+
+  cells_.assign(columns_ * rows_, std::vector<uint32_t>());
+  column_.resize(count);
+  row_.resize(count);
+  slot_.resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    column_[i] = FindCellIndex(x_[i], x_lower_bound_, columns_);
+    row_[i] = FindCellIndex(y_[i], y_lower_bound_, rows_);
+    std::vector<uint32_t> &cell = cells_[row_[i] * columns_ + column_[i]];
+    slot_[i] = (uint32_t) cell.size();
+    cell.push_back(i);
+  }
+
+  Rebuild();
+}
+
+void EventDrivenEngine::Advance(double duration, ParticleStore &particles,
+                                std::vector<SpeedChange> *speed_changes) {
+  double end_time = time_ + duration;
+
+  while (!events_.empty() && events_.top().time <= end_time) {
+    Event event = events_.top();
+    events_.pop();
+
+    if (event.particle1_events != event_count_[event.particle1] ||
+        event.particle2_events != event_count_[event.particle2]) {
+      continue;
+    }
+
+    time_ = event.time;
+    Process(event);
+
+    if (events_.size() > kMaxEventsPerParticle * (x_.size() + 1)) {
+      Rebuild();
+    }
+  }
+  time_ = end_time;
+
+  float *x = particles.GetX();
+  float *y = particles.GetY();
+  float *x_velocity = particles.GetXVelocity();
+  float *y_velocity = particles.GetYVelocity();
+
+  // The particles that collided get their velocities first so their speed
+  // changes can be reported. A particle that collided more than once only
+  // has a change the first time, since its velocity is already written
+  if (speed_changes != nullptr) {
+    for (uint32_t particle : collided_) {
+      float old_speed = GetSpeed(x_velocity[particle], y_velocity[particle]);
+      x_velocity[particle] = (float) x_velocity_[particle];
+      y_velocity[particle] = (float) y_velocity_[particle];
+      RecordSpeedChange(speed_changes, particle, old_speed, 
+                        GetSpeed(x_velocity[particle], y_velocity[particle]));
+    }
+  }
+  collided_.clear();
+
+  for (uint32_t i = 0; i < x_.size(); i++) {
+    Synchronize(i);
+    x[i] = (float) x_[i];
+    y[i] = (float) y_[i];
+    x_velocity[i] = (float) x_velocity_[i];
+    y_velocity[i] = (float) y_velocity_[i];
+  }
+}
+
+double EventDrivenEngine::GetTime() const {
+  return time_;
+}
+
+size_t EventDrivenEngine::GetParticleCollisionCount() const {
+  return particle_collision_count_;
+}
+
+size_t EventDrivenEngine::GetWallCollisionCount() const {
+  return wall_collision_count_;
+}
+
+void EventDrivenEngine::Synchronize(uint32_t particle) {
+  double elapsed = time_ - last_update_[particle];
+  x_[particle] += x_velocity_[particle] * elapsed;
+  y_[particle] += y_velocity_[particle] * elapsed;
+  last_update_[particle] = time_;
+}
+
+void EventDrivenEngine::Predict(uint32_t particle, bool only_later_particles) {
+  double x = x_[particle];
+  double y = y_[particle];
+  double x_velocity = x_velocity_[particle];
+  double y_velocity = y_velocity_[particle];
+  double radius = radius_[particle];
+
+  // The walls. A particle that already overlaps a wall it is moving toward
+  // bounces right away
+  AddEvent(FindWallCollisionTime(x, x_velocity, radius, x_lower_bound_,
+                                 x_upper_bound_),
+           EventType::kVerticalWall, particle, particle);
+  AddEvent(FindWallCollisionTime(y, y_velocity, radius, y_lower_bound_,
+                                 y_upper_bound_),
+           EventType::kHorizontalWall, particle, particle);
+
+  // The next cell border the center crosses. The outer side of the border
+  // cells has no border since the walls are there
+  uint32_t column = column_[particle];
+  uint32_t row = row_[particle];
+  if (x_velocity > 0 && column + 1 < columns_) {
+    AddEvent((x_lower_bound_ + (column + 1) * cell_size_ - x) / x_velocity,
+             EventType::kColumnCrossing, particle, particle);
+  } else if (x_velocity < 0 && column > 0) {
+    AddEvent((x_lower_bound_ + column * cell_size_ - x) / x_velocity,
+             EventType::kColumnCrossing, particle, particle);
+  }
+
+  if (y_velocity > 0 && row + 1 < rows_) {
+    AddEvent((y_lower_bound_ + (row + 1) * cell_size_ - y) / y_velocity,
+             EventType::kRowCrossing, particle, particle);
+  } else if (y_velocity < 0 && row > 0) {
+    AddEvent((y_lower_bound_ + row * cell_size_ - y) / y_velocity,
+             EventType::kRowCrossing, particle, particle);
+  }
+
+  // The other particles in this cell and the eight around it
+  for (long neighbor_row = (long) row - 1; neighbor_row <= (long) row + 1;
+       neighbor_row++) {
+    for (long neighbor_column = (long) column - 1;
+         neighbor_column <= (long) column + 1; neighbor_column++) {
+      if (neighbor_row < 0 || neighbor_row >= (long) rows_ ||
+          neighbor_column < 0 || neighbor_column >= (long) columns_) {
+        continue;
+      }
+
+      for (uint32_t other : cells_[neighbor_row * columns_ +
+          neighbor_column]) {
+        if (other == particle || (only_later_particles && other < particle)) {
+          continue;
+        }
+        PredictCollision(particle, other);
+      }
+    }
+  }
+}
+
+void EventDrivenEngine::PredictCollision(uint32_t particle1,
+                                         uint32_t particle2) {
+
+  // Where the second particle is now, without changing its stored state
+  double elapsed = time_ - last_update_[particle2];
+  double x_difference = x_[particle2] + x_velocity_[particle2] * elapsed -
+      x_[particle1];
+  double y_difference = y_[particle2] + y_velocity_[particle2] * elapsed -
+      y_[particle1];
+  double x_velocity_difference = x_velocity_[particle2] -
+      x_velocity_[particle1];
+  double y_velocity_difference = y_velocity_[particle2] -
+      y_velocity_[particle1];
+
+  AddEvent(FindCollisionTime(x_difference, y_difference,
+                             x_velocity_difference, y_velocity_difference,
+                             radius_[particle1] + radius_[particle2]),
+           EventType::kParticle, particle1, particle2);
+}
+
+void EventDrivenEngine::Process(const Event &event) {
+  uint32_t particle1 = event.particle1;
+  uint32_t particle2 = event.particle2;
+  Synchronize(particle1);
+
+  switch (event.type) {
+    case EventType::kParticle:
+      Synchronize(particle2);
+      CollideHardDisks(x_[particle1] - x_[particle2],
+                       y_[particle1] - y_[particle2],
+                       inverse_mass_[particle1], inverse_mass_[particle2],
+                       x_velocity_[particle1], y_velocity_[particle1],
+                       x_velocity_[particle2], y_velocity_[particle2]);
+      collided_.push_back(particle1);
+      collided_.push_back(particle2);
+      particle_collision_count_++;
+      break;
+
+    case EventType::kVerticalWall:
+      x_velocity_[particle1] = -x_velocity_[particle1];
+      wall_collision_count_++;
+      break;
+
+    case EventType::kHorizontalWall:
+      y_velocity_[particle1] = -y_velocity_[particle1];
+      wall_collision_count_++;
+      break;
+
+    case EventType::kColumnCrossing:
+      MoveToCell(particle1, x_velocity_[particle1] > 0 ?
+          column_[particle1] + 1 : column_[particle1] - 1, row_[particle1]);
+      break;
+
+    case EventType::kRowCrossing:
+      MoveToCell(particle1, column_[particle1], y_velocity_[particle1] > 0 ?
+          row_[particle1] + 1 : row_[particle1] - 1);
+      break;
+  }
+
+  // Everything predicted for these particles before is out of date now
+  event_count_[particle1]++;
+  Predict(particle1, false);
+  if (particle2 != particle1) {
+    event_count_[particle2]++;
+    Predict(particle2, false);
+  }
+}
+
+void EventDrivenEngine::MoveToCell(uint32_t particle, uint32_t column,
+                                   uint32_t row) {
+
+  // Swaps the particle with the last one in its old cell to remove it
+  std::vector<uint32_t> &old_cell = cells_[row_[particle] * columns_ +
+      column_[particle]];
+  uint32_t last = old_cell.back();
+  old_cell[slot_[particle]] = last;
+  slot_[last] = slot_[particle];
+  old_cell.pop_back();
+
+  std::vector<uint32_t> &new_cell = cells_[row * columns_ + column];
+  column_[particle] = column;
+  row_[particle] = row;
+  slot_[particle] = (uint32_t) new_cell.size();
+  new_cell.push_back(particle);
+}
+
+void EventDrivenEngine::Rebuild() {
+  events_ = std::priority_queue<Event, std::vector<Event>,
+                                std::greater<Event>>();
+  for (uint32_t i = 0; i < x_.size(); i++) {
+    Synchronize(i);
+  }
+  for (uint32_t i = 0; i < x_.size(); i++) {
+    Predict(i, true);
+  }
+}
+
+void EventDrivenEngine::AddEvent(double delay, EventType type,
+                                 uint32_t particle1, uint32_t particle2) {
+  if (std::isinf(delay)) {
+    return;
+  }
+  
+  Event event;
+  event.time = time_ + std::max(delay, 0.0);
+  event.type = type;
+  event.particle1 = particle1;
+  event.particle2 = particle2;
+  event.particle1_events = event_count_[particle1];
+  event.particle2_events = event_count_[particle2];
+  events_.push(event);
+}
+
+uint32_t EventDrivenEngine::FindCellIndex(double coordinate,
+                                          double lower_bound,
+                                          size_t cells) const {
+  double index = std::floor((coordinate - lower_bound) / cell_size_);
+  if (index < 0) {
+    return 0;
+  }
+  return (uint32_t) std::min((size_t) index, cells - 1);
+}
+
+} // namespace idealgas
@@ -0,0 +1,72 @@
+#include <hard_disk_collisions.h>
+#include <cmath>
+#include <limits>
+
+namespace idealgas {
+
+double FindCollisionTime(double x_difference, double y_difference,
+                         double x_velocity_difference,
+                         double y_velocity_difference, double radii_sum) {
+  
+  // They have to be moving toward each other
+  double approach = x_difference * x_velocity_difference +
+      y_difference * y_velocity_difference;
+  if (approach >= 0) {
+    return std::numeric_limits<double>::infinity();
+  }
+
+  // Solves |dx + dv * t| = r1 + r2 for the first time t they touch. If the
+  // discriminant is negative they pass by without touching
+  double speed_squared = x_velocity_difference * x_velocity_difference +
+      y_velocity_difference * y_velocity_difference;
+  double distance_squared = x_difference * x_difference +
+      y_difference * y_difference;
+  double discriminant = approach * approach - speed_squared *
+      (distance_squared - radii_sum * radii_sum);
+  if (discriminant < 0) {
+    return std::numeric_limits<double>::infinity();
+  }
+  
+  // Circles that already overlap get a negative time and collide now
+  double time = -(approach + std::sqrt(discriminant)) / speed_squared;
+  return time > 0 ? time : 0;
+}
+
+double FindWallCollisionTime(double position, double velocity, double radius,
+                             double lower_bound, double upper_bound) {
+  double time;
+  if (velocity > 0) {
+    time = (upper_bound - radius - position) / velocity;
+  } else if (velocity < 0) {
+    time = (lower_bound + radius - position) / velocity;
+  } else {
+    return std::numeric_limits<double>::infinity();
+  }
+  return time > 0 ? time : 0;
+}
+
+void CollideHardDisks(double x_difference, double y_difference,
+                      double inverse_mass1, double inverse_mass2,
+                      double &x_velocity1, double &y_velocity1,
+                      double &x_velocity2, double &y_velocity2) {
+  double distance_squared = x_difference * x_difference +
+      y_difference * y_difference;
+  if (distance_squared == 0) {
+    return;
+  }
+
+  double approach = (x_velocity1 - x_velocity2) * x_difference +
+      (y_velocity1 - y_velocity2) * y_difference;
+
+  // The mass ratios 2 * m2 / (m1 + m2) and 2 * m1 / (m1 + m2) written with
+  // the reduced mass, like in the narrowphase
+  double reduced_mass = 1 / (inverse_mass1 + inverse_mass2);
+  double impulse = 2 * reduced_mass * approach / distance_squared;
+
+  x_velocity1 -= impulse * inverse_mass1 * x_difference;
+  y_velocity1 -= impulse * inverse_mass1 * y_difference;
+  x_velocity2 += impulse * inverse_mass2 * x_difference;
+  y_velocity2 += impulse * inverse_mass2 * y_difference;
+}
+
+} // namespace idealgas
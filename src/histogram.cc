@@ -1,42 +1,16 @@
 #include "histogram.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
 
 namespace idealgas {
 
-Histogram::Histogram(double mass) {
+Histogram::Histogram(uint32_t species, double mass) {
   bins_ = std::vector<size_t>(kNumberOfPartitions);
+  species_ = species;
   mass_ = mass;
 }
 
-void Histogram::Draw(size_t position, const std::vector<Particle> &particles) {
-
-  // We first get the updated particles of a given mass
-  particles_ = FindAllParticlesWithMass(particles);
-  FillBins(particles_);
-
-  // We get the coordinates to draw out the lines for our histogram
-  vertical_axis_top_left_ = glm::vec2(kXLowerBound, position - kHeight);
-  vertical_axis_bottom_left_ = glm::vec2(kXLowerBound, position);
-  horizontal_axis_bottom_left_ = glm::vec2(kXLowerBound, position);
-  horizontal_axis_bottom_right_ = glm::vec2(kXUpperBound, position);
-  
-  // Set the lower bound for later use
-  lower_bound_ = horizontal_axis_bottom_right_.y;
-
-  // Draws the histogram lines
-  ci::gl::color(ci::Color("white"));
-  ci::gl::drawLine(vertical_axis_top_left_, vertical_axis_bottom_left_);
-  ci::gl::drawLine(horizontal_axis_bottom_left_, horizontal_axis_bottom_right_);
-
-  // Draw the title and axis/labels for the histogram
-  DrawTitle();
-  DrawAxisTitles();
-  DrawXAxisLabels();
-  DrawYAxisLabels();
-  
-  // Update the histogram which continuously draws rectangles 
-  UpdateHistogram();
-}
-
 std::vector<Particle> Histogram::FindAllParticlesWithMass(const std::vector<
     Particle> &particles) const {
   std::vector<Particle> all_particles;
@@ -52,156 +26,202 @@ std::vector<Particle> Histogram::FindAllParticlesWithMass(const std::vector<
   return all_particles;
 }
 
-void Histogram::DrawTitle() {
-
-
-  // We know mass and color are the same since we sorted them initially so we
-  // just get the first particle's mass and color to use in the graph's title
-  // size_t mass = particles_.at(0).GetMass();
-  std::string color = particles_.at(0).GetColor();
-
-  ci::gl::drawStringCentered("Histogram of " + std::to_string((size_t) mass_) +
-                                 " mass (" + color + ") particles",
-                             glm::vec2((kXUpperBound - kXLowerBound) * .60,
-                                       (lower_bound_ - kHeight
-                                           - 20)), ci::Color("white"),
-                             ci::Font("Arial", 15));
+void Histogram::FillBins(const std::vector<Particle> &particles) {
+  PhaseTimer timer(instrumentation_, Phase::kBinning);
+  particle_count_ = particles.size();
+  if (!particles.empty()) {
+    color_ = particles.front().GetColor();
+  }
+  
+  std::fill(bins_.begin(), bins_.end(), 0);
+  for (const Particle &particle : particles) {
+    size_t bin = FindBin(GetSpeed(particle.GetVelocity().x, 
+                                  particle.GetVelocity().y));
+    if (bin < kNumberOfPartitions) {
+      bins_[bin]++;
+    }
+  }
+  instrumentation_.AddCount(Counter::kBinnedParticles, particle_count_);
 }
 
-void Histogram::DrawXAxisLabels() {
-
-  double speed_range = kMaxSpeed / kNumberOfPartitions;
-  double bar_width = (kXUpperBound - kXLowerBound) / kNumberOfPartitions;
-  ci::gl::color(ci::Color("white"));
+void Histogram::FillBins(const ParticleStore &particles) {
+  FillBins(particles, this, 1);
+}
 
-  // A double for loop that loops through each bar to get the location to 
-  // draw the label and the speed that is what actually gets drawn
-  for (double bar = 0, speed = 0; bar < kXUpperBound && speed <=
-      kMaxSpeed; bar += bar_width, speed += speed_range) {
-    
-    ci::gl::drawStringCentered(std::to_string((size_t) speed), glm::vec2
-                                   (kXLowerBound + bar, (lower_bound_ + 5)),
-                               ci::Color("white"),
-                               ci::Font("Arial", 15));
+void Histogram::FillBins(const ParticleStore &particles,
+                         std::vector<Histogram> &histograms) {
+  if (!histograms.empty()) {
+    FillBins(particles, histograms.data(), histograms.size());
   }
 }
 
-void Histogram::DrawYAxisLabels() {
-  size_t particle_num_range = particles_.size() / kNumberOfPartitions;
-  size_t partitions = kHeight / kNumberOfPartitions;
+void Histogram::FillBins(const ParticleStore &particles,
+                         Histogram *histograms, size_t count) {
+  PhaseTimer timer(histograms[0].instrumentation_, Phase::kBinning);
+  for (size_t h = 0; h < count; h++) {
+    std::fill(histograms[h].bins_.begin(), histograms[h].bins_.end(), 0);
+    histograms[h].particle_count_ = 0;
+  }
+  
+  size_t lookup[kSpeciesLookupSize];
+  BuildSpeciesLookup(histograms, count, lookup);
+  
+  const float *x_velocity = particles.GetXVelocity();
+  const float *y_velocity = particles.GetYVelocity();
+  const uint32_t *species = particles.GetSpeciesIndices();
+  for (size_t i = 0; i < particles.size(); i++) {
+    size_t h = LookUpHistogram(species[i], lookup, histograms, count);
+    if (h == count) {
+      continue;
+    }
+    
+    Histogram &histogram = histograms[h];
+    if (histogram.particle_count_ == 0) {
+      histogram.color_ = particles.GetColor(i);
+    }
+    histogram.particle_count_++;
+    
+    size_t bin = FindBin(GetSpeed(x_velocity[i], y_velocity[i]));
+    if (bin < kNumberOfPartitions) {
+      histogram.bins_[bin]++;
+    }
+  }
   
-  // Two variable for loop that loops through particle ranges that represent 
-  // the label on the y axis and the partitions that will be used to locate 
-  // where to draw the labels 
-  for (size_t num = particle_num_range, height = partitions;
-       num < particles_.size() &&
-           height < kHeight; num += particle_num_range, height += partitions) {
-
-    ci::gl::drawStringCentered(std::to_string((size_t) num), glm::vec2
-                                   (kXLowerBound - 15, (lower_bound_ -
-                                       height)),
-                               ci::Color("white"),
-                               ci::Font("Arial", 15));
+  for (size_t h = 0; h < count; h++) {
+    histograms[h].instrumentation_.AddCount(Counter::kBinnedParticles,
+                                            histograms[h].particle_count_);
   }
-
-  // Labels the max number of particles
-  ci::gl::drawStringCentered(std::to_string(particles_.size()), glm::vec2
-                                 (kXLowerBound - 15, (lower_bound_ - kHeight)),
-                             ci::Color("white"),
-                             ci::Font("Arial", 15));
 }
 
-void Histogram::DrawAxisTitles() {
-
-  ci::gl::drawStringCentered("Speed",
-                             glm::vec2(kXUpperBound / 2, lower_bound_ + 25),
-                             ci::Color("white"),
-                             ci::Font("Arial", 15));
-
-  ci::gl::drawStringCentered("# of Particles", glm::vec2
-                                 (kXLowerBound - 3, (lower_bound_ - kHeight -
-                                     20)),
-                             ci::Color("white"),
-                             ci::Font("Arial", 15));
+void Histogram::ApplySpeedChanges(
+    const ParticleStore &particles,
+    const std::vector<SpeedChange> &speed_changes) {
+  ApplySpeedChanges(particles, speed_changes, this, 1);
 }
 
-
-void Histogram::FillBins(const std::vector<Particle> &particles) {
-
-  double speed_range = kMaxSpeed / kNumberOfPartitions;
-
-  for (double min_speed = 0, bin = 0;
-       min_speed < kMaxSpeed && bin < kNumberOfPartitions;
-       min_speed += speed_range, bin++) {
-
-    // Gets all the particles in the range that will represent the height of 
-    // the bar 
-    size_t all_particles_in_range = FindAllParticlesInSpeedRange(particles,
-                                                                 min_speed,
-                                                                 min_speed + speed_range);
-
-    // Populate the bins with the number of particles in each range of speeds
-    bins_[bin] = all_particles_in_range;
+void Histogram::ApplySpeedChanges(
+    const ParticleStore &particles,
+    const std::vector<SpeedChange> &speed_changes,
+    std::vector<Histogram> &histograms) {
+  if (!histograms.empty()) {
+    ApplySpeedChanges(particles, speed_changes, histograms.data(),
+                      histograms.size());
   }
 }
 
+void Histogram::ApplySpeedChanges(
+    const ParticleStore &particles,
+    const std::vector<SpeedChange> &speed_changes, Histogram *histograms,
+    size_t count) {
+  PhaseTimer timer(histograms[0].instrumentation_, Phase::kBinning);
+  size_t lookup[kSpeciesLookupSize];
+  BuildSpeciesLookup(histograms, count, lookup);
+  for (const SpeedChange &change : speed_changes) {
+    size_t h = LookUpHistogram(particles.GetSpeciesIndex(change.particle), 
+                               lookup, histograms, count);
+    if (h == count) {
+      continue;
+    }
+    
+    Histogram &histogram = histograms[h];
+    if (change.old_speed == kNoSpeed) {
+      if (histogram.particle_count_ == 0) {
+        histogram.color_ = particles.GetColor(change.particle);
+      }
+      histogram.particle_count_++;
+    } else {
+      size_t old_bin = FindBin(change.old_speed);
+      if (old_bin < kNumberOfPartitions) {
+        histogram.bins_[old_bin]--;
+      }
+    }
+    
+    size_t new_bin = FindBin(change.new_speed);
+    if (new_bin < kNumberOfPartitions) {
+      histogram.bins_[new_bin]++;
+    }
+    histogram.instrumentation_.AddCount(Counter::kBinnedParticles, 1);
+  }
+}
 
-size_t Histogram::FindAllParticlesInSpeedRange(const std::vector<Particle>
-                                               &particles,
-                                               double min_speed,
-                                               double max_speed) const {
-  size_t count = 0;
-  for (const Particle &particle : particles) {
-    double p_speed = glm::length(particle.GetVelocity());
+size_t Histogram::FindHistogram(uint32_t species, 
+                                const Histogram *histograms, size_t count) {
+  
+  // There are only a few histograms, so finding the one for a species is a
+  // couple of compares
+  size_t h = 0;
+  while (h < count && histograms[h].species_ != species) {
+    h++;
+  }
+  return h;
+}
 
-    // We make the lower bound exclusive and the upper bound inclusive to 
-    // prevent double counting on the bounds
-    if (p_speed >= min_speed && p_speed < max_speed) {
-      count++;
+void Histogram::BuildSpeciesLookup(const Histogram *histograms, 
+                                   size_t count, size_t *lookup) {
+  std::fill(lookup, lookup + kSpeciesLookupSize, count);
+  
+  // Goes backwards so the first histogram of a species wins, like in 
+  // FindHistogram
+  for (size_t h = count; h > 0; h--) {
+    if (histograms[h - 1].species_ < kSpeciesLookupSize) {
+      lookup[histograms[h - 1].species_] = h - 1;
     }
   }
-  return count;
 }
 
-void Histogram::UpdateHistogram() {
+size_t Histogram::LookUpHistogram(uint32_t species, const size_t *lookup,
+                                  const Histogram *histograms, size_t count) {
+  if (species < kSpeciesLookupSize) {
+    return lookup[species];
+  }
+  return FindHistogram(species, histograms, count);
+}
 
-  // We first get the bar width and the speed range for our histogram for 
-  // each partition in the histogram
-  double bar_width = (kXUpperBound - kXLowerBound) / kNumberOfPartitions;
-  ci::gl::color(ci::Color("white"));
+size_t Histogram::FindBin(double speed) {
+  const double kSpeedRange = kMaxSpeed / kNumberOfPartitions;
+  if (!(speed >= 0)) {
+    return kNumberOfPartitions;
+  }
+  
+  // The division can round up to the next bin right below its lower bound,
+  // so the bin is checked against its bounds. The lower bound is inclusive
+  // and the upper bound exclusive, which keeps the bounds from being 
+  // counted twice
+  double bin = std::floor(speed / kSpeedRange);
+  if (bin * kSpeedRange > speed) {
+    bin--;
+  } else if ((bin + 1) * kSpeedRange <= speed) {
+    bin++;
+  }
+  return bin < kNumberOfPartitions ? (size_t) bin : kNumberOfPartitions;
+}
 
-  // We get the lower bound for the histogram
-  double lower_bound = horizontal_axis_bottom_right_.y;
+const std::vector<size_t> &Histogram::GetBins() const {
+  return bins_;
+}
 
-  // A for loop that loops through the bar and the bins. Looping through 
-  // each bar allows us to be able to draw the individual bars for each 
-  // partition in the histogram. Looping through the bins allows us to get 
-  // the number of particles in each bin to be used to draw the rectangles 
-  // for the histogram 
-  for (double bar = 0, bin = 0; bar < kXUpperBound && bin <
-      kNumberOfPartitions; bar += bar_width, bin++) {
+uint32_t Histogram::GetSpecies() const {
+  return species_;
+}
 
+double Histogram::GetMass() const {
+  return mass_;
+}
 
-    // The scaling factor is used to scale the bars to make it better 
-    // visually. This also prevents the bars from going past the height of 
-    // the histogram if there are many particles 
-    double scaling_factor = 180 / (double) particles_.size();
+size_t Histogram::GetParticleCount() const {
+  return particle_count_;
+}
 
-    // Gets the top left coordinate of the bar. The height is calculated from
-    // the number of particles in the range times a scaling factor for 
-    // visually look better
-    glm::vec2 top_left = glm::vec2(kXLowerBound + bar, lower_bound -
-        (bins_[bin] * scaling_factor));
-    glm::vec2 bottom_right = glm::vec2(kXLowerBound + bar + bar_width,
-                                       lower_bound);
-    ci::Rectf h_bar(top_left, bottom_right);
+const std::string &Histogram::GetColor() const {
+  return color_;
+}
 
-    ci::gl::drawSolidRect(h_bar);
-  }
+InstrumentationSnapshot Histogram::GetInstrumentationSnapshot() const {
+  return instrumentation_.GetSnapshot();
 }
 
-const std::vector<size_t> &Histogram::GetBins() const {
-  return bins_;
+void Histogram::ResetInstrumentation() {
+  instrumentation_.Reset();
 }
 
 } // namespace idealgas
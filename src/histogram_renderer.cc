@@ -0,0 +1,136 @@
+#include <histogram_renderer.h>
+
+namespace idealgas {
+
+void HistogramRenderer::Draw(const Histogram &histogram, size_t position) {
+
+  // We get the coordinates to draw out the lines for our histogram
+  vertical_axis_top_left_ = glm::vec2(kXLowerBound, position - kHeight);
+  vertical_axis_bottom_left_ = glm::vec2(kXLowerBound, position);
+  horizontal_axis_bottom_left_ = glm::vec2(kXLowerBound, position);
+  horizontal_axis_bottom_right_ = glm::vec2(kXUpperBound, position);
+  
+  // Set the lower bound for later use
+  lower_bound_ = horizontal_axis_bottom_right_.y;
+
+  // Draws the histogram lines
+  ci::gl::color(ci::Color("white"));
+  ci::gl::drawLine(vertical_axis_top_left_, vertical_axis_bottom_left_);
+  ci::gl::drawLine(horizontal_axis_bottom_left_, horizontal_axis_bottom_right_);
+
+  // Draw the title and axis/labels for the histogram
+  DrawTitle(histogram);
+  DrawAxisTitles();
+  DrawXAxisLabels();
+  DrawYAxisLabels(histogram);
+  
+  // Draws a rectangle for each bin
+  DrawBars(histogram);
+}
+
+void HistogramRenderer::DrawTitle(const Histogram &histogram) {
+
+  // We know mass and color are the same since we sorted them initially so we
+  // use the color of the particles we filled the bins with in the title
+  text_cache_.DrawCentered("Histogram of " + 
+                               std::to_string((size_t) histogram.GetMass()) +
+                               " mass (" + histogram.GetColor() + 
+                               ") particles",
+                           glm::vec2((kXUpperBound - kXLowerBound) * .60,
+                                     (lower_bound_ - kHeight - 20)), 
+                           ci::Color("white"));
+}
+
+void HistogramRenderer::DrawXAxisLabels() {
+
+  double speed_range = Histogram::kMaxSpeed / Histogram::kNumberOfPartitions;
+  double bar_width = (kXUpperBound - kXLowerBound) / 
+      Histogram::kNumberOfPartitions;
+  ci::gl::color(ci::Color("white"));
+
+  // A double for loop that loops through each bar to get the location to 
+  // draw the label and the speed that is what actually gets drawn
+  for (double bar = 0, speed = 0; bar < kXUpperBound && speed <=
+      Histogram::kMaxSpeed; bar += bar_width, speed += speed_range) {
+    
+    text_cache_.DrawCentered(std::to_string((size_t) speed), glm::vec2
+                                 (kXLowerBound + bar, (lower_bound_ + 5)),
+                             ci::Color("white"));
+  }
+}
+
+void HistogramRenderer::DrawYAxisLabels(const Histogram &histogram) {
+  size_t particle_count = histogram.GetParticleCount();
+  size_t particle_num_range = particle_count / Histogram::kNumberOfPartitions;
+  size_t partitions = kHeight / Histogram::kNumberOfPartitions;
+  
+  // Two variable for loop that loops through particle ranges that represent 
+  // the label on the y axis and the partitions that will be used to locate 
+  // where to draw the labels 
+  for (size_t num = particle_num_range, height = partitions;
+       num < particle_count &&
+           height < kHeight; num += particle_num_range, height += partitions) {
+
+    text_cache_.DrawCentered(std::to_string((size_t) num), glm::vec2
+                                 (kXLowerBound - 15, (lower_bound_ - height)),
+                             ci::Color("white"));
+  }
+
+  // Labels the max number of particles
+  text_cache_.DrawCentered(std::to_string(particle_count), glm::vec2
+                               (kXLowerBound - 15, (lower_bound_ - kHeight)),
+                           ci::Color("white"));
+}
+
+void HistogramRenderer::DrawAxisTitles() {
+
+  text_cache_.DrawCentered("Speed",
+                           glm::vec2(kXUpperBound / 2, lower_bound_ + 25),
+                           ci::Color("white"));
+
+  text_cache_.DrawCentered("# of Particles", glm::vec2
+                               (kXLowerBound - 3, (lower_bound_ - kHeight -
+                                   20)),
+                           ci::Color("white"));
+}
+
+void HistogramRenderer::DrawBars(const Histogram &histogram) {
+
+  // We first get the bar width and the speed range for our histogram for 
+  // each partition in the histogram
+  double bar_width = (kXUpperBound - kXLowerBound) / 
+      Histogram::kNumberOfPartitions;
+  ci::gl::color(ci::Color("white"));
+
+  // We get the lower bound for the histogram
+  double lower_bound = horizontal_axis_bottom_right_.y;
+  const std::vector<size_t> &bins = histogram.GetBins();
+
+  // A for loop that loops through the bar and the bins. Looping through 
+  // each bar allows us to be able to draw the individual bars for each 
+  // partition in the histogram. Looping through the bins allows us to get 
+  // the number of particles in each bin to be used to draw the rectangles 
+  // for the histogram 
+  for (double bar = 0, bin = 0; bar < kXUpperBound && bin <
+      Histogram::kNumberOfPartitions; bar += bar_width, bin++) {
+
+
+    // The scaling factor is used to scale the bars to make it better 
+    // visually. This also prevents the bars from going past the height of 
+    // the histogram if there are many particles 
+    double scaling_factor = 180 / (double) histogram.GetParticleCount();
+
+    // Gets the top left coordinate of the bar. The height is calculated from
+    // the number of particles in the range times a scaling factor for 
+    // visually look better
+    glm::vec2 top_left = glm::vec2(kXLowerBound + bar, lower_bound -
+        (bins[bin] * scaling_factor));
+    glm::vec2 bottom_right = glm::vec2(kXLowerBound + bar + bar_width,
+                                       lower_bound);
+    ci::Rectf h_bar(top_left, bottom_right);
+
+    ci::gl::drawSolidRect(h_bar);
+  }
+}
+
+} // namespace idealgas
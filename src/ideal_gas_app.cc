@@ -3,6 +3,20 @@
 
 namespace idealgas {
 
+namespace {
+
+SpeciesOptions MakeDefaultSpecies(size_t count, double radius, double mass,
+                                  const std::string &color) {
+  SpeciesOptions species;
+  species.count = count;
+  species.radius = radius;
+  species.mass = mass;
+  species.color = color;
+  return species;
+}
+
+} // namespace
+
 
 IdealGasApp::IdealGasApp() {
   ci::app::setWindowSize(ParticleSimulator::kWindowSizeWidth, ParticleSimulator::kWindowSizeHeight);
@@ -10,56 +24,111 @@ IdealGasApp::IdealGasApp() {
 
 
 void IdealGasApp::setup() {
-  particle_simulator_.AddParticles(kSmallParticleAmount,
-                                   kSmallParticleRadius, kSmallParticleMass, kSmallParticleColor);
-  histograms_.push_back(Histogram(kSmallParticleMass));
+  BatchOptions scenario = LoadAppScenario();
+  container_ = scenario.container;
+  ParticleSimulator particle_simulator;
+  particle_simulator.SetContainer(scenario.container);
+  if (scenario.has_seed) {
+    particle_simulator.SetSeed(scenario.seed);
+  }
+  particle_simulator.SetTimeStep(scenario.time_step);
+  particle_simulator.SetThreadCount(scenario.thread_count);
+  particle_simulator.SetEngine(scenario.engine);
+  particle_simulator.SetCollisionDetection(scenario.collision_detection);
+  particle_simulator.SetBroadphase(scenario.broadphase);
+  particle_simulator.SetPlacement(scenario.placement);
+  
+  // Each species gets its own histogram
+  std::vector<Histogram> histograms;
+  for (const SpeciesOptions &species : scenario.species) {
+    particle_simulator.AddParticles(species.count, species.radius,
+                                    species.mass, species.color);
+    histograms.push_back(Histogram(
+        particle_simulator.GetParticles().FindSpecies(
+            species.radius, species.mass, species.color), species.mass));
+  }
 
-  particle_simulator_.AddParticles(kMediumParticleAmount,
-                                   kMediumParticleRadius, kMediumParticleMass, kMediumParticleColor);
-  histograms_.push_back(Histogram(kMediumParticleMass));
+  // From here on the simulation thread owns the simulation and keeps the
+  // histograms up to date from the particles whose speed changed
+  simulation_thread_.reset(new SimulationThread(particle_simulator,
+                                                histograms, kTicksPerSecond));
+  simulation_thread_->Start();
+}
 
-  particle_simulator_.AddParticles(kBigParticleAmount, kBigParticleRadius,
-                                   kBigParticleMass,kBigParticleColor);
-  histograms_.push_back(Histogram(kBigParticleMass));
+BatchOptions IdealGasApp::LoadAppScenario() {
+  
+  // The first command line argument can name another scenario to run. 
+  // getAssetPath gives an empty path if the default one is missing, which 
+  // fails to load like any other missing file
+  const std::vector<std::string> &arguments = getCommandLineArgs();
+  std::string path = arguments.size() > 1 ? arguments[1] : 
+      ci::app::getAssetPath(kDefaultScenarioPath).string();
+  try {
+    return LoadScenario(path);
+  } catch (const std::exception &error) {
+    ci::app::console() << "Could not load the scenario " << path << ", so "
+                       << "the default particles are used instead: " 
+                       << error.what() << std::endl;
+  }
+  
+  BatchOptions scenario;
+  scenario.species = {MakeDefaultSpecies(25, 8, 5, "red"), 
+                      MakeDefaultSpecies(25, 12, 25, "green"),
+                      MakeDefaultSpecies(25, 20, 100, "blue")};
+  return scenario;
+}
+
+void IdealGasApp::cleanup() {
+  simulation_thread_.reset();
 }
 
 void IdealGasApp::draw() {
   ci::Color8u background_color(0, 0, 0);  // black
   ci::gl::clear(background_color);
-  particle_simulator_.Draw();
+  
+  // The snapshot stays the same while this frame is drawn, even though the 
+  // simulation keeps running
+  const SimulationSnapshot &snapshot = simulation_thread_->GetLatestSnapshot();
+  particle_renderer_.Draw(snapshot.particles, container_);
 
-  size_t num_histograms = histograms_.size();
+  size_t num_histograms = snapshot.histograms.size();
   size_t index = 0;
   
-  for (Histogram& histogram : histograms_) {
+  for (const Histogram& histogram : snapshot.histograms) {
     index++;
 
     // We then draw the histogram based on the number of histograms there 
     // are. The equation used to find the position allows for it to scale 
     // based on the different number of particle masses
-    histogram.Draw((ParticleSimulator::kYUpperBound / num_histograms) *
-        1.05 * index, particle_simulator_.GetParticles());
+    histogram_renderer_.Draw(histogram, (ParticleSimulator::kYUpperBound / 
+        num_histograms) * 1.05 * index);
   }
 
-  ci::gl::drawStringCentered(
+  banner_text_.DrawCentered(
       "Press the left arrow to slow down the simulation. Press the right "
       "arrow to speed up the simulation!",
       glm::vec2(ParticleSimulator::kWindowSizeWidth * .60, ParticleSimulator::kYLowerBound / 2),
-      ci::Color("white"), ci::Font("Times New Roman", 20));
+      ci::Color("white"));
 }
 
 void IdealGasApp::update() {
-  particle_simulator_.Update();
+  
+  // The simulation advances on its own thread by the real time that passes, 
+  // so the speed of the simulation doesn't depend on the frame rate
 }
 
 void IdealGasApp::keyDown(ci::app::KeyEvent event) {
   switch (event.getCode()) {
     case ci::app::KeyEvent::KEY_LEFT:
-      particle_simulator_.SlowDown();
+      simulation_thread_->Post([](ParticleSimulator &simulator) {
+        simulator.SlowDown();
+      });
       break;
       
     case ci::app::KeyEvent::KEY_RIGHT:
-      particle_simulator_.SpeedUp();
+      simulation_thread_->Post([](ParticleSimulator &simulator) {
+        simulator.SpeedUp();
+      });
       break;
   } 
 }
@@ -0,0 +1,41 @@
+#include <instrumentation.h>
+
+namespace idealgas {
+
+const char *GetPhaseName(Phase phase) {
+  switch (phase) {
+    case Phase::kBroadphase:
+      return "broadphase";
+    case Phase::kNarrowphase:
+      return "narrowphase";
+    case Phase::kCollisionResponse:
+      return "collision_response";
+    case Phase::kIntegration:
+      return "integration";
+    case Phase::kContinuousCollisions:
+      return "continuous_collisions";
+    case Phase::kEventProcessing:
+      return "event_processing";
+    case Phase::kBinning:
+      return "binning";
+  }
+  return "unknown";
+}
+
+const char *GetCounterName(Counter counter) {
+  switch (counter) {
+    case Counter::kUpdates:
+      return "updates";
+    case Counter::kCandidatePairs:
+      return "candidate_pairs";
+    case Counter::kCollisions:
+      return "collisions";
+    case Counter::kWallBounces:
+      return "wall_bounces";
+    case Counter::kBinnedParticles:
+      return "binned_particles";
+  }
+  return "unknown";
+}
+
+} // namespace idealgas
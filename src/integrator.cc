@@ -0,0 +1,347 @@
+#include <integrator.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IDEAL_GAS_SSE2
+#endif
+
+namespace idealgas {
+
+// The wall checks in Particle::Update compare the float position against
+// the bound plus or minus the double radius, which C++ does in double. The
+// SIMD versions widen the positions to double before comparing so that the
+// results match bit for bit.
+
+#if defined(__AVX2__)
+
+/**
+ * Finds the lanes where position <= bound + radius
+ */
+static inline __m256 AtOrBelow(__m256 position, __m256d low_radii,
+                               __m256d high_radii, __m256d bound) {
+  const __m256i kEvenLanes = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+  __m256d low = _mm256_cmp_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(
+      position)), _mm256_add_pd(bound, low_radii), _CMP_LE_OQ);
+  __m256d high = _mm256_cmp_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(
+      position, 1)), _mm256_add_pd(bound, high_radii), _CMP_LE_OQ);
+
+  // Each 64 bit mask is all ones or all zeros, so keeping the lower half of
+  // each gives the 32 bit mask for the float lane
+  __m128 low_mask = _mm256_castps256_ps128(_mm256_permutevar8x32_ps(
+      _mm256_castpd_ps(low), kEvenLanes));
+  __m128 high_mask = _mm256_castps256_ps128(_mm256_permutevar8x32_ps(
+      _mm256_castpd_ps(high), kEvenLanes));
+  return _mm256_insertf128_ps(_mm256_castps128_ps256(low_mask), high_mask, 1);
+}
+
+/**
+ * Finds the lanes where position >= bound - radius
+ */
+static inline __m256 AtOrAbove(__m256 position, __m256d low_radii,
+                               __m256d high_radii, __m256d bound) {
+  const __m256i kEvenLanes = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+  __m256d low = _mm256_cmp_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(
+      position)), _mm256_sub_pd(bound, low_radii), _CMP_GE_OQ);
+  __m256d high = _mm256_cmp_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(
+      position, 1)), _mm256_sub_pd(bound, high_radii), _CMP_GE_OQ);
+  __m128 low_mask = _mm256_castps256_ps128(_mm256_permutevar8x32_ps(
+      _mm256_castpd_ps(low), kEvenLanes));
+  __m128 high_mask = _mm256_castps256_ps128(_mm256_permutevar8x32_ps(
+      _mm256_castpd_ps(high), kEvenLanes));
+  return _mm256_insertf128_ps(_mm256_castps128_ps256(low_mask), high_mask, 1);
+}
+
+/**
+ * Looks up the radii of four particles in the species table. The masked
+ * gather with a zeroed source is used because GCC warns about the
+ * uninitialized source of the plain gather
+ */
+static inline __m256d GatherRadii(const double *species_radii,
+                                  __m128i species) {
+  return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), species_radii,
+                                  species, _mm256_castsi256_pd(
+                                      _mm256_set1_epi64x(-1)), 8);
+}
+
+#elif defined(IDEAL_GAS_SSE2)
+
+/**
+ * Finds the lanes where position <= bound + radius
+ */
+static inline __m128 AtOrBelow(__m128 position, __m128d low_radii,
+                               __m128d high_radii, __m128d bound) {
+  __m128d low = _mm_cmple_pd(_mm_cvtps_pd(position),
+                             _mm_add_pd(bound, low_radii));
+  __m128d high = _mm_cmple_pd(_mm_cvtps_pd(_mm_movehl_ps(position, position)),
+                              _mm_add_pd(bound, high_radii));
+  return _mm_shuffle_ps(_mm_castpd_ps(low), _mm_castpd_ps(high),
+                        _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+/**
+ * Finds the lanes where position >= bound - radius
+ */
+static inline __m128 AtOrAbove(__m128 position, __m128d low_radii,
+                               __m128d high_radii, __m128d bound) {
+  __m128d low = _mm_cmpge_pd(_mm_cvtps_pd(position),
+                             _mm_sub_pd(bound, low_radii));
+  __m128d high = _mm_cmpge_pd(_mm_cvtps_pd(_mm_movehl_ps(position, position)),
+                              _mm_sub_pd(bound, high_radii));
+  return _mm_shuffle_ps(_mm_castpd_ps(low), _mm_castpd_ps(high),
+                        _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+#endif
+
+/**
+ * Counts the lanes that are set in a movemask
+ */
+static inline size_t CountLanes(int mask) {
+  size_t lanes = 0;
+  for (; mask != 0; mask &= mask - 1) {
+    lanes++;
+  }
+  return lanes;
+}
+
+/**
+ * The scalar loop behind MoveParticlesScalar. The wall bounces are only 
+ * counted when kCountWallBounces is set, so the plain version compiles to 
+ * the same code as before
+ */
+template <bool kCountWallBounces>
+static size_t MoveScalar(float *x, float *y, float *x_velocity,
+                         float *y_velocity, const uint32_t *species,
+                         const double *species_radii, size_t count,
+                         float time_step, double x_lower_bound,
+                         double y_lower_bound, double x_upper_bound,
+                         double y_upper_bound) {
+  size_t bounces = 0;
+  for (size_t i = 0; i < count; i++) {
+    x[i] += x_velocity[i] * time_step;
+    y[i] += y_velocity[i] * time_step;
+
+    // The same checks as Particle::Update, see there for why the velocity
+    // is checked before the position
+    if (x_velocity[i] < 0 &&
+        x[i] <= x_lower_bound + species_radii[species[i]]) {
+      x_velocity[i] = -x_velocity[i];
+      bounces += kCountWallBounces;
+    }
+
+    if (y_velocity[i] < 0 &&
+        y[i] <= y_lower_bound + species_radii[species[i]]) {
+      y_velocity[i] = -y_velocity[i];
+      bounces += kCountWallBounces;
+    }
+
+    if (x_velocity[i] > 0 &&
+        x[i] >= x_upper_bound - species_radii[species[i]]) {
+      x_velocity[i] = -x_velocity[i];
+      bounces += kCountWallBounces;
+    }
+
+    if (y_velocity[i] > 0 &&
+        y[i] >= y_upper_bound - species_radii[species[i]]) {
+      y_velocity[i] = -y_velocity[i];
+      bounces += kCountWallBounces;
+    }
+  }
+  return bounces;
+}
+
+/**
+ * The SIMD loop behind MoveParticles, counting the wall bounces only when
+ * kCountWallBounces is set
+ */
+template <bool kCountWallBounces>
+static size_t Move(float *x, float *y, float *x_velocity, float *y_velocity,
+                   const uint32_t *species, const double *species_radii,
+                   size_t count, float time_step,
+                   double x_lower_bound, double y_lower_bound,
+                   double x_upper_bound, double y_upper_bound) {
+  size_t i = 0;
+  size_t bounces = 0;
+
+#if defined(__AVX2__)
+  const __m256 kZero = _mm256_setzero_ps();
+  const __m256 kSignBit = _mm256_set1_ps(-0.0f);
+  const __m256 kTimeStep = _mm256_set1_ps(time_step);
+  const __m256d kXLower = _mm256_set1_pd(x_lower_bound);
+  const __m256d kYLower = _mm256_set1_pd(y_lower_bound);
+  const __m256d kXUpper = _mm256_set1_pd(x_upper_bound);
+  const __m256d kYUpper = _mm256_set1_pd(y_upper_bound);
+
+  for (; i + 8 <= count; i += 8) {
+    __m256 x_vel = _mm256_loadu_ps(x_velocity + i);
+    __m256 y_vel = _mm256_loadu_ps(y_velocity + i);
+    __m256 x_pos = _mm256_add_ps(_mm256_loadu_ps(x + i),
+                                 _mm256_mul_ps(x_vel, kTimeStep));
+    __m256 y_pos = _mm256_add_ps(_mm256_loadu_ps(y + i),
+                                 _mm256_mul_ps(y_vel, kTimeStep));
+    __m256i lane_species = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(species + i));
+    __m256d low_radii = GatherRadii(species_radii, _mm256_castsi256_si128(
+        lane_species));
+    __m256d high_radii = GatherRadii(species_radii, _mm256_extracti128_si256(
+        lane_species, 1));
+
+    // Negating a float only flips its sign bit, so xor-ing the sign bit into
+    // the lanes that hit a wall is the same as the branches in Update(). The
+    // checks run in the same order since the later ones read the velocity
+    // the earlier ones may have flipped
+    __m256 hit = _mm256_and_ps(_mm256_cmp_ps(x_vel, kZero, _CMP_LT_OQ),
+                               AtOrBelow(x_pos, low_radii, high_radii,
+                                  kXLower));
+    x_vel = _mm256_xor_ps(x_vel, _mm256_and_ps(hit, kSignBit));
+    if (kCountWallBounces) {
+      bounces += CountLanes(_mm256_movemask_ps(hit));
+    }
+
+    hit = _mm256_and_ps(_mm256_cmp_ps(y_vel, kZero, _CMP_LT_OQ),
+                        AtOrBelow(y_pos, low_radii, high_radii,
+                                  kYLower));
+    y_vel = _mm256_xor_ps(y_vel, _mm256_and_ps(hit, kSignBit));
+    if (kCountWallBounces) {
+      bounces += CountLanes(_mm256_movemask_ps(hit));
+    }
+
+    hit = _mm256_and_ps(_mm256_cmp_ps(x_vel, kZero, _CMP_GT_OQ),
+                        AtOrAbove(x_pos, low_radii, high_radii,
+                                  kXUpper));
+    x_vel = _mm256_xor_ps(x_vel, _mm256_and_ps(hit, kSignBit));
+    if (kCountWallBounces) {
+      bounces += CountLanes(_mm256_movemask_ps(hit));
+    }
+
+    hit = _mm256_and_ps(_mm256_cmp_ps(y_vel, kZero, _CMP_GT_OQ),
+                        AtOrAbove(y_pos, low_radii, high_radii,
+                                  kYUpper));
+    y_vel = _mm256_xor_ps(y_vel, _mm256_and_ps(hit, kSignBit));
+    if (kCountWallBounces) {
+      bounces += CountLanes(_mm256_movemask_ps(hit));
+    }
+
+    _mm256_storeu_ps(x + i, x_pos);
+    _mm256_storeu_ps(y + i, y_pos);
+    _mm256_storeu_ps(x_velocity + i, x_vel);
+    _mm256_storeu_ps(y_velocity + i, y_vel);
+  }
+
+#elif defined(IDEAL_GAS_SSE2)
+  const __m128 kZero = _mm_setzero_ps();
+  const __m128 kSignBit = _mm_set1_ps(-0.0f);
+  const __m128 kTimeStep = _mm_set1_ps(time_step);
+  const __m128d kXLower = _mm_set1_pd(x_lower_bound);
+  const __m128d kYLower = _mm_set1_pd(y_lower_bound);
+  const __m128d kXUpper = _mm_set1_pd(x_upper_bound);
+  const __m128d kYUpper = _mm_set1_pd(y_upper_bound);
+
+  for (; i + 4 <= count; i += 4) {
+    __m128 x_vel = _mm_loadu_ps(x_velocity + i);
+    __m128 y_vel = _mm_loadu_ps(y_velocity + i);
+    __m128 x_pos = _mm_add_ps(_mm_loadu_ps(x + i),
+                              _mm_mul_ps(x_vel, kTimeStep));
+    __m128 y_pos = _mm_add_ps(_mm_loadu_ps(y + i),
+                              _mm_mul_ps(y_vel, kTimeStep));
+
+    // SSE2 has no gather, so the radii are looked up one at a time
+    __m128d low_radii = _mm_set_pd(species_radii[species[i + 1]],
+                                   species_radii[species[i]]);
+    __m128d high_radii = _mm_set_pd(species_radii[species[i + 3]],
+                                    species_radii[species[i + 2]]);
+
+    // Same as the AVX2 version above with half as many lanes
+    __m128 hit = _mm_and_ps(_mm_cmplt_ps(x_vel, kZero),
+                            AtOrBelow(x_pos, low_radii, high_radii,
+                                  kXLower));
+    x_vel = _mm_xor_ps(x_vel, _mm_and_ps(hit, kSignBit));
+    if (kCountWallBounces) {
+      bounces += CountLanes(_mm_movemask_ps(hit));
+    }
+
+    hit = _mm_and_ps(_mm_cmplt_ps(y_vel, kZero),
+                     AtOrBelow(y_pos, low_radii, high_radii,
+                                  kYLower));
+    y_vel = _mm_xor_ps(y_vel, _mm_and_ps(hit, kSignBit));
+    if (kCountWallBounces) {
+      bounces += CountLanes(_mm_movemask_ps(hit));
+    }
+
+    hit = _mm_and_ps(_mm_cmpgt_ps(x_vel, kZero),
+                     AtOrAbove(x_pos, low_radii, high_radii,
+                                  kXUpper));
+    x_vel = _mm_xor_ps(x_vel, _mm_and_ps(hit, kSignBit));
+    if (kCountWallBounces) {
+      bounces += CountLanes(_mm_movemask_ps(hit));
+    }
+
+    hit = _mm_and_ps(_mm_cmpgt_ps(y_vel, kZero),
+                     AtOrAbove(y_pos, low_radii, high_radii,
+                                  kYUpper));
+    y_vel = _mm_xor_ps(y_vel, _mm_and_ps(hit, kSignBit));
+    if (kCountWallBounces) {
+      bounces += CountLanes(_mm_movemask_ps(hit));
+    }
+
+    _mm_storeu_ps(x + i, x_pos);
+    _mm_storeu_ps(y + i, y_pos);
+    _mm_storeu_ps(x_velocity + i, x_vel);
+    _mm_storeu_ps(y_velocity + i, y_vel);
+  }
+#endif
+
+  return bounces + MoveScalar<kCountWallBounces>(
+      x + i, y + i, x_velocity + i, y_velocity + i, species + i, species_radii,
+      count - i, time_step, x_lower_bound, y_lower_bound, x_upper_bound,
+      y_upper_bound);
+}
+
+void MoveParticles(float *x, float *y, float *x_velocity, float *y_velocity,
+                   const uint32_t *species, const double *species_radii,
+                   size_t count, float time_step,
+                   double x_lower_bound, double y_lower_bound,
+                   double x_upper_bound, double y_upper_bound) {
+  Move<false>(x, y, x_velocity, y_velocity, species, species_radii, count,
+              time_step, x_lower_bound, y_lower_bound, x_upper_bound,
+              y_upper_bound);
+}
+
+size_t MoveParticlesCountingWallBounces(float *x, float *y, float *x_velocity,
+                                        float *y_velocity,
+                                        const uint32_t *species,
+                                        const double *species_radii,
+                                        size_t count,
+                                        float time_step, double x_lower_bound,
+                                        double y_lower_bound,
+                                        double x_upper_bound,
+                                        double y_upper_bound) {
+  return Move<true>(x, y, x_velocity, y_velocity, species, species_radii,
+                    count, time_step, x_lower_bound, y_lower_bound,
+                    x_upper_bound, y_upper_bound);
+}
+
+void MoveParticlesScalar(float *x, float *y, float *x_velocity,
+                         float *y_velocity, const uint32_t *species,
+                         const double *species_radii, size_t count,
+                         float time_step, double x_lower_bound,
+                         double y_lower_bound, double x_upper_bound,
+                         double y_upper_bound) {
+  MoveScalar<false>(x, y, x_velocity, y_velocity, species, species_radii,
+                    count, time_step, x_lower_bound, y_lower_bound,
+                    x_upper_bound, y_upper_bound);
+}
+
+std::string GetSimdInstructionSet() {
+#if defined(__AVX2__)
+  return "avx2";
+#elif defined(IDEAL_GAS_SSE2)
+  return "sse2";
+#else
+  return "scalar";
+#endif
+}
+
+} // namespace idealgas
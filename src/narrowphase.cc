@@ -0,0 +1,188 @@
+#include <narrowphase.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace idealgas {
+
+#if defined(__AVX2__)
+
+/**
+ * Loads four radii. The masked gather with a zeroed source is used because
+ * GCC warns about the uninitialized source of the plain gather
+ */
+static inline __m256d GatherRadii(const double *radii, __m128i indices) {
+  return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), radii, indices,
+                                  _mm256_castsi256_pd(_mm256_set1_epi64x(-1)),
+                                  8);
+}
+
+#endif
+
+size_t FindCollidingPairs(const ParticlePair *pairs, size_t count,
+                          const ParticleStore &particles,
+                          ParticlePair *colliding) {
+  size_t i = 0;
+  size_t found = 0;
+
+#if defined(__AVX2__)
+  const float *x = particles.GetX();
+  const float *y = particles.GetY();
+  const uint32_t *species = particles.GetSpeciesIndices();
+  const double *radii = particles.GetSpeciesRadii();
+  const __m256i kSplitPairs = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+  for (; i + 8 <= count; i += 8) {
+
+    // The pairs are stored first, second, first, second... so the indices
+    // are shuffled into one register of first indices and one of second
+    __m256i low = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(pairs + i)), kSplitPairs);
+    __m256i high = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(pairs + i + 4)), kSplitPairs);
+    __m256i first = _mm256_permute2x128_si256(low, high, 0x20);
+    __m256i second = _mm256_permute2x128_si256(low, high, 0x31);
+
+    __m256 x_difference = _mm256_sub_ps(_mm256_i32gather_ps(x, first, 4),
+                                        _mm256_i32gather_ps(x, second, 4));
+    __m256 y_difference = _mm256_sub_ps(_mm256_i32gather_ps(y, first, 4),
+                                        _mm256_i32gather_ps(y, second, 4));
+
+    // The radii are looked up through the species of each particle. They
+    // are doubles so they are added four lanes at a time before being
+    // narrowed to floats like in the scalar version
+    __m256i first_species = _mm256_i32gather_epi32(
+        reinterpret_cast<const int *>(species), first, 4);
+    __m256i second_species = _mm256_i32gather_epi32(
+        reinterpret_cast<const int *>(species), second, 4);
+    __m128 low_radii = _mm256_cvtpd_ps(_mm256_add_pd(
+        GatherRadii(radii, _mm256_castsi256_si128(first_species)),
+        GatherRadii(radii, _mm256_castsi256_si128(second_species))));
+    __m128 high_radii = _mm256_cvtpd_ps(_mm256_add_pd(
+        GatherRadii(radii, _mm256_extracti128_si256(first_species, 1)),
+        GatherRadii(radii, _mm256_extracti128_si256(second_species, 1))));
+    __m256 radii_sum = _mm256_insertf128_ps(_mm256_castps128_ps256(
+        low_radii), high_radii, 1);
+
+    __m256 distance_squared = _mm256_add_ps(
+        _mm256_mul_ps(x_difference, x_difference),
+        _mm256_mul_ps(y_difference, y_difference));
+    __m256 hit = _mm256_cmp_ps(distance_squared, 
+                               _mm256_mul_ps(radii_sum, radii_sum),
+                               _CMP_LT_OQ);
+    int mask = _mm256_movemask_ps(hit);
+
+    // Every pair is written but the output only moves forward past the ones
+    // that hit, which packs the colliding pairs together without branching
+    for (size_t lane = 0; lane < 8; lane++) {
+      colliding[found] = pairs[i + lane];
+      found += (mask >> lane) & 1;
+    }
+  }
+#endif
+
+  return found + FindCollidingPairsScalar(pairs + i, count - i, particles,
+                                          colliding + found);
+}
+
+size_t FindCollidingPairsScalar(const ParticlePair *pairs, size_t count,
+                                const ParticleStore &particles,
+                                ParticlePair *colliding) {
+  const float *x = particles.GetX();
+  const float *y = particles.GetY();
+  const uint32_t *species = particles.GetSpeciesIndices();
+  const double *radii = particles.GetSpeciesRadii();
+
+  size_t found = 0;
+  for (size_t i = 0; i < count; i++) {
+    uint32_t first = pairs[i].first;
+    uint32_t second = pairs[i].second;
+
+    float x_difference = x[first] - x[second];
+    float y_difference = y[first] - y[second];
+    float radii_sum = (float) (radii[species[first]] +
+        radii[species[second]]);
+    float distance_squared = x_difference * x_difference +
+        y_difference * y_difference;
+
+    colliding[found] = pairs[i];
+    found += distance_squared < radii_sum * radii_sum;
+  }
+  return found;
+}
+
+bool ResolveCollision(uint32_t first, uint32_t second, 
+                      ParticleStore &particles,
+                      std::vector<SpeedChange> *speed_changes) {
+  float *x = particles.GetX();
+  float *y = particles.GetY();
+  float *x_velocity = particles.GetXVelocity();
+  float *y_velocity = particles.GetYVelocity();
+  const uint32_t *species = particles.GetSpeciesIndices();
+  const double *radii = particles.GetSpeciesRadii();
+  const double *species_inverse_masses = particles.GetSpeciesInverseMasses();
+
+  // The same overlap test as FindCollidingPairsScalar, so a pair it found
+  // is never turned away here
+  float x_difference = x[first] - x[second];
+  float y_difference = y[first] - y[second];
+  float radii_sum = (float) (radii[species[first]] + radii[species[second]]);
+  float distance_squared = x_difference * x_difference +
+      y_difference * y_difference;
+  if (!(distance_squared < radii_sum * radii_sum)) {
+    return false;
+  }
+
+  // Uses the velocities as they are now, since an earlier collision in this
+  // step may have turned the pair toward or away from each other
+  float approach = (x_velocity[first] - x_velocity[second]) * x_difference +
+      (y_velocity[first] - y_velocity[second]) * y_difference;
+  if (!(approach < 0)) {
+    return false;
+  }
+
+  // With the reduced mass m1 * m2 / (m1 + m2), the mass ratio
+  // 2 * m2 / (m1 + m2) of the first particle becomes 2 * reduced mass / m1
+  // and the one of the second particle 2 * reduced mass / m2
+  double first_inverse_mass = species_inverse_masses[species[first]];
+  double second_inverse_mass = species_inverse_masses[species[second]];
+  double reduced_mass = 1 / (first_inverse_mass + second_inverse_mass);
+  float impulse = approach / distance_squared;
+  float p1_mass_ratio = (float) (2 * reduced_mass * first_inverse_mass);
+  float p2_mass_ratio = (float) (2 * reduced_mass * second_inverse_mass);
+  
+  // The old speeds are only worked out when they are reported, so the 
+  // square roots are skipped otherwise
+  float p1_old_speed = 0;
+  float p2_old_speed = 0;
+  if (speed_changes != nullptr) {
+    p1_old_speed = GetSpeed(x_velocity[first], y_velocity[first]);
+    p2_old_speed = GetSpeed(x_velocity[second], y_velocity[second]);
+  }
+  x_velocity[first] -= p1_mass_ratio * (impulse * x_difference);
+  y_velocity[first] -= p1_mass_ratio * (impulse * y_difference);
+  x_velocity[second] += p2_mass_ratio * (impulse * x_difference);
+  y_velocity[second] += p2_mass_ratio * (impulse * y_difference);
+  
+  if (speed_changes != nullptr) {
+    RecordSpeedChange(speed_changes, first, p1_old_speed, 
+                      GetSpeed(x_velocity[first], y_velocity[first]));
+    RecordSpeedChange(speed_changes, second, p2_old_speed,
+                      GetSpeed(x_velocity[second], y_velocity[second]));
+  }
+  return true;
+}
+
+size_t ResolveCollisions(const ParticlePair *pairs, size_t count,
+                         ParticleStore &particles,
+                         std::vector<SpeedChange> *speed_changes) {
+  size_t collisions = 0;
+  for (size_t i = 0; i < count; i++) {
+    collisions += ResolveCollision(pairs[i].first, pairs[i].second, 
+                                   particles, speed_changes);
+  }
+  return collisions;
+}
+
+} // namespace idealgas
@@ -12,38 +12,53 @@ Particle::Particle(const glm::vec2& location, const glm::vec2& velocity,
   color_ = color;
 }
 
-void Particle::DrawParticle() {
-  ci::gl::color(ci::Color(color_.c_str()));
-  ci::gl::drawSolidCircle(position_, radius_);
+void Particle::Update(float time_step) {
+  Move(position_.x, position_.y, velocity_.x, velocity_.y, radius_, 
+       time_step);
 }
-void Particle::Update() {
-  position_ += velocity_;
+
+void Particle::Move(float &x, float &y, float &x_velocity, float &y_velocity,
+                    double radius, float time_step) {
+  Move(x, y, x_velocity, y_velocity, radius, time_step,
+       ParticleSimulator::kXLowerBound, ParticleSimulator::kYLowerBound,
+       ParticleSimulator::kXUpperBound, ParticleSimulator::kYUpperBound);
+}
+
+void Particle::Move(float &x, float &y, float &x_velocity, float &y_velocity,
+                    double radius, float time_step, double x_lower_bound,
+                    double y_lower_bound, double x_upper_bound,
+                    double y_upper_bound) {
+  
+  // Multiplying by a time step of 1 is exact, so the default step moves 
+  // the particle exactly like adding the velocity does
+  x += x_velocity * time_step;
+  y += y_velocity * time_step;
 
   // These checks prevent the particle from getting stuck on the wall. Ex if 
   // the horizontal velocity of the particle is negative (moving to the left)
   // and it is on the right side of the left vertical wall, then we know it's
   // moving toward it
-  if (velocity_.x < 0) {
-    if (position_.x <= ParticleSimulator::kXLowerBound + radius_) {
-      velocity_.x = -velocity_.x;
+  if (x_velocity < 0) {
+    if (x <= x_lower_bound + radius) {
+      x_velocity = -x_velocity;
     }
   }
 
-  if (velocity_.y < 0) {
-    if (position_.y <= ParticleSimulator::kYLowerBound + radius_) {
-      velocity_.y = -velocity_.y;
+  if (y_velocity < 0) {
+    if (y <= y_lower_bound + radius) {
+      y_velocity = -y_velocity;
     }
   }
   
-  if (velocity_.x > 0) {
-    if (position_.x >= ParticleSimulator::kXUpperBound - radius_) {
-      velocity_.x = -velocity_.x;
+  if (x_velocity > 0) {
+    if (x >= x_upper_bound - radius) {
+      x_velocity = -x_velocity;
     }
   }
 
-  if (velocity_.y > 0) {
-    if (position_.y >= ParticleSimulator::kYUpperBound - radius_) {
-      velocity_.y = -velocity_.y;
+  if (y_velocity > 0) {
+    if (y >= y_upper_bound - radius) {
+      y_velocity = -y_velocity;
     }
   }
 }
@@ -0,0 +1,115 @@
+#include <particle_renderer.h>
+#include "cinder/GeomIo.h"
+
+namespace idealgas {
+
+namespace {
+
+// Moves the unit circle to each particle's position and scales it by the
+// radius of the species
+const char *kVertexShader = R"(
+#version 150
+uniform mat4 ciModelViewProjection;
+uniform float uRadius;
+in vec4 ciPosition;
+in vec2 aInstancePosition;
+
+void main() {
+  gl_Position = ciModelViewProjection *
+      vec4(ciPosition.xy * uRadius + aInstancePosition, 0.0, 1.0);
+}
+)";
+
+const char *kFragmentShader = R"(
+#version 150
+uniform vec4 uColor;
+out vec4 oColor;
+
+void main() {
+  oColor = uColor;
+}
+)";
+
+} // namespace
+
+void ParticleRenderer::Draw(const ParticleStore &particles,
+                            const Container &container) {
+
+  // Draws the inner container for the pixels
+  glm::vec2 top_left = glm::vec2(container.x_lower_bound,
+                                 container.y_lower_bound);
+  glm::vec2 bottom_right = glm::vec2(container.x_upper_bound,
+                                     container.y_upper_bound);
+  ci::Rectf walls(top_left, bottom_right);
+
+  ci::gl::color(ci::Color("white"));
+  ci::gl::drawStrokedRect(walls);
+
+  AddSpeciesBatches(particles);
+
+  // Sorts the positions by species in one pass. The lists keep their
+  // memory between frames, so this doesn't allocate once they are big
+  // enough
+  for (SpeciesBatch &batch : batches_) {
+    batch.positions.clear();
+  }
+  const float *x = particles.GetX();
+  const float *y = particles.GetY();
+  const uint32_t *species = particles.GetSpeciesIndices();
+  for (size_t i = 0; i < particles.size(); i++) {
+    batches_[species[i]].positions.emplace_back(x[i], y[i]);
+  }
+
+  for (SpeciesBatch &batch : batches_) {
+    if (batch.positions.empty()) {
+      continue;
+    }
+
+    // The buffer only grows, so most frames just overwrite its start
+    size_t bytes = batch.positions.size() * sizeof(glm::vec2);
+    if (batch.positions.size() > batch.capacity) {
+      batch.instances->bufferData(bytes, batch.positions.data(),
+                                  GL_DYNAMIC_DRAW);
+      batch.capacity = batch.positions.size();
+    } else {
+      batch.instances->bufferSubData(0, bytes, batch.positions.data());
+    }
+
+    shader_->uniform("uRadius", batch.radius);
+    shader_->uniform("uColor", batch.color);
+    batch.batch->drawInstanced((GLsizei) batch.positions.size());
+  }
+}
+
+void ParticleRenderer::AddSpeciesBatches(const ParticleStore &particles) {
+  const std::vector<Species> &species = particles.GetSpecies();
+  if (batches_.size() == species.size()) {
+    return;
+  }
+
+  if (!shader_) {
+    shader_ = ci::gl::GlslProg::create(kVertexShader, kFragmentShader);
+  }
+
+  // The species table only grows, so only the new species need a batch
+  for (size_t s = batches_.size(); s < species.size(); s++) {
+    SpeciesBatch batch;
+    batch.color = ci::Color(species[s].color.c_str());
+    batch.radius = (float) species[s].radius;
+    batch.instances = ci::gl::Vbo::create(GL_ARRAY_BUFFER, 0, nullptr,
+                                          GL_DYNAMIC_DRAW);
+
+    // Every particle is one instance, so the position attribute steps once
+    // per instance instead of once per vertex
+    ci::geom::BufferLayout layout;
+    layout.append(ci::geom::Attrib::CUSTOM_0, 2, 0, 0, 1);
+    ci::gl::VboMeshRef mesh = ci::gl::VboMesh::create(
+        ci::geom::Circle().radius(1).subdivisions(kCircleSegments));
+    mesh->appendVbo(layout, batch.instances);
+    batch.batch = ci::gl::Batch::create(
+        mesh, shader_, {{ci::geom::Attrib::CUSTOM_0, "aInstancePosition"}});
+    batches_.push_back(batch);
+  }
+}
+
+} // namespace idealgas
@@ -1,117 +1,415 @@
 #include <particle_simulator.h>
+#include <checkpoint.h>
+#include <integrator.h>
+#include <narrowphase.h>
+#include <placement.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <random>
 
 namespace idealgas {
 
+// These are passed to std::min by reference, so they need a definition
+const size_t ParticleSimulator::kMaxStrips;
+const size_t ParticleSimulator::kMoveChunkSize;
+
 void ParticleSimulator::Update() {
-  for (size_t i = 0; i < particles_.size(); i++) {
-    for (size_t j = i + 1; j < particles_.size(); j++) {
-      if (CanCollide(particles_[i], particles_[j])) {
-        Collide(particles_[i], particles_[j]);
-      }
-    }
-    particles_[i].Update();
+  if (engine_ == Engine::kEventDriven) {
+    UpdateEventDriven();
+  } else if (collision_detection_ == CollisionDetection::kContinuous) {
+    UpdateContinuous();
+  } else if (broadphase_ == Broadphase::kBruteForce) {
+    UpdateBruteForce();
+  } else if (broadphase_ == Broadphase::kUniformGrid && thread_pool_) {
+    UpdateParallel();
+  } else {
+    UpdateCandidatePairs();
+  }
+  
+  steps_++;
+  instrumentation_.AddCount(Counter::kUpdates, 1);
+  instrumentation_.AddCount(Counter::kCandidatePairs, candidate_pair_count_);
+}
+
+size_t ParticleSimulator::Advance(double elapsed_time) {
+  accumulated_time_ += elapsed_time;
+  
+  size_t steps = 0;
+  while (accumulated_time_ >= time_step_ && steps < max_substeps_) {
+    Update();
+    accumulated_time_ -= time_step_;
+    steps++;
   }
+  
+  // Drops the whole steps there wasn't room for, but keeps the part of a 
+  // step that is left over
+  if (accumulated_time_ >= time_step_) {
+    accumulated_time_ = std::fmod(accumulated_time_, time_step_);
+  }
+  return steps;
 }
 
-bool ParticleSimulator::CanCollide(const Particle& particle1, const Particle&
-particle2) const {
+void ParticleSimulator::UpdateBruteForce() {
+  float *x = particles_.GetX();
+  float *y = particles_.GetY();
+  float *x_velocity = particles_.GetXVelocity();
+  float *y_velocity = particles_.GetYVelocity();
+  const uint32_t *species = particles_.GetSpeciesIndices();
+  const double *radii = particles_.GetSpeciesRadii();
+  std::vector<SpeedChange> *speed_changes = GetSpeedChangeLog();
   
-  // Checks if the distance between the particles is less than the sum of 
-  // their radii
-  if (glm::distance(particle1.GetPosition(), particle2.GetPosition()) < 
-  particle1.GetRadius() + particle2.GetRadius()) {
+  candidate_pair_count_ = particles_.size() * (particles_.size() - 1) / 2;
+  size_t collisions = 0;
+  size_t wall_bounces = 0;
+  for (size_t i = 0; i < particles_.size(); i++) {
+    for (size_t j = i + 1; j < particles_.size(); j++) {
+      collisions += ResolveCollision((uint32_t) i, (uint32_t) j, particles_,
+                                     speed_changes);
+    }
     
-    glm::vec2 v1_difference = particle1.GetVelocity() - particle2.GetVelocity();
-    glm::vec2 x1_difference = particle1.GetPosition() - particle2.GetPosition();
+    float old_x_velocity = x_velocity[i];
+    float old_y_velocity = y_velocity[i];
+    Particle::Move(x[i], y[i], x_velocity[i], y_velocity[i],
+                   radii[species[i]], (float) time_step_, 
+                   container_.x_lower_bound, container_.y_lower_bound,
+                   container_.x_upper_bound, container_.y_upper_bound);
+    if (Instrumentation::kEnabled) {
+      wall_bounces += (old_x_velocity != x_velocity[i]) + 
+          (old_y_velocity != y_velocity[i]);
+    }
+  }
+  
+  // The loop mixes every phase, so only the counters are recorded
+  instrumentation_.AddCount(Counter::kCollisions, collisions);
+  instrumentation_.AddCount(Counter::kWallBounces, wall_bounces);
+}
 
-    // Check if they are moving toward each other. If not, then we return 
-    // and not collide
-    if (dot(v1_difference, x1_difference) < 0) {
-      return true;
+void ParticleSimulator::UpdateCandidatePairs() {
+  {
+    PhaseTimer timer(instrumentation_, Phase::kBroadphase);
+    if (broadphase_ == Broadphase::kUniformGrid) {
+      grid_.Build(particles_, container_.x_lower_bound, 
+                  container_.y_lower_bound, container_.x_upper_bound,
+                  container_.y_upper_bound);
+      grid_.FindCandidatePairs(candidate_pairs_);
+    } else {
+      sort_and_sweep_.FindCandidatePairs(particles_, candidate_pairs_);
     }
+    
+    // The brute force loop checks the pairs in order of the first index 
+    // and then the second, and only moves a particle once all of its pairs 
+    // have been checked, so no pair it checks has a particle that already
+    // moved. Sorting the pairs, keeping every overlapping one for 
+    // ResolveCollisions to check with the velocities at that point, and 
+    // moving the particles afterwards collides the same pairs in the same
+    // order with the same arithmetic. The broadphases only differ from 
+    // brute force where the AVX2 overlap test rounds differently from the
+    // scalar one
+    std::sort(candidate_pairs_.begin(), candidate_pairs_.end());
+    candidate_pair_count_ = candidate_pairs_.size();
   }
-  return false;
+  
+  size_t colliding;
+  {
+    PhaseTimer timer(instrumentation_, Phase::kNarrowphase);
+    colliding_pairs_.resize(candidate_pairs_.size());
+    colliding = FindCollidingPairs(candidate_pairs_.data(), 
+                                   candidate_pairs_.size(), particles_,
+                                   colliding_pairs_.data());
+  }
+  
+  {
+    PhaseTimer timer(instrumentation_, Phase::kCollisionResponse);
+    instrumentation_.AddCount(Counter::kCollisions, ResolveCollisions(
+        colliding_pairs_.data(), colliding, particles_, 
+        GetSpeedChangeLog()));
+  }
+  
+  MoveParticles();
 }
 
-void ParticleSimulator::Collide(Particle &particle1, Particle &particle2) {
+void ParticleSimulator::UpdateContinuous() {
+  PhaseTimer timer(instrumentation_, Phase::kContinuousCollisions);
+  size_t collisions = continuous_collisions_.Step(
+      particles_, time_step_, container_.x_lower_bound, 
+      container_.y_lower_bound, container_.x_upper_bound, 
+      container_.y_upper_bound, GetSpeedChangeLog());
+  candidate_pair_count_ = continuous_collisions_.GetCandidatePairCount();
+  instrumentation_.AddCount(Counter::kCollisions, collisions);
+  instrumentation_.AddCount(Counter::kWallBounces, 
+                            continuous_collisions_.GetWallCollisionCount());
+}
+
+void ParticleSimulator::UpdateEventDriven() {
+  PhaseTimer timer(instrumentation_, Phase::kEventProcessing);
+  if (event_engine_outdated_) {
+    event_engine_.Reset(particles_, container_.x_lower_bound, 
+                        container_.y_lower_bound, container_.x_upper_bound,
+                        container_.y_upper_bound);
+    event_engine_outdated_ = false;
+  }
   
-  float p1_mass = particle1.GetMass();
-  float p2_mass = particle2.GetMass();
+  // The engine counts its collisions since the last reset, so only the new
+  // ones are added
+  size_t collisions = event_engine_.GetParticleCollisionCount();
+  size_t wall_bounces = event_engine_.GetWallCollisionCount();
+  event_engine_.Advance(time_step_, particles_, GetSpeedChangeLog());
+  instrumentation_.AddCount(Counter::kCollisions, 
+                            event_engine_.GetParticleCollisionCount() - 
+                            collisions);
+  instrumentation_.AddCount(Counter::kWallBounces, 
+                            event_engine_.GetWallCollisionCount() - 
+                            wall_bounces);
+  candidate_pair_count_ = 0;
+}
+
+bool ParticleSimulator::AllowsAnyVelocity() const {
+  return engine_ == Engine::kEventDriven || 
+      collision_detection_ == CollisionDetection::kContinuous;
+}
 
-  // Calculates v1 - v2
-  glm::vec2 v1_difference = particle1.GetVelocity() - particle2.GetVelocity();
+void ParticleSimulator::UpdateParallel() {
+  {
+    PhaseTimer timer(instrumentation_, Phase::kBroadphase);
+    grid_.Build(particles_, container_.x_lower_bound, 
+                container_.y_lower_bound, container_.x_upper_bound,
+                container_.y_upper_bound);
+  }
   
-  // Calculates x1 - x2
-  glm::vec2 x1_difference = particle1.GetPosition() - particle2.GetPosition();
+  size_t columns = grid_.GetColumns();
+  strips_.resize(std::min(columns, kMaxStrips));
+  for (size_t s = 0; s < strips_.size(); s++) {
+    strips_[s].first_column = s * columns / strips_.size();
+    strips_[s].end_column = (s + 1) * columns / strips_.size();
+  }
   
-  // Finds the magnitude 
-  float magnitude1 = glm::length(x1_difference);
+  // Finding the colliding pairs only reads the particles, so every strip can
+  // do it at the same time. Each strip finds its candidates and tests them 
+  // in one go, so the whole pass is timed as the narrowphase
+  {
+    PhaseTimer timer(instrumentation_, Phase::kNarrowphase);
+    thread_pool_->ParallelFor(strips_.size(), [this](size_t s) {
+      Strip &strip = strips_[s];
+      grid_.FindCandidatePairs(strip.first_column, strip.end_column,
+                               strip.candidate_pairs);
+      std::sort(strip.candidate_pairs.begin(), strip.candidate_pairs.end());
+      strip.colliding_pairs.resize(strip.candidate_pairs.size());
+      strip.colliding_count = FindCollidingPairs(
+          strip.candidate_pairs.data(), strip.candidate_pairs.size(),
+          particles_, strip.colliding_pairs.data());
+    });
+  }
   
-  // Same thing for particle 2
-  glm::vec2 v2_difference = particle2.GetVelocity() - particle1.GetVelocity();
-  glm::vec2 x2_difference = particle2.GetPosition() - particle1.GetPosition();
-  float magnitude2 = glm::length(x2_difference);
+  candidate_pair_count_ = 0;
+  for (const Strip &strip : strips_) {
+    candidate_pair_count_ += strip.candidate_pairs.size();
+  }
   
-  // Calculate the mass ratios between the particles 
-  float p1_mass_ratio = ((2 * p2_mass) / (p1_mass + p2_mass));
-  float p2_mass_ratio = ((2 * p1_mass) / (p1_mass + p2_mass));
+  // A strip's pairs only have particles in that strip and the next one, so 
+  // the even strips never share a particle with each other and neither do 
+  // the odd strips. Resolving the even strips and then the odd strips lets 
+  // each half run in parallel without two threads changing one particle
+  {
+    PhaseTimer timer(instrumentation_, Phase::kCollisionResponse);
+    for (size_t parity = 0; parity < 2; parity++) {
+      size_t strip_count = (strips_.size() + 1 - parity) / 2;
+      thread_pool_->ParallelFor(strip_count, [this, parity](size_t index) {
+        Strip &strip = strips_[2 * index + parity];
+        strip.speed_changes.clear();
+        strip.resolved_count = ResolveCollisions(
+            strip.colliding_pairs.data(), strip.colliding_count, particles_,
+            speed_change_tracking_ ? &strip.speed_changes : nullptr);
+      });
+    }
+  }
   
-  // Equations from the assignment specs
-  glm::vec2 p1_new_vel = particle1.GetVelocity() -  p1_mass_ratio * ((float) 
-      (dot(v1_difference, x1_difference) / pow(magnitude1, 2)) * x1_difference);
+  // Each strip recorded its own changes so the threads don't share a list
+  if (speed_change_tracking_) {
+    for (const Strip &strip : strips_) {
+      speed_changes_.insert(speed_changes_.end(), 
+                            strip.speed_changes.begin(),
+                            strip.speed_changes.end());
+    }
+  }
   
-  glm::vec2 p2_new_vel = particle2.GetVelocity() - p2_mass_ratio * ((float) 
-      (dot(v2_difference, x2_difference) / pow(magnitude2, 2)) * x2_difference);
+  if (Instrumentation::kEnabled) {
+    for (const Strip &strip : strips_) {
+      instrumentation_.AddCount(Counter::kCollisions, strip.resolved_count);
+    }
+  }
+  
+  PhaseTimer timer(instrumentation_, Phase::kIntegration);
+  std::atomic<size_t> wall_bounces(0);
+  size_t chunks = (particles_.size() + kMoveChunkSize - 1) / kMoveChunkSize;
+  thread_pool_->ParallelFor(chunks, [this, &wall_bounces](size_t chunk) {
+    size_t begin = chunk * kMoveChunkSize;
+    size_t bounces = MoveParticles(begin, std::min(kMoveChunkSize, 
+                                                   particles_.size() - begin));
+    if (Instrumentation::kEnabled) {
+      wall_bounces += bounces;
+    }
+  });
+  instrumentation_.AddCount(Counter::kWallBounces, wall_bounces);
+}
+
+void ParticleSimulator::MoveParticles() {
+  PhaseTimer timer(instrumentation_, Phase::kIntegration);
+  instrumentation_.AddCount(Counter::kWallBounces, 
+                            MoveParticles(0, particles_.size()));
+}
+
+void ParticleSimulator::ForEachChunk(
+    size_t count, const std::function<void(size_t, size_t)> &task) {
+  if (!thread_pool_) {
+    task(0, count);
+    return;
+  }
   
-  particle1.SetVelocity(p1_new_vel);
-  particle2.SetVelocity(p2_new_vel);
+  size_t chunks = (count + kMoveChunkSize - 1) / kMoveChunkSize;
+  thread_pool_->ParallelFor(chunks, [&](size_t chunk) {
+    size_t begin = chunk * kMoveChunkSize;
+    task(begin, std::min(begin + kMoveChunkSize, count));
+  });
 }
 
-std::pair<size_t, size_t> ParticleSimulator::GenerateRandomXYPosition() {
-  std::random_device rd;
+size_t ParticleSimulator::MoveParticles(size_t begin, size_t count) {
+  float *x = particles_.GetX() + begin;
+  float *y = particles_.GetY() + begin;
+  float *x_velocity = particles_.GetXVelocity() + begin;
+  float *y_velocity = particles_.GetYVelocity() + begin;
+  const uint32_t *species = particles_.GetSpeciesIndices() + begin;
+  const double *radii = particles_.GetSpeciesRadii();
   
-  // Seeds the random generator
-  std::mt19937 mt(rd());
+  // Only instrumented builds pay for counting the bounces
+#ifdef IDEAL_GAS_ENABLE_INSTRUMENTATION
+  return MoveParticlesCountingWallBounces(x, y, x_velocity, y_velocity,
+                                          species, radii, count,
+                                          (float) time_step_, 
+                                          container_.x_lower_bound, 
+                                          container_.y_lower_bound, 
+                                          container_.x_upper_bound, 
+                                          container_.y_upper_bound);
+#else
+  idealgas::MoveParticles(x, y, x_velocity, y_velocity, species, radii,
+                          count, (float) time_step_, 
+                          container_.x_lower_bound, container_.y_lower_bound,
+                          container_.x_upper_bound, container_.y_upper_bound);
+  return 0;
+#endif
+}
+
+ParticleSimulator::ParticleSimulator() 
+    : random_(std::random_device()()) {}
+
+std::pair<size_t, size_t> ParticleSimulator::GenerateRandomXYPosition(
+    uint64_t particle) const {
   
-  std::uniform_int_distribution<size_t> x_pos_distribution(
-      kXLowerBound + 2, kXUpperBound - 2);
-  std::uniform_int_distribution<size_t> y_pos_distribution(
-      kYLowerBound + 2, kYUpperBound - 2);
-  return std::make_pair(x_pos_distribution(mt), y_pos_distribution(mt));
+  // Whole pixels from the lower to the upper bound, both included. The 
+  // rounding could land exactly on the end of the range, so it is clamped
+  const size_t kXMin = (size_t) std::ceil(container_.x_lower_bound) + 2;
+  const size_t kXMax = (size_t) std::floor(container_.x_upper_bound) - 2;
+  const size_t kYMin = (size_t) std::ceil(container_.y_lower_bound) + 2;
+  const size_t kYMax = (size_t) std::floor(container_.y_upper_bound) - 2;
+  size_t x = (size_t) random_.GetUniform(particle * kRandomNumbersPerParticle,
+                                         kXMin, kXMax + 1);
+  size_t y = (size_t) random_.GetUniform(
+      particle * kRandomNumbersPerParticle + 1, kYMin, kYMax + 1);
+  return std::make_pair(std::min(x, kXMax), std::min(y, kYMax));
 }
 
-std::pair<double, double> ParticleSimulator::GenerateRandomXYVelocity(double radius) {
-  std::random_device rd;
+std::pair<double, double> ParticleSimulator::GenerateRandomXYVelocity(
+    uint64_t particle, double radius, bool any_direction) const {
   
-  // Seeds the random generator
-  std::mt19937 mt(rd());
+  // We half the radius to get the maximum range the particle may move in 
+  // one time step to prevent tunneling
+  double max_velocity = radius / 2 / time_step_;
+  uint64_t x_counter = particle * kRandomNumbersPerParticle + 2;
+  uint64_t y_counter = particle * kRandomNumbersPerParticle + 3;
+  double x_velocity = random_.GetUniform(x_counter, kMinimumVelocity, 
+                                         max_velocity);
+  double y_velocity = random_.GetUniform(y_counter, kMinimumVelocity, 
+                                         max_velocity);
   
-  // We half the radius to get the maximum range for the 
-  // particles velocity to prevent tunneling
-  std::uniform_int_distribution<double> x_vel_distribution(kMinimumVelocity, 
-                                                           radius / 2);
-  std::uniform_int_distribution<double> y_vel_distribution(kMinimumVelocity, 
-                                                           radius / 2);
-  return std::make_pair(x_vel_distribution(mt), y_vel_distribution(mt));
+  // GetUniform only uses the top bits of each number, so the lowest bit is
+  // free to pick the sign
+  if (any_direction && (random_.GetBits(x_counter) & 1)) {
+    x_velocity = -x_velocity;
+  }
+  if (any_direction && (random_.GetBits(y_counter) & 1)) {
+    y_velocity = -y_velocity;
+  }
+  return std::make_pair(x_velocity, y_velocity);
 }
 
 void ParticleSimulator::AddParticles(size_t amount, double radius, double mass,
                                      const std::string& color) {
+  AddRandomParticles(amount, radius, mass, color, false);
+}
 
-  
-  if (radius < 0.1) {
+void ParticleSimulator::AddParticlesInAnyDirection(size_t amount, 
+                                                   double radius, double mass,
+                                                   const std::string &color) {
+  AddRandomParticles(amount, radius, mass, color, true);
+}
+
+void ParticleSimulator::AddRandomParticles(size_t amount, double radius, 
+                                           double mass, 
+                                           const std::string &color,
+                                           bool any_direction) {
+  // Written so that NaN fails too
+  if (!(radius >= 0.1)) {
     throw std::invalid_argument("Please make sure the radius of the particles"
-                                " is at least 1!");
+                                " is at least 0.1!");
+  } else if (!(mass >= 0.1)) {
+    throw std::invalid_argument("Please make sure the mass of the particles"
+                                " is at least 0.1!");
+  } else if (2 * radius > container_.x_upper_bound - container_.x_lower_bound
+      || 2 * radius > container_.y_upper_bound - container_.y_lower_bound) {
+    throw std::invalid_argument("Please make sure the particles fit in the "
+                                "container!");
   }
   
-  for (size_t i = 0; i < amount; i++) {
-    std::pair<size_t, size_t> xy_position = GenerateRandomXYPosition();
-    std::pair<double, double> xy_velocity = GenerateRandomXYVelocity(radius);
-    particles_.emplace_back(glm::vec2(xy_position.first, xy_position.second), 
-                            glm::vec2(xy_velocity.first, xy_velocity.second),
-                            radius, mass, color);
+  // The free positions have to be found before the new particles are in
+  // the store, or they would be in the way of themselves
+  std::vector<float> free_x;
+  std::vector<float> free_y;
+  uint64_t first_random = random_particles_;
+  if (placement_ == Placement::kNonOverlapping) {
+    free_x.resize(amount);
+    free_y.resize(amount);
+    FindFreePositions(amount, radius, free_x.data(), free_y.data());
+  } else {
+    random_particles_ += amount;
   }
+  
+  size_t first = particles_.AddParticles(amount, radius, mass, color);
+  
+  // Every particle has its own random numbers, so the chunks can be filled
+  // in any order and on any amount of threads with the same results
+  ForEachChunk(amount, [&](size_t begin, size_t end) {
+    float *x = particles_.GetX() + first;
+    float *y = particles_.GetY() + first;
+    float *x_velocity = particles_.GetXVelocity() + first;
+    float *y_velocity = particles_.GetYVelocity() + first;
+    for (size_t i = begin; i < end; i++) {
+      if (placement_ == Placement::kNonOverlapping) {
+        x[i] = free_x[i];
+        y[i] = free_y[i];
+      } else {
+        std::pair<size_t, size_t> xy_position = 
+            GenerateRandomXYPosition(first_random + i);
+        x[i] = (float) xy_position.first;
+        y[i] = (float) xy_position.second;
+      }
+      std::pair<double, double> xy_velocity = 
+          GenerateRandomXYVelocity(first_random + i, radius, any_direction);
+      x_velocity[i] = (float) xy_velocity.first;
+      y_velocity[i] = (float) xy_velocity.second;
+    }
+  });
+  RecordAddedParticles(first);
+  event_engine_outdated_ = true;
 }
 
 
@@ -124,16 +422,55 @@ void ParticleSimulator::AddParticles(size_t amount, double radius,
                                initial_x_vel, 
                                initial_y_vel);
     
-  for (size_t i = 0; i < amount; i++) {
-    particles_.emplace_back(glm::vec2(x_coord, y_coord),
-                            glm::vec2(initial_x_vel, initial_y_vel), radius,
-                            mass, color);
-  }
+  size_t first = particles_.AddParticles(amount, radius, mass, color);
+  size_t end = first + amount;
+  std::fill(particles_.GetX() + first, particles_.GetX() + end, 
+            (float) x_coord);
+  std::fill(particles_.GetY() + first, particles_.GetY() + end, 
+            (float) y_coord);
+  std::fill(particles_.GetXVelocity() + first, 
+            particles_.GetXVelocity() + end, (float) initial_x_vel);
+  std::fill(particles_.GetYVelocity() + first, 
+            particles_.GetYVelocity() + end, (float) initial_y_vel);
+  RecordAddedParticles(first);
+  event_engine_outdated_ = true;
 }
+
+void ParticleSimulator::AddParticles(size_t amount, double radius,
+                                     double mass, const std::string &color,
+                                     const float *x_coords, 
+                                     const float *y_coords,
+                                     const float *x_velocities,
+                                     const float *y_velocities) {
+  
+  // Everything is checked before anything is added, so a bad particle 
+  // leaves the simulation as it was
+  ForEachChunk(amount, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      ValidateAddParticleArguments(radius, mass, x_coords[i], y_coords[i], 
+                                   x_velocities[i], y_velocities[i]);
+    }
+  });
+  
+  size_t first = particles_.AddParticles(amount, radius, mass, color);
+  ForEachChunk(amount, [&](size_t begin, size_t end) {
+    std::copy(x_coords + begin, x_coords + end, 
+              particles_.GetX() + first + begin);
+    std::copy(y_coords + begin, y_coords + end, 
+              particles_.GetY() + first + begin);
+    std::copy(x_velocities + begin, x_velocities + end,
+              particles_.GetXVelocity() + first + begin);
+    std::copy(y_velocities + begin, y_velocities + end,
+              particles_.GetYVelocity() + first + begin);
+  });
+  RecordAddedParticles(first);
+  event_engine_outdated_ = true;
+}
+
 void ParticleSimulator::ValidateAddParticleArguments(double radius,
                                                      double mass,
-                                                     size_t x_coord,
-                                                     size_t y_coord,
+                                                     double x_coord,
+                                                     double y_coord,
                                                      double initial_x_vel,
                                                      double initial_y_vel) 
                                                      const {
@@ -152,57 +489,283 @@ void ParticleSimulator::ValidateAddParticleArguments(double radius,
                                 " particles is not 0!");
     
     // If particle velocity is greater than the half its radius, tunneling 
-    // may occur so we throw an error if that's the parameter 
-  } else if (abs(initial_x_vel) > radius * .8 || abs(initial_y_vel) > radius *
-  0.8) {
+    // may occur so we throw an error if that's the parameter. The event 
+    // driven engine and continuous collisions can't tunnel, so they allow 
+    // any velocity
+  } else if (!AllowsAnyVelocity() && (abs(initial_x_vel) * time_step_ > 
+  radius * .8 || abs(initial_y_vel) * time_step_ > radius * 0.8)) {
     throw std::invalid_argument("Please make sure the magnitude of the initial "
                                 "velocity of the particles is at most half "
                                 "the radius! Tunneling will occur otherwise!");
 
     // Checks if the particle's initial position is in the container or not
-  } else if (x_coord < kXLowerBound || x_coord > kXUpperBound) {
+  } else if (x_coord < container_.x_lower_bound || 
+      x_coord > container_.x_upper_bound) {
     throw std::invalid_argument("Please make sure the spawn x coordinate is "
                                 "within the container boundaries of " +
-        std::to_string(kXLowerBound) + " and " + std::to_string
-        (kXUpperBound));
+        std::to_string(container_.x_lower_bound) + " and " + std::to_string
+        (container_.x_upper_bound));
 
-  } else if (y_coord < kYLowerBound || y_coord > kYUpperBound) {
+  } else if (y_coord < container_.y_lower_bound || 
+      y_coord > container_.y_upper_bound) {
     throw std::invalid_argument("Please make sure the spawn y coordinate is "
                                 "within the container boundaries of " + 
-                                std::to_string(kYLowerBound) + 
+                                std::to_string(container_.y_lower_bound) + 
                                 " and " + std::to_string
-                                (kYUpperBound));
+                                (container_.y_upper_bound));
   }
 }
 
-void ParticleSimulator::Draw() {
-  
-  // Draws the inner container for the pixels 
-  glm::vec2 top_left = glm::vec2(kXLowerBound, kYLowerBound);
-  glm::vec2 bottom_right = glm::vec2(kXUpperBound, kYUpperBound);
-  ci::Rectf container(top_left, bottom_right);
+void ParticleSimulator::SetPlacement(Placement placement) {
+  placement_ = placement;
+}
 
-  ci::gl::color(ci::Color("white"));
-  ci::gl::drawStrokedRect(container);
-  
-  for (Particle& particle : particles_) {
-    particle.DrawParticle();
-  }
+Placement ParticleSimulator::GetPlacement() const {
+  return placement_;
+}
+
+void ParticleSimulator::FindFreePositions(size_t amount, double radius,
+                                          float *x_coords, float *y_coords) {
+  PlaceWithoutOverlaps(particles_, amount, radius, random_,
+                       random_particles_ * kRandomNumbersPerParticle,
+                       kRandomNumbersPerParticle, container_.x_lower_bound,
+                       container_.y_lower_bound, container_.x_upper_bound,
+                       container_.y_upper_bound, x_coords, y_coords);
+  random_particles_ += amount;
+}
+
+void ParticleSimulator::Reserve(size_t amount) {
+  particles_.Reserve(amount);
 }
 
 void ParticleSimulator::SpeedUp() {
-  for (Particle& particle : particles_) {
+  for (size_t i = 0; i < particles_.size(); i++) {
+    Particle particle = particles_[i];
     particle.SpeedUp();
+    SetTrackedVelocity(i, particle.GetVelocity());
   }
+  event_engine_outdated_ = true;
 }
 
 void ParticleSimulator::SlowDown() {
-  for (Particle& particle : particles_) {
+  for (size_t i = 0; i < particles_.size(); i++) {
+    Particle particle = particles_[i];
     particle.SlowDown();
+    SetTrackedVelocity(i, particle.GetVelocity());
+  }
+  event_engine_outdated_ = true;
+}
+
+void ParticleSimulator::SetBroadphase(Broadphase broadphase) {
+  broadphase_ = broadphase;
+}
+
+Broadphase ParticleSimulator::GetBroadphase() const {
+  return broadphase_;
+}
+
+void ParticleSimulator::SetThreadCount(size_t thread_count) {
+  if (thread_count == 0) {
+    thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  
+  if (thread_count == 1) {
+    thread_pool_.reset();
+  } else if (!thread_pool_ || thread_pool_->GetThreadCount() != thread_count) {
+    thread_pool_ = std::make_shared<ThreadPool>(thread_count);
+  }
+}
+
+size_t ParticleSimulator::GetCandidatePairCount() const {
+  return candidate_pair_count_;
+}
+
+InstrumentationSnapshot ParticleSimulator::GetInstrumentationSnapshot() 
+    const {
+  return instrumentation_.GetSnapshot();
+}
+
+void ParticleSimulator::ResetInstrumentation() {
+  instrumentation_.Reset();
+}
+
+void ParticleSimulator::SetSpeedChangeTracking(bool tracking) {
+  speed_change_tracking_ = tracking;
+  if (!tracking) {
+    speed_changes_.clear();
+  }
+}
+
+bool ParticleSimulator::GetSpeedChangeTracking() const {
+  return speed_change_tracking_;
+}
+
+const std::vector<SpeedChange> &ParticleSimulator::GetSpeedChanges() const {
+  return speed_changes_;
+}
+
+void ParticleSimulator::ClearSpeedChanges() {
+  speed_changes_.clear();
+}
+
+std::vector<SpeedChange> *ParticleSimulator::GetSpeedChangeLog() {
+  return speed_change_tracking_ ? &speed_changes_ : nullptr;
+}
+
+void ParticleSimulator::RecordAddedParticles(size_t first) {
+  if (!speed_change_tracking_) {
+    return;
+  }
+  const float *x_velocity = particles_.GetXVelocity();
+  const float *y_velocity = particles_.GetYVelocity();
+  for (size_t i = first; i < particles_.size(); i++) {
+    speed_changes_.push_back({(uint32_t) i, kNoSpeed, 
+                              GetSpeed(x_velocity[i], y_velocity[i])});
+  }
+}
+
+void ParticleSimulator::SetTrackedVelocity(size_t particle, 
+                                           const glm::vec2 &velocity) {
+  if (speed_change_tracking_) {
+    glm::vec2 old_velocity = particles_.GetVelocity(particle);
+    RecordSpeedChange(&speed_changes_, (uint32_t) particle,
+                      GetSpeed(old_velocity.x, old_velocity.y),
+                      GetSpeed(velocity.x, velocity.y));
   }
+  particles_.SetVelocity(particle, velocity);
+}
+
+size_t ParticleSimulator::GetThreadCount() const {
+  return thread_pool_ ? thread_pool_->GetThreadCount() : 1;
+}
+
+void ParticleSimulator::SetTimeStep(double time_step) {
+  if (!(time_step > 0)) {
+    throw std::invalid_argument("Please make sure the time step is "
+                                "positive!");
+  }
+  time_step_ = time_step;
+}
+
+double ParticleSimulator::GetTimeStep() const {
+  return time_step_;
+}
+
+void ParticleSimulator::SetMaxSubsteps(size_t max_substeps) {
+  if (max_substeps == 0) {
+    throw std::invalid_argument("Please make sure at least one substep is "
+                                "allowed!");
+  }
+  max_substeps_ = max_substeps;
+}
+
+size_t ParticleSimulator::GetMaxSubsteps() const {
+  return max_substeps_;
+}
+
+void ParticleSimulator::SetCollisionDetection(
+    CollisionDetection collision_detection) {
+  collision_detection_ = collision_detection;
+}
+
+CollisionDetection ParticleSimulator::GetCollisionDetection() const {
+  return collision_detection_;
+}
+
+void ParticleSimulator::SetEngine(Engine engine) {
+  if (engine != engine_) {
+    engine_ = engine;
+    event_engine_outdated_ = true;
+  }
+}
+
+Engine ParticleSimulator::GetEngine() const {
+  return engine_;
+}
+
+void ParticleSimulator::SetSeed(uint64_t seed) {
+  random_ = CounterRng(seed);
+  random_particles_ = 0;
+}
+
+uint64_t ParticleSimulator::GetSeed() const {
+  return random_.GetSeed();
+}
+
+void ParticleSimulator::SetContainer(const Container &container) {
+  if (!IsValidContainer(container)) {
+    throw std::invalid_argument("Please make sure the container starts at 0 "
+                                "or more and is at least 4 pixels wide and "
+                                "tall!");
+  }
+  container_ = container;
+  event_engine_outdated_ = true;
+}
+
+const Container &ParticleSimulator::GetContainer() const {
+  return container_;
+}
+
+bool ParticleSimulator::IsValidContainer(const Container &container) {
+  
+  // Written so that NaN walls fail too. The bounds are the same as the 
+  // range GenerateRandomXYPosition picks from
+  return container.x_lower_bound >= 0 && container.y_lower_bound >= 0 &&
+      std::ceil(container.x_lower_bound) + 2 <= 
+          std::floor(container.x_upper_bound) - 2 &&
+      std::ceil(container.y_lower_bound) + 2 <= 
+          std::floor(container.y_upper_bound) - 2;
+}
+
+uint64_t ParticleSimulator::GetStepCount() const {
+  return steps_;
+}
+
+void ParticleSimulator::SaveCheckpoint(const std::string &path) const {
+  CheckpointState state;
+  state.seed = random_.GetSeed();
+  state.random_particles = random_particles_;
+  state.steps = steps_;
+  state.accumulated_time = accumulated_time_;
+  state.time_step = time_step_;
+  state.max_substeps = max_substeps_;
+  state.engine = engine_;
+  state.collision_detection = collision_detection_;
+  state.broadphase = broadphase_;
+  state.placement = placement_;
+  state.container = container_;
+  WriteCheckpoint(path, particles_, state);
+}
+
+void ParticleSimulator::LoadCheckpoint(const std::string &path) {
+  
+  // Reads everything before changing anything, so a bad file leaves the 
+  // simulation as it was
+  ParticleStore particles;
+  CheckpointState state = ReadCheckpoint(path, &particles);
+  if (!(state.time_step > 0) || state.max_substeps == 0 ||
+      !IsValidContainer(state.container)) {
+    throw std::invalid_argument("Please make sure the checkpoint is "
+                                "complete and undamaged!");
+  }
+  
+  particles_ = std::move(particles);
+  random_ = CounterRng(state.seed);
+  random_particles_ = state.random_particles;
+  steps_ = state.steps;
+  accumulated_time_ = state.accumulated_time;
+  time_step_ = state.time_step;
+  max_substeps_ = (size_t) state.max_substeps;
+  engine_ = state.engine;
+  collision_detection_ = state.collision_detection;
+  broadphase_ = state.broadphase;
+  placement_ = state.placement;
+  container_ = state.container;
+  event_engine_outdated_ = true;
+  speed_changes_.clear();
 }
 
-const std::vector<Particle> &ParticleSimulator::GetParticles() const {
+const ParticleStore &ParticleSimulator::GetParticles() const {
   return particles_;
 }
 
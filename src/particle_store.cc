@@ -0,0 +1,250 @@
+#include <particle_store.h>
+#include <stdexcept>
+
+namespace idealgas {
+
+ParticleStore::ConstIterator::ConstIterator(const ParticleStore *store,
+                                            size_t index) {
+  store_ = store;
+  index_ = index;
+}
+
+Particle ParticleStore::ConstIterator::operator*() const {
+  return (*store_)[index_];
+}
+
+ParticleStore::ConstIterator &ParticleStore::ConstIterator::operator++() {
+  index_++;
+  return *this;
+}
+
+ParticleStore::ConstIterator ParticleStore::ConstIterator::operator++(int) {
+  ConstIterator previous = *this;
+  index_++;
+  return previous;
+}
+
+bool ParticleStore::ConstIterator::operator==(const ConstIterator &other)
+const {
+  return store_ == other.store_ && index_ == other.index_;
+}
+
+bool ParticleStore::ConstIterator::operator!=(const ConstIterator &other)
+const {
+  return !(*this == other);
+}
+
+uint32_t ParticleStore::AddSpecies(double radius, double mass,
+                                   const std::string &color) {
+  uint32_t found = FindSpecies(radius, mass, color);
+  if (found < species_.size()) {
+    return found;
+  }
+  
+  Species species;
+  species.radius = radius;
+  species.mass = mass;
+  species.inverse_mass = 1 / mass;
+  species.color = color;
+  species_.push_back(species);
+  species_radius_.push_back(radius);
+  species_inverse_mass_.push_back(species.inverse_mass);
+  species_mass_.push_back(mass);
+  return (uint32_t) (species_.size() - 1);
+}
+
+uint32_t ParticleStore::FindSpecies(double radius, double mass,
+                                    const std::string &color) const {
+  for (size_t i = 0; i < species_.size(); i++) {
+    if (species_[i].radius == radius && species_[i].mass == mass && 
+        species_[i].color == color) {
+      return (uint32_t) i;
+    }
+  }
+  return (uint32_t) species_.size();
+}
+
+void ParticleStore::AddParticle(const glm::vec2 &position,
+                                const glm::vec2 &velocity, double radius,
+                                double mass, const std::string &color) {
+  AddParticle(position, velocity, AddSpecies(radius, mass, color));
+}
+
+void ParticleStore::AddParticle(const glm::vec2 &position,
+                                const glm::vec2 &velocity, uint32_t species) {
+  x_.push_back(position.x);
+  y_.push_back(position.y);
+  x_velocity_.push_back(velocity.x);
+  y_velocity_.push_back(velocity.y);
+  species_index_.push_back(species);
+}
+
+size_t ParticleStore::AddParticles(size_t amount, double radius, double mass,
+                                   const std::string &color) {
+  return AddParticles(amount, AddSpecies(radius, mass, color));
+}
+
+size_t ParticleStore::AddParticles(size_t amount, uint32_t species) {
+  size_t first = size();
+  size_t total = first + amount;
+  x_.resize(total);
+  y_.resize(total);
+  x_velocity_.resize(total);
+  y_velocity_.resize(total);
+  species_index_.resize(total, species);
+  return first;
+}
+
+size_t ParticleStore::AddParticles(size_t amount, const float *x,
+                                   const float *y, const float *x_velocity,
+                                   const float *y_velocity,
+                                   const uint32_t *species) {
+  for (size_t i = 0; i < amount; i++) {
+    if (species[i] >= species_.size()) {
+      throw std::invalid_argument("Please make sure every particle's species "
+                                  "is in the species table!");
+    }
+  }
+  
+  size_t first = size();
+  x_.insert(x_.end(), x, x + amount);
+  y_.insert(y_.end(), y, y + amount);
+  x_velocity_.insert(x_velocity_.end(), x_velocity, x_velocity + amount);
+  y_velocity_.insert(y_velocity_.end(), y_velocity, y_velocity + amount);
+  species_index_.insert(species_index_.end(), species, species + amount);
+  return first;
+}
+
+void ParticleStore::Reserve(size_t amount) {
+  x_.reserve(amount);
+  y_.reserve(amount);
+  x_velocity_.reserve(amount);
+  y_velocity_.reserve(amount);
+  species_index_.reserve(amount);
+}
+
+size_t ParticleStore::size() const {
+  return x_.size();
+}
+
+bool ParticleStore::empty() const {
+  return x_.empty();
+}
+
+Particle ParticleStore::operator[](size_t index) const {
+  const Species &species = species_[species_index_[index]];
+  return Particle(GetPosition(index), GetVelocity(index), species.radius,
+                  species.mass, species.color);
+}
+
+Particle ParticleStore::at(size_t index) const {
+  if (index >= size()) {
+    throw std::out_of_range("There is no particle at index " +
+        std::to_string(index));
+  }
+  return (*this)[index];
+}
+
+ParticleStore::ConstIterator ParticleStore::begin() const {
+  return ConstIterator(this, 0);
+}
+
+ParticleStore::ConstIterator ParticleStore::end() const {
+  return ConstIterator(this, size());
+}
+
+ParticleStore::operator std::vector<Particle>() const {
+  std::vector<Particle> particles;
+  particles.reserve(size());
+  for (size_t i = 0; i < size(); i++) {
+    particles.push_back((*this)[i]);
+  }
+  return particles;
+}
+
+glm::vec2 ParticleStore::GetPosition(size_t index) const {
+  return glm::vec2(x_[index], y_[index]);
+}
+
+glm::vec2 ParticleStore::GetVelocity(size_t index) const {
+  return glm::vec2(x_velocity_[index], y_velocity_[index]);
+}
+
+void ParticleStore::SetVelocity(size_t index, const glm::vec2 &velocity) {
+  x_velocity_[index] = velocity.x;
+  y_velocity_[index] = velocity.y;
+}
+
+double ParticleStore::GetRadius(size_t index) const {
+  return species_radius_[species_index_[index]];
+}
+
+double ParticleStore::GetMass(size_t index) const {
+  return species_mass_[species_index_[index]];
+}
+
+double ParticleStore::GetInverseMass(size_t index) const {
+  return species_inverse_mass_[species_index_[index]];
+}
+
+const std::string &ParticleStore::GetColor(size_t index) const {
+  return species_[species_index_[index]].color;
+}
+
+uint32_t ParticleStore::GetSpeciesIndex(size_t index) const {
+  return species_index_[index];
+}
+
+const std::vector<Species> &ParticleStore::GetSpecies() const {
+  return species_;
+}
+
+float *ParticleStore::GetX() {
+  return x_.data();
+}
+
+float *ParticleStore::GetY() {
+  return y_.data();
+}
+
+float *ParticleStore::GetXVelocity() {
+  return x_velocity_.data();
+}
+
+float *ParticleStore::GetYVelocity() {
+  return y_velocity_.data();
+}
+
+const float *ParticleStore::GetX() const {
+  return x_.data();
+}
+
+const float *ParticleStore::GetY() const {
+  return y_.data();
+}
+
+const float *ParticleStore::GetXVelocity() const {
+  return x_velocity_.data();
+}
+
+const float *ParticleStore::GetYVelocity() const {
+  return y_velocity_.data();
+}
+
+const uint32_t *ParticleStore::GetSpeciesIndices() const {
+  return species_index_.data();
+}
+
+const double *ParticleStore::GetSpeciesRadii() const {
+  return species_radius_.data();
+}
+
+const double *ParticleStore::GetSpeciesInverseMasses() const {
+  return species_inverse_mass_.data();
+}
+
+const double *ParticleStore::GetSpeciesMasses() const {
+  return species_mass_.data();
+}
+
+} // namespace idealgas
@@ -0,0 +1,234 @@
+#include <placement.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace idealgas {
+
+namespace {
+
+// Extra room kept between particles and from the walls, so rounding the
+// positions to floats can't make neighbors touch
+const double kGap = 1e-3;
+
+// How much the site spacing shrinks each time there aren't enough free
+// sites for the particles
+const double kSpacingShrink = 0.9;
+
+const double kPi = 3.14159265358979323846;
+
+// Caps the amount of cells, like in UniformGrid
+const size_t kMaxCellsPerParticle = 4;
+
+/**
+ * The particles of the store bucketed into square cells, so checking if a
+ * site is free only looks at the particles in the nearby cells
+ */
+class OccupiedCells {
+ public:
+  OccupiedCells(const ParticleStore &particles, double clearance,
+                double x_lower_bound, double y_lower_bound,
+                double x_upper_bound, double y_upper_bound)
+      : particles_(particles), clearance_(clearance),
+        x_lower_bound_(x_lower_bound), y_lower_bound_(y_lower_bound) {
+    double max_radius = 0;
+    for (const Species &species : particles.GetSpecies()) {
+      max_radius = std::max(max_radius, species.radius);
+    }
+
+    // A site can only be too close to particles in its own cell or the
+    // neighboring ones
+    cell_size_ = clearance + max_radius;
+
+    // Bigger cells are still correct, so they are grown to keep the amount
+    // of cells in line with the amount of particles
+    double width = x_upper_bound - x_lower_bound;
+    double height = y_upper_bound - y_lower_bound;
+    double max_cells = (double) kMaxCellsPerParticle * particles.size() + 1;
+    if (width * height / (cell_size_ * cell_size_) > max_cells) {
+      cell_size_ = std::sqrt(width * height / max_cells);
+    }
+    columns_ = std::max<size_t>(1, (size_t) std::ceil(
+        width / cell_size_));
+    rows_ = std::max<size_t>(1, (size_t) std::ceil(height / cell_size_));
+
+    // Counting sort by cell, like UniformGrid
+    std::vector<size_t> cells(particles.size());
+    cell_start_.assign(columns_ * rows_ + 1, 0);
+    for (size_t i = 0; i < particles.size(); i++) {
+      cells[i] = FindColumn(particles.GetX()[i]) +
+          FindRow(particles.GetY()[i]) * columns_;
+      cell_start_[cells[i] + 1]++;
+    }
+    for (size_t cell = 0; cell < columns_ * rows_; cell++) {
+      cell_start_[cell + 1] += cell_start_[cell];
+    }
+    cell_particles_.resize(particles.size());
+    std::vector<size_t> fill(cell_start_.begin(), cell_start_.end() - 1);
+    for (size_t i = 0; i < particles.size(); i++) {
+      cell_particles_[fill[cells[i]]++] = i;
+    }
+  }
+
+  /**
+   * Checks if a site is at least the clearance plus their radius away from
+   * every particle
+   */
+  bool IsFree(double x, double y) const {
+    if (cell_particles_.empty()) {
+      return true;
+    }
+
+    size_t column = FindColumn(x);
+    size_t row = FindRow(y);
+    for (size_t r = row > 0 ? row - 1 : 0; r <= std::min(row + 1, rows_ - 1);
+         r++) {
+      for (size_t c = column > 0 ? column - 1 : 0;
+           c <= std::min(column + 1, columns_ - 1); c++) {
+        size_t cell = c + r * columns_;
+        for (size_t k = cell_start_[cell]; k < cell_start_[cell + 1]; k++) {
+          size_t particle = cell_particles_[k];
+          double x_distance = x - particles_.GetX()[particle];
+          double y_distance = y - particles_.GetY()[particle];
+          double min_distance = clearance_ + particles_.GetRadius(particle);
+          if (x_distance * x_distance + y_distance * y_distance <
+              min_distance * min_distance) {
+            return false;
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+ private:
+  const ParticleStore &particles_;
+  double clearance_;
+  double x_lower_bound_;
+  double y_lower_bound_;
+  double cell_size_;
+  size_t columns_;
+  size_t rows_;
+  std::vector<size_t> cell_start_;
+  std::vector<size_t> cell_particles_;
+
+  size_t FindColumn(double x) const {
+    double column = std::floor((x - x_lower_bound_) / cell_size_);
+    return (size_t) std::min(std::max(column, 0.0), (double) columns_ - 1);
+  }
+
+  size_t FindRow(double y) const {
+    double row = std::floor((y - y_lower_bound_) / cell_size_);
+    return (size_t) std::min(std::max(row, 0.0), (double) rows_ - 1);
+  }
+};
+
+/**
+ * Finds the sites of a hexagonal lattice that are free of the particles in
+ * the store. Any point within the jitter of a free site is free as well
+ */
+void FindFreeSites(const ParticleStore &particles, double radius,
+                   double spacing, double jitter, double x_lower_bound,
+                   double y_lower_bound, double x_upper_bound,
+                   double y_upper_bound, std::vector<double> &site_x,
+                   std::vector<double> &site_y) {
+  site_x.clear();
+  site_y.clear();
+
+  double margin = radius + jitter + kGap;
+  double x_min = x_lower_bound + margin;
+  double y_min = y_lower_bound + margin;
+  double x_max = x_upper_bound - margin;
+  double y_max = y_upper_bound - margin;
+  if (x_min > x_max || y_min > y_max) {
+    return;
+  }
+
+  OccupiedCells occupied(particles, radius + jitter + kGap, x_lower_bound,
+                         y_lower_bound, x_upper_bound, y_upper_bound);
+
+  // Every other row is shifted by half the spacing, which puts each site
+  // exactly the spacing away from its six neighbors
+  double row_height = spacing * std::sqrt(3.0) / 2;
+  for (size_t row = 0; y_min + row * row_height <= y_max; row++) {
+    double y = y_min + row * row_height;
+    double offset = row % 2 == 0 ? 0 : spacing / 2;
+    for (size_t column = 0; x_min + offset + column * spacing <= x_max;
+         column++) {
+      double x = x_min + offset + column * spacing;
+      if (occupied.IsFree(x, y)) {
+        site_x.push_back(x);
+        site_y.push_back(y);
+      }
+    }
+  }
+}
+
+} // namespace
+
+void PlaceWithoutOverlaps(const ParticleStore &particles, size_t amount,
+                          double radius, const CounterRng &random,
+                          uint64_t first_counter, uint64_t counter_stride,
+                          double x_lower_bound, double y_lower_bound,
+                          double x_upper_bound, double y_upper_bound,
+                          float *x_coords, float *y_coords) {
+  if (amount == 0) {
+    return;
+  }
+
+  // Starts with the spacing that would fit the particles into the whole
+  // container with some room to spare, and packs the sites closer each
+  // time there aren't enough free ones, down to particles touching
+  double area = (x_upper_bound - x_lower_bound) *
+      (y_upper_bound - y_lower_bound);
+  double min_spacing = 2 * radius + kGap;
+  double spacing = std::max(min_spacing, std::sqrt(
+      area / amount * 2 / std::sqrt(3.0)) * kSpacingShrink);
+
+  std::vector<double> site_x;
+  std::vector<double> site_y;
+  double jitter;
+  while (true) {
+    jitter = (spacing - min_spacing) / 2;
+    FindFreeSites(particles, radius, spacing, jitter, x_lower_bound,
+                  y_lower_bound, x_upper_bound, y_upper_bound, site_x,
+                  site_y);
+    if (site_x.size() >= amount) {
+      break;
+    }
+
+    if (spacing == min_spacing) {
+      double covered = amount * kPi * radius * radius;
+      for (size_t i = 0; i < particles.size(); i++) {
+        covered += kPi * particles.GetRadius(i) * particles.GetRadius(i);
+      }
+      throw std::invalid_argument(
+          "Please make sure the particles fit in the container! Only " +
+          std::to_string(site_x.size()) + " more particles of radius " +
+          std::to_string(radius) + " fit without overlapping, but " +
+          std::to_string(amount) + " were added, a packing fraction of " +
+          std::to_string(covered / area) + "!");
+    }
+    spacing = std::max(min_spacing, spacing * kSpacingShrink);
+  }
+
+  // Picks the sites with a partial Fisher-Yates shuffle, then moves each
+  // particle to a random point in the circle it has around its site
+  for (size_t i = 0; i < amount; i++) {
+    uint64_t counter = first_counter + i * counter_stride;
+    size_t pick = i + std::min(site_x.size() - i - 1, (size_t)
+        random.GetUniform(counter + 4, 0, (double) (site_x.size() - i)));
+    std::swap(site_x[i], site_x[pick]);
+    std::swap(site_y[i], site_y[pick]);
+
+    double angle = random.GetUniform(counter, 0, 2 * kPi);
+    double distance = jitter * std::sqrt(random.GetUniform(counter + 1, 0,
+                                                           1));
+    x_coords[i] = (float) (site_x[i] + distance * std::cos(angle));
+    y_coords[i] = (float) (site_y[i] + distance * std::sin(angle));
+  }
+}
+
+} // namespace idealgas
@@ -0,0 +1,112 @@
+#include <simulation_thread.h>
+#include <chrono>
+
+namespace idealgas {
+
+// This is passed to std::chrono::microseconds by reference, so it needs a
+// definition
+const int SimulationThread::kIdleMicroseconds;
+
+SimulationThread::SimulationThread(const ParticleSimulator &simulator,
+                                   const std::vector<Histogram> &histograms,
+                                   double ticks_per_second)
+    : simulator_(simulator), histograms_(histograms),
+      ticks_per_second_(ticks_per_second) {
+
+  // The bins are filled once here and then only updated from the speed
+  // changes of each advance
+  Histogram::FillBins(simulator_.GetParticles(), histograms_);
+  simulator_.SetSpeedChangeTracking(true);
+  simulator_.ClearSpeedChanges();
+}
+
+SimulationThread::~SimulationThread() {
+  Stop();
+}
+
+void SimulationThread::Start() {
+  if (running_) {
+    return;
+  }
+  PublishSnapshot();
+  running_ = true;
+  thread_ = std::thread(&SimulationThread::Run, this);
+}
+
+void SimulationThread::Stop() {
+  running_ = false;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void SimulationThread::Post(
+    const std::function<void(ParticleSimulator &)> &command) {
+  std::lock_guard<std::mutex> lock(command_mutex_);
+  commands_.push_back(command);
+}
+
+const SimulationSnapshot &SimulationThread::GetLatestSnapshot() {
+  {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+  snapshots_.Update();
+  return snapshots_.GetReadBuffer();
+}
+
+void SimulationThread::Run() {
+  try {
+    std::chrono::steady_clock::time_point last_time =
+        std::chrono::steady_clock::now();
+    while (running_) {
+      RunCommands();
+
+      // The simulator keeps the time that doesn't fill a whole step, so
+      // it runs at the same speed however often this loop comes around
+      std::chrono::steady_clock::time_point time =
+          std::chrono::steady_clock::now();
+      size_t steps = simulator_.Advance(std::chrono::duration<double>(
+          time - last_time).count() * ticks_per_second_);
+      last_time = time;
+
+      if (steps == 0 && simulator_.GetSpeedChanges().empty()) {
+        std::this_thread::sleep_for(std::chrono::microseconds(
+            kIdleMicroseconds));
+        continue;
+      }
+      steps_ += steps;
+      Histogram::ApplySpeedChanges(simulator_.GetParticles(),
+                                   simulator_.GetSpeedChanges(),
+                                   histograms_);
+      simulator_.ClearSpeedChanges();
+      PublishSnapshot();
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    error_ = std::current_exception();
+  }
+}
+
+void SimulationThread::RunCommands() {
+  std::vector<std::function<void(ParticleSimulator &)>> commands;
+  {
+    std::lock_guard<std::mutex> lock(command_mutex_);
+    commands.swap(commands_);
+  }
+  for (const std::function<void(ParticleSimulator &)> &command : commands) {
+    command(simulator_);
+  }
+}
+
+void SimulationThread::PublishSnapshot() {
+  SimulationSnapshot &snapshot = snapshots_.GetWriteBuffer();
+  snapshot.particles = simulator_.GetParticles();
+  snapshot.histograms = histograms_;
+  snapshot.steps = steps_;
+  snapshots_.Publish();
+}
+
+} // namespace idealgas
@@ -0,0 +1,66 @@
+#include <sort_and_sweep.h>
+#include <algorithm>
+
+namespace idealgas {
+
+void SortAndSweep::FindCandidatePairs(const ParticleStore &particles,
+                                      std::vector<ParticlePair>
+                                      &pairs) {
+  pairs.clear();
+
+  // New particles are added at the end of the order and the insertion sort
+  // moves them to the right place
+  if (order_.size() > particles.size()) {
+    order_.clear();
+  }
+  for (size_t i = order_.size(); i < particles.size(); i++) {
+    order_.push_back(i);
+  }
+
+  const float *x = particles.GetX();
+  const uint32_t *species = particles.GetSpeciesIndices();
+  const double *radii = particles.GetSpeciesRadii();
+  min_x_.resize(particles.size());
+  max_x_.resize(particles.size());
+  for (size_t i = 0; i < particles.size(); i++) {
+    min_x_[i] = x[i] - radii[species[i]];
+    max_x_[i] = x[i] + radii[species[i]];
+  }
+
+  SortIntervals();
+
+  // Every particle only has to be checked against the particles after it in
+  // the order until one starts past its right edge. The bound is inclusive
+  // so that rounding never drops a pair that ResolveCollision would accept
+  for (size_t a = 0; a < order_.size(); a++) {
+    size_t first = order_[a];
+    for (size_t b = a + 1; b < order_.size() && min_x_[order_[b]] <=
+        max_x_[first]; b++) {
+      size_t second = order_[b];
+      pairs.emplace_back((uint32_t) std::min(first, second),
+                         (uint32_t) std::max(first, second));
+    }
+  }
+}
+
+void SortAndSweep::SortIntervals() {
+  for (size_t i = 1; i < order_.size(); i++) {
+    size_t index = order_[i];
+    double key = min_x_[index];
+
+    // Shifts the particles with a bigger left edge up by one until the
+    // right spot for this particle is found
+    size_t j = i;
+    while (j > 0 && min_x_[order_[j - 1]] > key) {
+      order_[j] = order_[j - 1];
+      j--;
+    }
+    order_[j] = index;
+  }
+}
+
+const std::vector<size_t> &SortAndSweep::GetOrder() const {
+  return order_;
+}
+
+} // namespace idealgas
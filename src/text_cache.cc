@@ -0,0 +1,47 @@
+#include <text_cache.h>
+#include "cinder/Text.h"
+
+namespace idealgas {
+
+TextCache::TextCache(const std::string &font_name, float font_size)
+    : font_name_(font_name), font_size_(font_size) {}
+
+void TextCache::DrawCentered(const std::string &text,
+                             const glm::vec2 &position,
+                             const ci::ColorA &color) {
+  const Entry &entry = FindEntry(text);
+
+  // The same offsets ci::gl::drawStringCentered uses
+  ci::gl::ScopedColor scoped_color(color);
+  ci::gl::draw(entry.texture, position - glm::vec2(
+      entry.texture->getWidth() * 0.5f, entry.baseline_offset));
+}
+
+size_t TextCache::size() const {
+  return entries_.size();
+}
+
+const TextCache::Entry &TextCache::FindEntry(const std::string &text) {
+  std::unordered_map<std::string, Entry>::const_iterator found =
+      entries_.find(text);
+  if (found != entries_.end()) {
+    return found->second;
+  }
+
+  if (!font_loaded_) {
+    font_ = ci::Font(font_name_, font_size_);
+    font_loaded_ = true;
+  }
+  if (entries_.size() >= kMaxEntries) {
+    entries_.clear();
+  }
+
+  Entry entry;
+  entry.baseline_offset = 0;
+  ci::Surface surface = ci::renderString(text, font_, ci::ColorA::white(),
+                                         &entry.baseline_offset);
+  entry.texture = ci::gl::Texture2d::create(surface);
+  return entries_.emplace(text, entry).first->second;
+}
+
+} // namespace idealgas
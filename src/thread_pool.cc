@@ -0,0 +1,93 @@
+#include <thread_pool.h>
+
+namespace idealgas {
+
+ThreadPool::ThreadPool(size_t thread_count) : next_task_(0) {
+  for (size_t i = 1; i < thread_count; i++) {
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_ready_.notify_all();
+  for (std::thread &worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::ParallelFor(size_t count,
+                             const std::function<void(size_t)> &task) {
+  std::lock_guard<std::mutex> job_lock(job_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    task_count_ = count;
+    next_task_ = 0;
+    busy_workers_ = workers_.size();
+    error_ = nullptr;
+    generation_++;
+  }
+  work_ready_.notify_all();
+
+  // The calling thread works on the job too instead of just waiting
+  RunTasks();
+
+  std::exception_ptr error;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_done_.wait(lock, [this] { return busy_workers_ == 0; });
+    task_ = nullptr;
+    error = error_;
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+size_t ThreadPool::GetThreadCount() const {
+  return workers_.size() + 1;
+}
+
+void ThreadPool::WorkerLoop() {
+  size_t seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_ready_.wait(lock, [&] {
+        return stopping_ || generation_ != seen_generation;
+      });
+      if (stopping_) {
+        return;
+      }
+      seen_generation = generation_;
+    }
+
+    RunTasks();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--busy_workers_ == 0) {
+      work_done_.notify_one();
+    }
+  }
+}
+
+void ThreadPool::RunTasks() {
+  for (size_t index = next_task_++; index < task_count_;
+       index = next_task_++) {
+    try {
+      (*task_)(index);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!error_) {
+        error_ = std::current_exception();
+      }
+    }
+  }
+}
+
+} // namespace idealgas
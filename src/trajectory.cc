@@ -0,0 +1,394 @@
+#include <trajectory.h>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace idealgas {
+
+namespace {
+
+const char kMagic[8] = {'I', 'G', 'A', 'S', 'T', 'R', 'A', 'J'};
+const uint32_t kVersion = 1;
+
+// Written as a number and compared when reading, so a trajectory from a
+// machine with the other byte order is refused instead of read as garbage
+const uint32_t kByteOrder = 0x01020304;
+
+// The columns of a frame in the order they are encoded. The first two are
+// positions and the others velocities
+const size_t kColumnCount = 4;
+
+// A rounded value has to fit in 63 bits so the change between two of them
+// still fits in 64
+const double kLargestRoundedValue = 4e18;
+
+/**
+ * The start of every trajectory file
+ */
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  double position_resolution;
+  double velocity_resolution;
+  uint64_t keyframe_interval;
+};
+
+static_assert(sizeof(FileHeader) == 40, "The trajectory header has padding");
+
+/**
+ * The start of every frame, followed by its encoded values
+ */
+struct FrameHeader {
+  uint64_t step;
+  uint64_t particle_count;
+  uint64_t encoded_size;
+  uint32_t keyframe;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(FrameHeader) == 32, "The frame header has padding");
+
+/**
+ * Appends a number 7 bits at a time, with the top bit of each byte set when
+ * more bytes follow
+ */
+void AppendVarint(std::vector<uint8_t> &bytes, uint64_t value) {
+  while (value >= 0x80) {
+    bytes.push_back((uint8_t) (value | 0x80));
+    value >>= 7;
+  }
+  bytes.push_back((uint8_t) value);
+}
+
+/**
+ * Reads a number written by AppendVarint
+ * @param position the index of its first byte, which is moved past it
+ * @throws std::invalid_argument if the bytes end in the middle of it
+ */
+uint64_t ReadVarint(const std::vector<uint8_t> &bytes, size_t &position) {
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (position == bytes.size()) {
+      break;
+    }
+    uint8_t byte = bytes[position++];
+    value |= (uint64_t) (byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return value;
+    }
+  }
+  throw std::invalid_argument("Please make sure the trajectory is complete "
+                              "and undamaged!");
+}
+
+/**
+ * Maps signed numbers to unsigned ones so that small numbers of either sign
+ * stay small: 0, -1, 1, -2, 2 become 0, 1, 2, 3, 4
+ */
+uint64_t ZigZag(int64_t value) {
+  return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value) {
+  return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+} // namespace
+
+TrajectoryWriter::TrajectoryWriter(const std::string &path,
+                                   size_t particle_count,
+                                   const TrajectoryOptions &options)
+    : options_(options) {
+  if (options_.buffer_frames == 0 || options_.keyframe_interval == 0) {
+    throw std::invalid_argument("Please make sure the trajectory buffers at "
+                                "least one frame and has keyframes!");
+  }
+  if (!(options_.position_resolution > 0) ||
+      !(options_.velocity_resolution > 0) ||
+      std::isinf(options_.position_resolution) ||
+      std::isinf(options_.velocity_resolution)) {
+    throw std::invalid_argument("Please make sure the trajectory's "
+                                "resolutions are positive!");
+  }
+
+  output_.open(path, std::ios::binary | std::ios::trunc);
+  if (!output_) {
+    throw std::runtime_error("Could not create " + path);
+  }
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byte_order = kByteOrder;
+  header.position_resolution = options_.position_resolution;
+  header.velocity_resolution = options_.velocity_resolution;
+  header.keyframe_interval = options_.keyframe_interval;
+  output_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  written_bytes_ = sizeof(header);
+
+  // Everything AddFrame copies into is allocated here, so adding frames
+  // doesn't allocate as long as the particle count doesn't grow
+  slots_.resize(options_.buffer_frames);
+  for (TrajectoryFrame &slot : slots_) {
+    slot.x.reserve(particle_count);
+    slot.y.reserve(particle_count);
+    slot.x_velocity.reserve(particle_count);
+    slot.y_velocity.reserve(particle_count);
+  }
+  previous_.reserve(particle_count * kColumnCount);
+  thread_ = std::thread(&TrajectoryWriter::Run, this);
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+  try {
+    Close();
+  } catch (...) {
+  }
+}
+
+bool TrajectoryWriter::AddFrame(const ParticleStore &particles,
+                                uint64_t step) {
+  size_t slot;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    RethrowError();
+    if (closing_) {
+      throw std::invalid_argument("Please make sure frames aren't added "
+                                  "after the trajectory is closed!");
+    }
+    if (count_ == slots_.size()) {
+      if (options_.overflow_policy == OverflowPolicy::kDrop) {
+        dropped_frames_++;
+        return false;
+      }
+      slot_freed_.wait(lock, [this]() {
+        return count_ < slots_.size() || error_;
+      });
+      RethrowError();
+    }
+    slot = (first_ + count_) % slots_.size();
+  }
+
+  // The writer thread doesn't look at a slot until it is counted, so it is
+  // filled without holding the lock
+  TrajectoryFrame &frame = slots_[slot];
+  size_t count = particles.size();
+  frame.step = step;
+  frame.x.assign(particles.GetX(), particles.GetX() + count);
+  frame.y.assign(particles.GetY(), particles.GetY() + count);
+  frame.x_velocity.assign(particles.GetXVelocity(),
+                          particles.GetXVelocity() + count);
+  frame.y_velocity.assign(particles.GetYVelocity(),
+                          particles.GetYVelocity() + count);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    count_++;
+  }
+  frame_added_.notify_one();
+  return true;
+}
+
+void TrajectoryWriter::Close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closing_ = true;
+  }
+  frame_added_.notify_one();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (output_.is_open()) {
+    output_.close();
+    if (!output_ && !error_) {
+      error_ = std::make_exception_ptr(std::runtime_error(
+          "Could not finish writing the trajectory"));
+    }
+  }
+  RethrowError();
+}
+
+uint64_t TrajectoryWriter::GetWrittenFrameCount() const {
+  return written_frames_;
+}
+
+uint64_t TrajectoryWriter::GetDroppedFrameCount() const {
+  return dropped_frames_;
+}
+
+uint64_t TrajectoryWriter::GetWrittenBytes() const {
+  return written_bytes_;
+}
+
+void TrajectoryWriter::Run() {
+  try {
+    while (true) {
+      const TrajectoryFrame *frame;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        frame_added_.wait(lock, [this]() { return count_ > 0 || closing_; });
+
+        // Closing still writes every frame that was added before
+        if (count_ == 0) {
+          return;
+        }
+        frame = &slots_[first_];
+      }
+
+      WriteFrame(*frame);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        first_ = (first_ + 1) % slots_.size();
+        count_--;
+      }
+      slot_freed_.notify_one();
+    }
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      error_ = std::current_exception();
+    }
+
+    // Wakes AddFrame if it is waiting for a slot that won't be freed now
+    slot_freed_.notify_all();
+  }
+}
+
+void TrajectoryWriter::WriteFrame(const TrajectoryFrame &frame) {
+  size_t count = frame.x.size();
+
+  // The first frame and frames after the particle count changed have
+  // nothing to be the change from
+  bool keyframe = written_frames_ % options_.keyframe_interval == 0 ||
+      previous_.size() != count * kColumnCount;
+  previous_.resize(count * kColumnCount);
+
+  const float *columns[kColumnCount] = {
+      frame.x.data(), frame.y.data(), frame.x_velocity.data(),
+      frame.y_velocity.data()};
+  encoded_.clear();
+  for (size_t column = 0; column < kColumnCount; column++) {
+    double resolution = column < 2 ? options_.position_resolution :
+        options_.velocity_resolution;
+    const float *values = columns[column];
+    int64_t *previous = previous_.data() + column * count;
+    for (size_t i = 0; i < count; i++) {
+      double scaled = values[i] / resolution;
+
+      // Also false for NaN
+      if (!(std::fabs(scaled) < kLargestRoundedValue)) {
+        throw std::invalid_argument("Please make sure every position and "
+                                    "velocity in the trajectory is finite!");
+      }
+      int64_t value = std::llround(scaled);
+      AppendVarint(encoded_, ZigZag(keyframe ? value : value - previous[i]));
+      previous[i] = value;
+    }
+  }
+
+  FrameHeader header = {frame.step, count, encoded_.size(), keyframe, 0};
+  output_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  output_.write(reinterpret_cast<const char *>(encoded_.data()),
+                (std::streamsize) encoded_.size());
+  if (!output_) {
+    throw std::runtime_error("Could not write the trajectory");
+  }
+  written_bytes_ += sizeof(header) + encoded_.size();
+  written_frames_++;
+}
+
+void TrajectoryWriter::RethrowError() {
+  if (error_) {
+    std::rethrow_exception(error_);
+  }
+}
+
+TrajectoryReader::TrajectoryReader(const std::string &path)
+    : input_(path, std::ios::binary) {
+  if (!input_) {
+    throw std::runtime_error("Could not open " + path);
+  }
+
+  FileHeader header;
+  input_.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (input_.gcount() != sizeof(header) ||
+      std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    throw std::invalid_argument("Please make sure " + path +
+                                " is a trajectory!");
+  }
+  if (header.byte_order != kByteOrder) {
+    throw std::invalid_argument("Please make sure the trajectory was "
+                                "written on a machine with the same byte "
+                                "order!");
+  }
+  if (header.version != kVersion) {
+    throw std::invalid_argument("Please make sure the trajectory is version "
+                                + std::to_string(kVersion) + "!");
+  }
+  position_resolution_ = header.position_resolution;
+  velocity_resolution_ = header.velocity_resolution;
+}
+
+bool TrajectoryReader::ReadFrame(TrajectoryFrame *frame) {
+  FrameHeader header;
+  input_.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (input_.gcount() == 0 && input_.eof()) {
+    return false;
+  }
+
+  // Every value takes at least one byte and at most ten, which also keeps
+  // a damaged count from allocating too much
+  uint64_t values = header.particle_count * kColumnCount;
+  if (input_.gcount() != sizeof(header) ||
+      header.particle_count > header.encoded_size / kColumnCount ||
+      header.encoded_size > values * 10 ||
+      (!header.keyframe && previous_.size() != values)) {
+    throw std::invalid_argument("Please make sure the trajectory is complete "
+                                "and undamaged!");
+  }
+
+  encoded_.resize(header.encoded_size);
+  input_.read(reinterpret_cast<char *>(encoded_.data()),
+              (std::streamsize) encoded_.size());
+  if ((uint64_t) input_.gcount() != header.encoded_size) {
+    throw std::invalid_argument("Please make sure the trajectory is complete "
+                                "and undamaged!");
+  }
+
+  size_t count = header.particle_count;
+  previous_.resize(values);
+  std::vector<float> *columns[kColumnCount] = {
+      &frame->x, &frame->y, &frame->x_velocity, &frame->y_velocity};
+  size_t position = 0;
+  for (size_t column = 0; column < kColumnCount; column++) {
+    double resolution = column < 2 ? position_resolution_ :
+        velocity_resolution_;
+    std::vector<float> &decoded = *columns[column];
+    decoded.resize(count);
+    int64_t *previous = previous_.data() + column * count;
+    for (size_t i = 0; i < count; i++) {
+      int64_t change = UnZigZag(ReadVarint(encoded_, position));
+      
+      // Adds without signed overflow, so a damaged change can't be 
+      // undefined behavior
+      int64_t value = header.keyframe ? change : 
+          (int64_t) ((uint64_t) previous[i] + (uint64_t) change);
+      decoded[i] = (float) (value * resolution);
+      previous[i] = value;
+    }
+  }
+  frame->step = header.step;
+  return true;
+}
+
+double TrajectoryReader::GetPositionResolution() const {
+  return position_resolution_;
+}
+
+double TrajectoryReader::GetVelocityResolution() const {
+  return velocity_resolution_;
+}
+
+} // namespace idealgas
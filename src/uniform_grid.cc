@@ -0,0 +1,133 @@
+#include <uniform_grid.h>
+#include <algorithm>
+#include <cmath>
+
+namespace idealgas {
+
+void UniformGrid::Build(const ParticleStore &particles, double x_lower_bound,
+                        double y_lower_bound, double x_upper_bound,
+                        double y_upper_bound) {
+  const float *x = particles.GetX();
+  const float *y = particles.GetY();
+
+  // Every particle's radius is in the species table, so the largest one is
+  // found without going over the particles
+  double max_radius = 0;
+  for (const Species &species : particles.GetSpecies()) {
+    max_radius = std::max(max_radius, species.radius);
+  }
+
+  // A cell has to be at least as wide as the largest diameter so that
+  // touching particles are never more than one cell apart
+  double width = x_upper_bound - x_lower_bound;
+  double height = y_upper_bound - y_lower_bound;
+  cell_size_ = 2 * max_radius;
+
+  // If that would give too many cells for the amount of particles, we make
+  // the cells bigger. Bigger cells are still correct, they just let more
+  // pairs through to the narrowphase
+  double max_cells = std::max(particles.size() * kMaxCellsPerParticle,
+                              (size_t) 1);
+  if ((width / cell_size_) * (height / cell_size_) > max_cells) {
+    cell_size_ = std::sqrt(width * height / max_cells);
+  }
+
+  columns_ = std::max((size_t) std::ceil(width / cell_size_), (size_t) 1);
+  rows_ = std::max((size_t) std::ceil(height / cell_size_), (size_t) 1);
+
+  // Counting sort of the particles by cell. First count how many particles
+  // are in each cell, then turn the counts into starting offsets, then
+  // place every particle at its offset
+  cell_start_.assign(columns_ * rows_ + 1, 0);
+  particle_cells_.resize(particles.size());
+  for (size_t i = 0; i < particles.size(); i++) {
+    size_t cell = FindCellIndex(y[i], y_lower_bound, rows_) * columns_ +
+        FindCellIndex(x[i], x_lower_bound, columns_);
+    particle_cells_[i] = cell;
+    cell_start_[cell + 1]++;
+  }
+
+  for (size_t cell = 1; cell < cell_start_.size(); cell++) {
+    cell_start_[cell] += cell_start_[cell - 1];
+  }
+
+  cell_fill_.assign(cell_start_.begin(), cell_start_.end() - 1);
+  cell_particles_.resize(particles.size());
+  for (size_t i = 0; i < particles.size(); i++) {
+    cell_particles_[cell_fill_[particle_cells_[i]]++] = i;
+  }
+}
+
+void UniformGrid::FindCandidatePairs(std::vector<ParticlePair>
+                                     &pairs) const {
+  FindCandidatePairs(0, columns_, pairs);
+}
+
+void UniformGrid::FindCandidatePairs(size_t first_column, size_t end_column,
+                                     std::vector<ParticlePair> &pairs) const {
+  pairs.clear();
+
+  // Only half of the neighbors are visited (the three cells on the right 
+  // and the one below) so that every pair of cells is only looked at once
+  const int kNeighborOffsets[4][2] = {{1, -1}, {1, 0}, {1, 1}, {0, 1}};
+
+  for (size_t row = 0; row < rows_; row++) {
+    for (size_t column = first_column; column < end_column; column++) {
+      size_t cell = row * columns_ + column;
+
+      // Pairs inside the same cell
+      for (size_t a = cell_start_[cell]; a < cell_start_[cell + 1]; a++) {
+        for (size_t b = a + 1; b < cell_start_[cell + 1]; b++) {
+          AddPair(cell_particles_[a], cell_particles_[b], pairs);
+        }
+      }
+
+      // Pairs with the neighboring cells
+      for (const int *offset : kNeighborOffsets) {
+        long neighbor_column = (long) column + offset[0];
+        long neighbor_row = (long) row + offset[1];
+        if (neighbor_column >= (long) columns_ || neighbor_row < 0 ||
+            neighbor_row >= (long) rows_) {
+          continue;
+        }
+
+        size_t neighbor = neighbor_row * columns_ + neighbor_column;
+        for (size_t a = cell_start_[cell]; a < cell_start_[cell + 1]; a++) {
+          for (size_t b = cell_start_[neighbor]; b < cell_start_[neighbor + 1];
+               b++) {
+            AddPair(cell_particles_[a], cell_particles_[b], pairs);
+          }
+        }
+      }
+    }
+  }
+}
+
+void UniformGrid::AddPair(size_t particle1, size_t particle2,
+                          std::vector<ParticlePair> &pairs) const {
+  pairs.emplace_back((uint32_t) std::min(particle1, particle2),
+                     (uint32_t) std::max(particle1, particle2));
+}
+
+size_t UniformGrid::FindCellIndex(double coordinate, double lower_bound,
+                                  size_t cells) const {
+  double index = std::floor((coordinate - lower_bound) / cell_size_);
+  if (index < 0) {
+    return 0;
+  }
+  return std::min((size_t) index, cells - 1);
+}
+
+double UniformGrid::GetCellSize() const {
+  return cell_size_;
+}
+
+size_t UniformGrid::GetColumns() const {
+  return columns_;
+}
+
+size_t UniformGrid::GetRows() const {
+  return rows_;
+}
+
+} // namespace idealgas
@@ -0,0 +1,402 @@
+#include <catch2/catch.hpp>
+#include <batch_runner.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace idealgas;
+
+TEST_CASE("Batch options are read from the command line", "[batch]") {
+  SECTION("Every option is read") {
+    BatchOptions options = ParseBatchOptions({
+        "--species", "20:5:10:red", "--species", "10:8:30", "--steps", "50",
+        "--seed", "7", "--threads", "2", "--time-step", "0.5", 
+        "--engine", "event-driven", "--collisions", "continuous", 
+        "--broadphase", "sweep", "--stats", "stats.json", 
+        "--particles", "particles.csv"});
+    
+    REQUIRE(options.species.size() == 2);
+    REQUIRE(options.species[0].count == 20);
+    REQUIRE(options.species[0].radius == 5);
+    REQUIRE(options.species[0].mass == 10);
+    REQUIRE(options.species[0].color == "red");
+    REQUIRE(options.species[1].color == "white");
+    REQUIRE(options.steps == 50);
+    REQUIRE(options.seed == 7);
+    REQUIRE(options.has_seed);
+    REQUIRE(options.thread_count == 2);
+    REQUIRE(options.time_step == 0.5);
+    REQUIRE(options.engine == Engine::kEventDriven);
+    REQUIRE(options.collision_detection == CollisionDetection::kContinuous);
+    REQUIRE(options.broadphase == Broadphase::kSortAndSweep);
+    REQUIRE(options.statistics_path == "stats.json");
+    REQUIRE(options.particles_path == "particles.csv");
+  }
+  
+  SECTION("Bad options throw an error") {
+    REQUIRE_THROWS_AS(ParseBatchOptions({}), std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "20:5"}), 
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "20:5:x"}), 
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "200:5:0"}), 
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "200:5:-10"}), 
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "10:nan:5"}), 
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "20:5:10", 
+                                         "--time-step", "inf"}), 
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "20:5:10", 
+                                         "--steps", "-3"}), 
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "20:5:10", 
+                                         "--steps", "2.5"}), 
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "20:5:10", 
+                                         "--steps", "1e30"}), 
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "20:5:10", 
+                                         "--steps", 
+                                         "99999999999999999999999"}), 
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "20:5:10", 
+                                         "--threads", "inf"}), 
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "20:5:10", 
+                                         "--engine", "fast"}), 
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "20:5:10", "--seed"}), 
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "20:5:10", "--color",
+                                         "red"}), std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "20:5:10", 
+                                         "--checkpoint-every", "10"}), 
+                      std::invalid_argument);
+  }
+  
+  SECTION("Seeds keep all 64 bits") {
+    BatchOptions options = ParseBatchOptions({
+        "--species", "20:5:10", "--seed", "18446744073709551615"});
+    REQUIRE(options.seed == 18446744073709551615ULL);
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "20:5:10", "--seed", 
+                                         "18446744073709551616"}), 
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "20:5:10", "--seed", 
+                                         "-1"}), 
+                      std::invalid_argument);
+  }
+  
+  SECTION("A resumed run doesn't need any species") {
+    BatchOptions options = ParseBatchOptions({
+        "--resume", "state.bin", "--checkpoint", "next.bin", 
+        "--checkpoint-every", "100"});
+    REQUIRE(options.species.empty());
+    REQUIRE(options.resume_path == "state.bin");
+    REQUIRE(options.checkpoint_path == "next.bin");
+    REQUIRE(options.checkpoint_interval == 100);
+  }
+  
+  SECTION("Trajectory options are read") {
+    BatchOptions options = ParseBatchOptions({
+        "--species", "20:5:10", "--trajectory", "run.traj",
+        "--trajectory-every", "5", "--trajectory-overflow", "drop"});
+    REQUIRE(options.trajectory_path == "run.traj");
+    REQUIRE(options.trajectory_interval == 5);
+    REQUIRE(options.trajectory_overflow == OverflowPolicy::kDrop);
+  
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "20:5:10",
+                                         "--trajectory-every", "0"}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--species", "20:5:10",
+                                         "--trajectory-overflow", "skip"}),
+                      std::invalid_argument);
+  }
+}
+
+TEST_CASE("Batch runs are reproducible from the seed", "[batch]") {
+  BatchOptions options = ParseBatchOptions({
+      "--species", "40:5:10:red", "--species", "20:8:30:blue", 
+      "--steps", "30", "--seed", "3"});
+  
+  BatchRunner first_runner(options);
+  BatchRunner second_runner(options);
+  first_runner.Run();
+  second_runner.Run();
+  
+  std::stringstream first_particles;
+  std::stringstream second_particles;
+  first_runner.WriteParticles(first_particles);
+  second_runner.WriteParticles(second_particles);
+  REQUIRE(first_particles.str() == second_particles.str());
+  
+  nlohmann::json statistics = first_runner.GetStatistics();
+  REQUIRE(statistics["particles"] == 60);
+  REQUIRE(statistics["steps"] == 30);
+  REQUIRE(statistics["species"].size() == 2);
+  REQUIRE(statistics["species"][0]["count"] == 40);
+  REQUIRE(statistics["species"][1]["color"] == "blue");
+  REQUIRE(statistics["kinetic_energy"].get<double>() > 0);
+}
+
+TEST_CASE("Batch statistics tell species with the same mass apart", 
+          "[batch]") {
+  BatchOptions options = ParseBatchOptions({
+      "--species", "30:5:10:red", "--species", "20:8:10:blue", 
+      "--steps", "5"});
+  BatchRunner runner(options);
+  runner.Run();
+  
+  nlohmann::json statistics = runner.GetStatistics();
+  REQUIRE(statistics["species"][0]["count"] == 30);
+  REQUIRE(statistics["species"][1]["count"] == 20);
+  
+  size_t binned = 0;
+  for (size_t count : statistics["species"][1]["histogram"]) {
+    binned += count;
+  }
+  REQUIRE(binned <= 20);
+  REQUIRE(binned > 0);
+  REQUIRE(statistics["species"][0]["kinetic_energy"].get<double>() + 
+          statistics["species"][1]["kinetic_energy"].get<double>() == 
+          Approx(statistics["kinetic_energy"].get<double>()));
+}
+
+TEST_CASE("Batch runs start the same with any amount of threads", 
+          "[batch]") {
+  BatchOptions options = ParseBatchOptions({
+      "--species", "5000:2:10:red", "--species", "3000:3:30:blue", 
+      "--seed", "9"});
+  BatchRunner single_thread(options);
+  options.thread_count = 4;
+  BatchRunner four_threads(options);
+  
+  std::stringstream single_thread_particles;
+  std::stringstream four_thread_particles;
+  single_thread.WriteParticles(single_thread_particles);
+  four_threads.WriteParticles(four_thread_particles);
+  REQUIRE(single_thread_particles.str() == four_thread_particles.str());
+  
+  // The particles move in every direction
+  const ParticleStore &particles = single_thread.GetSimulator().GetParticles();
+  size_t moving_left = 0;
+  size_t moving_up = 0;
+  for (size_t i = 0; i < particles.size(); i++) {
+    moving_left += particles.GetXVelocity()[i] < 0;
+    moving_up += particles.GetYVelocity()[i] < 0;
+  }
+  REQUIRE(moving_left > particles.size() / 3);
+  REQUIRE(moving_left < particles.size() * 2 / 3);
+  REQUIRE(moving_up > particles.size() / 3);
+  REQUIRE(moving_up < particles.size() * 2 / 3);
+}
+
+TEST_CASE("Batch runs resumed from a checkpoint end up the same", "[batch]") {
+  const std::string path = "batch_checkpoint_test.bin";
+  BatchOptions options = ParseBatchOptions({
+      "--species", "40:5:10:red", "--species", "20:8:30:blue", 
+      "--steps", "30", "--seed", "5000000005"});
+  BatchRunner whole_runner(options);
+  whole_runner.Run();
+  
+  // Stops after 20 steps, with checkpoints at 10 and 20
+  options.steps = 20;
+  options.checkpoint_path = path;
+  options.checkpoint_interval = 10;
+  BatchRunner first_half(options);
+  first_half.Run();
+  
+  BatchOptions resume_options = ParseBatchOptions({
+      "--resume", path, "--steps", "10"});
+  BatchRunner second_half(resume_options);
+  second_half.Run();
+  std::remove(path.c_str());
+  
+  std::stringstream whole_particles;
+  std::stringstream resumed_particles;
+  whole_runner.WriteParticles(whole_particles);
+  second_half.WriteParticles(resumed_particles);
+  REQUIRE(whole_particles.str() == resumed_particles.str());
+  
+  nlohmann::json statistics = second_half.GetStatistics();
+  REQUIRE(statistics["steps"] == 10);
+  REQUIRE(statistics["total_steps"] == 30);
+  REQUIRE(statistics["seed"] == 5000000005ULL);
+  REQUIRE(statistics["species"].size() == 2);
+  REQUIRE(statistics["species"][0]["count"] == 40);
+  REQUIRE(statistics["species"][1]["color"] == "blue");
+}
+
+TEST_CASE("Batch options are read from JSON scenarios", "[batch]") {
+  nlohmann::json scenario = {
+      {"species", {
+          {{"count", 20}, {"radius", 5}, {"mass", 10}, {"color", "red"}},
+          {{"count", 10}, {"radius", 8}, {"mass", 30}}}},
+      {"container", {{"left", 100}, {"top", 50}, {"right", 400}, 
+                     {"bottom", 300}}},
+      {"seed", 7},
+      {"steps", 50},
+      {"threads", 2},
+      {"time_step", 0.5},
+      {"engine", "event-driven"},
+      {"collisions", "continuous"},
+      {"broadphase", "sweep"},
+      {"placement", "non-overlapping"},
+      {"output", {{"stats", "stats.json"}, {"checkpoint", "state.bin"},
+                  {"checkpoint_every", 25}}}};
+  
+  SECTION("Every setting is read") {
+    BatchOptions options = ParseScenario(scenario);
+    REQUIRE(options.species.size() == 2);
+    REQUIRE(options.species[0].count == 20);
+    REQUIRE(options.species[0].color == "red");
+    REQUIRE(options.species[1].mass == 30);
+    REQUIRE(options.species[1].color == "white");
+    REQUIRE(options.container.x_lower_bound == 100);
+    REQUIRE(options.container.y_upper_bound == 300);
+    REQUIRE(options.seed == 7);
+    REQUIRE(options.has_seed);
+    REQUIRE(options.steps == 50);
+    
+    nlohmann::json large_seed = scenario;
+    large_seed["seed"] = 5000000001ULL;
+    REQUIRE(ParseScenario(large_seed).seed == 5000000001ULL);
+    REQUIRE(options.thread_count == 2);
+    REQUIRE(options.time_step == 0.5);
+    REQUIRE(options.engine == Engine::kEventDriven);
+    REQUIRE(options.collision_detection == CollisionDetection::kContinuous);
+    REQUIRE(options.broadphase == Broadphase::kSortAndSweep);
+    REQUIRE(options.placement == Placement::kNonOverlapping);
+    REQUIRE(options.statistics_path == "stats.json");
+    REQUIRE(options.particles_path.empty());
+    REQUIRE(options.checkpoint_path == "state.bin");
+    REQUIRE(options.checkpoint_interval == 25);
+  }
+  
+  SECTION("Settings that are left out keep their defaults") {
+    BatchOptions options = ParseScenario({
+        {"species", {{{"count", 20}, {"radius", 5}, {"mass", 10}}}}});
+    BatchOptions defaults;
+    REQUIRE_FALSE(options.has_seed);
+    REQUIRE(options.steps == defaults.steps);
+    REQUIRE(options.engine == defaults.engine);
+    REQUIRE(options.container.x_upper_bound == 
+            defaults.container.x_upper_bound);
+  }
+  
+  SECTION("Bad scenarios throw an error") {
+    nlohmann::json misspelled = scenario;
+    misspelled["time-step"] = 1;
+    REQUIRE_THROWS_AS(ParseScenario(misspelled), std::invalid_argument);
+    
+    nlohmann::json negative = scenario;
+    negative["species"][0]["count"] = -5;
+    REQUIRE_THROWS_AS(ParseScenario(negative), std::invalid_argument);
+    
+    nlohmann::json negative_seed = scenario;
+    negative_seed["seed"] = -1;
+    REQUIRE_THROWS_AS(ParseScenario(negative_seed), std::invalid_argument);
+    
+    nlohmann::json wrong_type = scenario;
+    wrong_type["seed"] = "seven";
+    REQUIRE_THROWS_AS(ParseScenario(wrong_type), std::invalid_argument);
+    
+    nlohmann::json unknown_engine = scenario;
+    unknown_engine["engine"] = "fast";
+    REQUIRE_THROWS_AS(ParseScenario(unknown_engine), std::invalid_argument);
+    
+    nlohmann::json no_species = scenario;
+    no_species.erase("species");
+    REQUIRE_THROWS_AS(ParseScenario(no_species), std::invalid_argument);
+    
+    nlohmann::json narrow = scenario;
+    narrow["container"]["right"] = 101;
+    REQUIRE_THROWS_AS(ParseScenario(narrow), std::invalid_argument);
+    
+    nlohmann::json too_big = scenario;
+    too_big["species"][1]["radius"] = 130;
+    REQUIRE_THROWS_AS(ParseScenario(too_big), std::invalid_argument);
+    
+    nlohmann::json no_radius = scenario;
+    no_radius["species"][0]["radius"] = 0;
+    REQUIRE_THROWS_AS(ParseScenario(no_radius), std::invalid_argument);
+    
+    nlohmann::json negative_mass = scenario;
+    negative_mass["species"][0]["mass"] = -10;
+    REQUIRE_THROWS_AS(ParseScenario(negative_mass), std::invalid_argument);
+    
+    nlohmann::json no_mass = scenario;
+    no_mass["species"][1]["mass"] = 0;
+    REQUIRE_THROWS_AS(ParseScenario(no_mass), std::invalid_argument);
+  }
+  
+  SECTION("Scenario files are read from the command line and can be "
+          "changed by the other options wherever they are") {
+    const std::string path = "scenario_test.json";
+    std::ofstream(path) << scenario.dump(2);
+    BatchOptions options = ParseBatchOptions({
+        "--seed", "3", "--scenario", path, "--steps", "80", 
+        "--species", "5:4:20"});
+    REQUIRE_THROWS_AS(ParseBatchOptions({"--scenario", path, 
+                                         "--scenario", path}), 
+                      std::invalid_argument);
+    std::remove(path.c_str());
+    
+    REQUIRE(options.species.size() == 3);
+    REQUIRE(options.engine == Engine::kEventDriven);
+    REQUIRE(options.seed == 3);
+    REQUIRE(options.steps == 80);
+    
+    REQUIRE_THROWS_AS(LoadScenario(path), std::runtime_error);
+    std::ofstream(path) << "{\"species\": [";
+    REQUIRE_THROWS_AS(LoadScenario(path), std::invalid_argument);
+    std::remove(path.c_str());
+  }
+  
+  SECTION("Batch runs keep the particles in the scenario's container") {
+    scenario["engine"] = "time-stepped";
+    scenario["collisions"] = "discrete";
+    scenario.erase("output");
+    BatchRunner runner(ParseScenario(scenario));
+    runner.Run();
+    
+    const Container &container = runner.GetSimulator().GetContainer();
+    REQUIRE(container.x_upper_bound == 400);
+    bool inside = true;
+    for (const Particle &particle : runner.GetSimulator().GetParticles()) {
+      inside &= particle.GetPosition().x > 100 && 
+          particle.GetPosition().x < 400 &&
+          particle.GetPosition().y > 50 && particle.GetPosition().y < 300;
+    }
+    REQUIRE(inside);
+  }
+}
+
+TEST_CASE("Batch runs stream their trajectory", "[batch]") {
+  const std::string path = "batch_trajectory_test.bin";
+  BatchOptions options = ParseBatchOptions({
+      "--species", "40:5:10:red", "--steps", "20", "--seed", "5",
+      "--trajectory", path, "--trajectory-every", "5"});
+  BatchRunner runner(options);
+  runner.Run();
+  
+  nlohmann::json statistics = runner.GetStatistics();
+  REQUIRE(statistics["trajectory"]["frames"] == 4);
+  REQUIRE(statistics["trajectory"]["dropped"] == 0);
+  
+  // The last frame is the final state
+  TrajectoryReader reader(path);
+  TrajectoryFrame frame;
+  uint64_t last_step = 0;
+  while (reader.ReadFrame(&frame)) {
+    REQUIRE(frame.step % 5 == 0);
+    last_step = frame.step;
+  }
+  std::remove(path.c_str());
+  REQUIRE(last_step == 20);
+  const ParticleStore &particles = runner.GetSimulator().GetParticles();
+  REQUIRE(std::fabs(frame.x[0] - particles.GetX()[0]) <= 
+          reader.GetPositionResolution());
+}
@@ -0,0 +1,152 @@
+#include <catch2/catch.hpp>
+#include <checkpoint.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+
+using namespace idealgas;
+
+namespace {
+
+/**
+ * Checks that two simulators have exactly the same particles and species
+ */
+void RequireSameParticles(const ParticleSimulator &first,
+                          const ParticleSimulator &second) {
+  const ParticleStore &first_particles = first.GetParticles();
+  const ParticleStore &second_particles = second.GetParticles();
+  REQUIRE(first_particles.size() == second_particles.size());
+  REQUIRE(first_particles.GetSpecies().size() ==
+          second_particles.GetSpecies().size());
+  for (size_t s = 0; s < first_particles.GetSpecies().size(); s++) {
+    REQUIRE(first_particles.GetSpecies()[s].radius ==
+            second_particles.GetSpecies()[s].radius);
+    REQUIRE(first_particles.GetSpecies()[s].mass ==
+            second_particles.GetSpecies()[s].mass);
+    REQUIRE(first_particles.GetSpecies()[s].color ==
+            second_particles.GetSpecies()[s].color);
+  }
+
+  bool same = true;
+  for (size_t i = 0; i < first_particles.size(); i++) {
+    same &= first_particles.GetPosition(i) == second_particles.GetPosition(i);
+    same &= first_particles.GetVelocity(i) == second_particles.GetVelocity(i);
+    same &= first_particles.GetSpeciesIndex(i) ==
+        second_particles.GetSpeciesIndex(i);
+  }
+  REQUIRE(same);
+}
+
+} // namespace
+
+TEST_CASE("Checkpoints restore the whole simulation", "[checkpoint]") {
+  const std::string path = "checkpoint_test.bin";
+  ParticleSimulator particle_simulator;
+  particle_simulator.SetSeed(11);
+  particle_simulator.SetTimeStep(0.5);
+  particle_simulator.SetMaxSubsteps(3);
+  particle_simulator.SetBroadphase(Broadphase::kSortAndSweep);
+  particle_simulator.SetContainer({50, 40, 650, 500});
+  particle_simulator.AddParticles(80, 6, 10, "red");
+  particle_simulator.AddParticles(30, 10, 40, "blue");
+  particle_simulator.Advance(10.25);
+  for (size_t step = 0; step < 20; step++) {
+    particle_simulator.Update();
+  }
+  particle_simulator.SaveCheckpoint(path);
+
+  ParticleSimulator restored;
+  restored.LoadCheckpoint(path);
+  std::remove(path.c_str());
+
+  SECTION("The particles, species, random state and settings come back") {
+    RequireSameParticles(particle_simulator, restored);
+    REQUIRE(restored.GetSeed() == 11);
+    REQUIRE(restored.GetStepCount() == 23);
+    REQUIRE(restored.GetTimeStep() == 0.5);
+    REQUIRE(restored.GetMaxSubsteps() == 3);
+    REQUIRE(restored.GetBroadphase() == Broadphase::kSortAndSweep);
+    REQUIRE(restored.GetEngine() == Engine::kTimeStepped);
+    REQUIRE(restored.GetContainer().x_lower_bound == 50);
+    REQUIRE(restored.GetContainer().y_upper_bound == 500);
+  }
+
+  SECTION("The restored simulation carries on exactly like the original") {
+    for (size_t step = 0; step < 50; step++) {
+      particle_simulator.Update();
+      restored.Update();
+    }
+
+    // The leftover time and the random numbers carry over too
+    REQUIRE(particle_simulator.Advance(0.25) == restored.Advance(0.25));
+    particle_simulator.AddParticles(5, 6, 10, "red");
+    restored.AddParticles(5, 6, 10, "red");
+    RequireSameParticles(particle_simulator, restored);
+    REQUIRE(restored.GetStepCount() == particle_simulator.GetStepCount());
+  }
+}
+
+TEST_CASE("Bad checkpoints are refused", "[checkpoint]") {
+  const std::string path = "checkpoint_test.bin";
+  ParticleSimulator particle_simulator;
+  particle_simulator.SetSeed(2);
+  particle_simulator.AddParticles(50, 6, 10, "red");
+  particle_simulator.SaveCheckpoint(path);
+
+  std::string contents;
+  {
+    std::ifstream input(path, std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(input),
+                    std::istreambuf_iterator<char>());
+  }
+
+  ParticleSimulator restored;
+  restored.AddParticles(3, 6, 10, "green");
+
+  SECTION("A missing file can't be read") {
+    std::remove(path.c_str());
+    REQUIRE_THROWS_AS(restored.LoadCheckpoint(path), std::runtime_error);
+  }
+
+  SECTION("A file cut short is refused") {
+    std::ofstream(path, std::ios::binary) << contents.substr(
+        0, contents.size() - 4);
+    REQUIRE_THROWS_AS(restored.LoadCheckpoint(path), std::invalid_argument);
+  }
+
+  SECTION("A file that isn't a checkpoint is refused") {
+    std::ofstream(path, std::ios::binary) << "x,y\n1,2\n";
+    REQUIRE_THROWS_AS(restored.LoadCheckpoint(path), std::invalid_argument);
+  }
+
+  SECTION("A checkpoint of another version is refused") {
+    contents[8]++;
+    std::ofstream(path, std::ios::binary) << contents;
+    REQUIRE_THROWS_AS(restored.LoadCheckpoint(path), std::invalid_argument);
+  }
+
+  SECTION("A checkpoint with a species that isn't at least 0.1 is refused") {
+    // The species table starts on the first section boundary after the 
+    // 200 byte header, with the radius and then the mass of each species
+    const size_t kSpeciesOffset = 256;
+    const double kNaN = std::numeric_limits<double>::quiet_NaN();
+    const double kNoMass = 0;
+    std::string no_radius = contents;
+    std::memcpy(&no_radius[kSpeciesOffset], &kNaN, sizeof(kNaN));
+    std::ofstream(path, std::ios::binary) << no_radius;
+    REQUIRE_THROWS_AS(restored.LoadCheckpoint(path), std::invalid_argument);
+    
+    std::string no_mass = contents;
+    std::memcpy(&no_mass[kSpeciesOffset + sizeof(double)], &kNoMass, 
+                sizeof(kNoMass));
+    std::ofstream(path, std::ios::binary) << no_mass;
+    REQUIRE_THROWS_AS(restored.LoadCheckpoint(path), std::invalid_argument);
+  }
+
+  // A refused checkpoint leaves the simulation as it was
+  REQUIRE(restored.GetParticles().size() == 3);
+  REQUIRE(restored.GetParticles().GetColor(0) == "green");
+  std::remove(path.c_str());
+}
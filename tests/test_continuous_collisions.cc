@@ -0,0 +1,140 @@
+#include <catch2/catch.hpp>
+#include <continuous_collisions.h>
+#include <particle_simulator.h>
+#include <random>
+
+using namespace idealgas;
+using glm::vec2;
+
+namespace {
+
+const double kXLower = ParticleSimulator::kXLowerBound;
+const double kYLower = ParticleSimulator::kYLowerBound;
+const double kXUpper = ParticleSimulator::kXUpperBound;
+const double kYUpper = ParticleSimulator::kYUpperBound;
+
+} // namespace
+
+TEST_CASE("Continuous collisions stop fast particles from tunneling",
+          "[continuous]") {
+  ParticleStore particles;
+  ContinuousCollisions continuous_collisions;
+  
+  SECTION("A fast particle hits a particle it would have jumped over") {
+    particles.AddParticle(vec2(500, 500), vec2(100, 0), 5, 10, "red");
+    particles.AddParticle(vec2(560, 500), vec2(0, 0), 5, 10, "red");
+    
+    REQUIRE(continuous_collisions.Step(particles, 1, kXLower, kYLower, 
+                                       kXUpper, kYUpper) == 1);
+    REQUIRE(continuous_collisions.GetCandidatePairCount() == 1);
+    REQUIRE(particles.GetVelocity(0).x == Approx(0).margin(1e-4));
+    REQUIRE(particles.GetVelocity(1).x == Approx(100));
+    REQUIRE(particles.GetPosition(0).x == Approx(550));
+    REQUIRE(particles.GetPosition(1).x == Approx(610));
+  }
+  
+  SECTION("A particle that bounces off a wall hits the particle behind it") {
+    particles.AddParticle(vec2(kXUpper - 50, 400), vec2(200, 0), 5, 10, 
+                          "red");
+    particles.AddParticle(vec2(kXUpper - 90, 400), vec2(0, 0), 5, 10, 
+                          "blue");
+    
+    // The first particle reaches the wall after 0.225 and comes back into 
+    // the second one at 0.6, which wasn't on its path before the bounce
+    REQUIRE(continuous_collisions.Step(particles, 1, kXLower, kYLower, 
+                                       kXUpper, kYUpper) == 1);
+    REQUIRE(continuous_collisions.GetWallCollisionCount() == 1);
+    REQUIRE(particles.GetVelocity(0).x == Approx(0).margin(1e-3));
+    REQUIRE(particles.GetVelocity(1).x == Approx(-200));
+    REQUIRE(particles.GetPosition(0).x == Approx(kXUpper - 80));
+    REQUIRE(particles.GetPosition(1).x == Approx(kXUpper - 170));
+  }
+  
+  SECTION("Particles that never meet in the step aren't changed") {
+    particles.AddParticle(vec2(500, 500), vec2(2, 0), 5, 10, "red");
+    particles.AddParticle(vec2(600, 500), vec2(-2, 0), 5, 10, "red");
+    
+    REQUIRE(continuous_collisions.Step(particles, 1, kXLower, kYLower, 
+                                       kXUpper, kYUpper) == 0);
+    REQUIRE(continuous_collisions.GetCandidatePairCount() == 0);
+    REQUIRE(particles.GetPosition(0) == vec2(502, 500));
+    REQUIRE(particles.GetPosition(1) == vec2(598, 500));
+  }
+  
+  SECTION("A fast particle bounces off the walls instead of leaving") {
+    particles.AddParticle(vec2(900, 400), vec2(1000, 700), 5, 10, "red");
+    
+    for (size_t step = 0; step < 10; step++) {
+      continuous_collisions.Step(particles, 1, kXLower, kYLower, kXUpper, 
+                                 kYUpper);
+      vec2 position = particles.GetPosition(0);
+      REQUIRE(position.x >= kXLower + 5 - 1e-3);
+      REQUIRE(position.x <= kXUpper - 5 + 1e-3);
+      REQUIRE(position.y >= kYLower + 5 - 1e-3);
+      REQUIRE(position.y <= kYUpper - 5 + 1e-3);
+    }
+    REQUIRE(glm::length(particles.GetVelocity(0)) == 
+        Approx(glm::length(vec2(1000, 700))));
+  }
+}
+
+TEST_CASE("Continuous collisions keep a hot gas physical", "[continuous]") {
+  std::mt19937 mt(5);
+  std::uniform_real_distribution<float> velocity_distribution(-60, 60);
+  std::uniform_real_distribution<double> mass_distribution(1, 50);
+  
+  ParticleStore particles;
+  for (size_t row = 0; row < 15; row++) {
+    for (size_t column = 0; column < 20; column++) {
+      particles.AddParticle(vec2(kXLower + 20 + column * 40.0, 
+                                 kYLower + 20 + row * 40.0),
+                            vec2(velocity_distribution(mt),
+                                 velocity_distribution(mt)),
+                            5, mass_distribution(mt), "red");
+    }
+  }
+  
+  double energy = 0;
+  for (size_t i = 0; i < particles.size(); i++) {
+    vec2 velocity = particles.GetVelocity(i);
+    energy += 0.5 * particles.GetMass(i) * glm::dot(velocity, velocity);
+  }
+  
+  ContinuousCollisions continuous_collisions;
+  size_t collisions = 0;
+  for (size_t step = 0; step < 50; step++) {
+    collisions += continuous_collisions.Step(particles, 1, kXLower, kYLower, 
+                                             kXUpper, kYUpper);
+  }
+  REQUIRE(collisions > 0);
+  
+  double new_energy = 0;
+  for (size_t i = 0; i < particles.size(); i++) {
+    vec2 velocity = particles.GetVelocity(i);
+    new_energy += 0.5 * particles.GetMass(i) * glm::dot(velocity, velocity);
+    
+    vec2 position = particles.GetPosition(i);
+    REQUIRE(position.x >= kXLower + 5 - 1e-2);
+    REQUIRE(position.x <= kXUpper - 5 + 1e-2);
+    REQUIRE(position.y >= kYLower + 5 - 1e-2);
+    REQUIRE(position.y <= kYUpper - 5 + 1e-2);
+  }
+  REQUIRE(new_energy == Approx(energy).epsilon(1e-4));
+}
+
+TEST_CASE("Simulator allows fast particles with continuous collisions",
+          "[continuous]") {
+  ParticleSimulator simulator;
+  REQUIRE_THROWS_AS(simulator.AddParticles(1, 5, 10, "red", 500, 500, 100,
+                                           0), std::invalid_argument);
+  
+  simulator.SetCollisionDetection(CollisionDetection::kContinuous);
+  REQUIRE(simulator.GetCollisionDetection() == 
+      CollisionDetection::kContinuous);
+  simulator.AddParticles(1, 5, 10, "red", 500, 500, 100, 0);
+  simulator.AddParticles(1, 5, 10, "red", 560, 500, -1, 0);
+  
+  simulator.Update();
+  REQUIRE(simulator.GetParticles().GetVelocity(0).x == Approx(-1));
+  REQUIRE(simulator.GetParticles().GetVelocity(1).x == Approx(100));
+}
@@ -0,0 +1,50 @@
+#include <catch2/catch.hpp>
+#include <counter_rng.h>
+#include <set>
+
+using namespace idealgas;
+
+TEST_CASE("The counter based generator is reproducible", "[random]") {
+  CounterRng random(42);
+  CounterRng same_seed(42);
+  CounterRng other_seed(43);
+  
+  SECTION("The same seed and counter give the same number") {
+    for (uint64_t counter = 0; counter < 100; counter++) {
+      REQUIRE(random.GetBits(counter) == same_seed.GetBits(counter));
+    }
+  }
+  
+  SECTION("Numbers can be made in any order") {
+    uint64_t last = random.GetBits(99);
+    for (uint64_t counter = 0; counter < 99; counter++) {
+      random.GetBits(counter);
+    }
+    REQUIRE(random.GetBits(99) == last);
+  }
+  
+  SECTION("Different seeds and counters give different numbers") {
+    std::set<uint64_t> numbers;
+    for (uint64_t counter = 0; counter < 1000; counter++) {
+      numbers.insert(random.GetBits(counter));
+      numbers.insert(other_seed.GetBits(counter));
+    }
+    REQUIRE(numbers.size() == 2000);
+  }
+}
+
+TEST_CASE("Uniform numbers stay in their range", "[random]") {
+  CounterRng random(7);
+  double sum = 0;
+  const size_t kCount = 10000;
+  for (uint64_t counter = 0; counter < kCount; counter++) {
+    double number = random.GetUniform(counter, -2, 3);
+    REQUIRE(number >= -2);
+    REQUIRE(number < 3);
+    sum += number;
+  }
+  
+  // The mean of 10000 uniform numbers is within a few hundredths of the 
+  // middle of the range
+  REQUIRE(sum / kCount == Approx(0.5).margin(0.1));
+}
@@ -0,0 +1,147 @@
+#include <catch2/catch.hpp>
+#include <event_driven_engine.h>
+#include <particle_simulator.h>
+#include <random>
+
+using namespace idealgas;
+using glm::vec2;
+
+namespace {
+
+const double kXLower = ParticleSimulator::kXLowerBound;
+const double kYLower = ParticleSimulator::kYLowerBound;
+const double kXUpper = ParticleSimulator::kXUpperBound;
+const double kYUpper = ParticleSimulator::kYUpperBound;
+
+double FindKineticEnergy(const ParticleStore &particles) {
+  double energy = 0;
+  for (size_t i = 0; i < particles.size(); i++) {
+    vec2 velocity = particles.GetVelocity(i);
+    energy += 0.5 * particles.GetMass(i) * glm::dot(velocity, velocity);
+  }
+  return energy;
+}
+
+} // namespace
+
+TEST_CASE("Event driven engine collides particles at the exact time",
+          "[event driven]") {
+  ParticleStore particles;
+  EventDrivenEngine engine;
+  
+  SECTION("Equal masses swap velocities when they hit head on") {
+    particles.AddParticle(vec2(500, 500), vec2(2, 0), 10, 10, "red");
+    particles.AddParticle(vec2(540, 500), vec2(-2, 0), 10, 10, "red");
+    engine.Reset(particles, kXLower, kYLower, kXUpper, kYUpper);
+    
+    // They touch after 5 units of time and move back for the other 5
+    engine.Advance(10, particles);
+    REQUIRE(engine.GetTime() == Approx(10));
+    REQUIRE(engine.GetParticleCollisionCount() == 1);
+    REQUIRE(particles.GetVelocity(0) == vec2(-2, 0));
+    REQUIRE(particles.GetVelocity(1) == vec2(2, 0));
+    REQUIRE(particles.GetPosition(0).x == Approx(500));
+    REQUIRE(particles.GetPosition(1).x == Approx(540));
+  }
+  
+  SECTION("A fast particle hits a particle in its way instead of tunneling") {
+    particles.AddParticle(vec2(500, 500), vec2(100, 0), 5, 10, "red");
+    particles.AddParticle(vec2(560, 500), vec2(0, 0), 5, 10, "red");
+    engine.Reset(particles, kXLower, kYLower, kXUpper, kYUpper);
+    
+    engine.Advance(1, particles);
+    REQUIRE(engine.GetParticleCollisionCount() == 1);
+    REQUIRE(particles.GetVelocity(0).x == Approx(0).margin(1e-4));
+    REQUIRE(particles.GetVelocity(1).x == Approx(100));
+    REQUIRE(particles.GetPosition(0).x == Approx(550));
+    REQUIRE(particles.GetPosition(1).x == Approx(610));
+  }
+  
+  SECTION("A fast particle bounces off the walls instead of leaving") {
+    particles.AddParticle(vec2(900, 400), vec2(1000, 700), 5, 10, "red");
+    engine.Reset(particles, kXLower, kYLower, kXUpper, kYUpper);
+    
+    for (size_t step = 0; step < 10; step++) {
+      engine.Advance(1, particles);
+      vec2 position = particles.GetPosition(0);
+      REQUIRE(position.x >= kXLower + 5 - 1e-3);
+      REQUIRE(position.x <= kXUpper - 5 + 1e-3);
+      REQUIRE(position.y >= kYLower + 5 - 1e-3);
+      REQUIRE(position.y <= kYUpper - 5 + 1e-3);
+    }
+    REQUIRE(engine.GetWallCollisionCount() > 10);
+    REQUIRE(glm::length(particles.GetVelocity(0)) == 
+        Approx(glm::length(vec2(1000, 700))));
+  }
+}
+
+TEST_CASE("Event driven engine keeps a gas physical", "[event driven]") {
+  std::mt19937 mt(11);
+  std::uniform_real_distribution<float> velocity_distribution(-20, 20);
+  std::uniform_real_distribution<double> mass_distribution(1, 50);
+  
+  // Particles on a lattice so none of them overlap at the start
+  ParticleStore particles;
+  for (size_t row = 0; row < 15; row++) {
+    for (size_t column = 0; column < 20; column++) {
+      particles.AddParticle(vec2(kXLower + 20 + column * 40.0, 
+                                 kYLower + 20 + row * 40.0),
+                            vec2(velocity_distribution(mt),
+                                 velocity_distribution(mt)),
+                            column % 2 == 0 ? 5 : 8, mass_distribution(mt),
+                            "red");
+    }
+  }
+  
+  double energy = FindKineticEnergy(particles);
+  EventDrivenEngine engine;
+  engine.Reset(particles, kXLower, kYLower, kXUpper, kYUpper);
+  for (size_t step = 0; step < 50; step++) {
+    engine.Advance(1, particles);
+  }
+  
+  REQUIRE(engine.GetParticleCollisionCount() > 0);
+  REQUIRE(FindKineticEnergy(particles) == Approx(energy).epsilon(1e-4));
+  
+  for (size_t i = 0; i < particles.size(); i++) {
+    for (size_t j = i + 1; j < particles.size(); j++) {
+      double distance = glm::distance(particles.GetPosition(i),
+                                      particles.GetPosition(j));
+      REQUIRE(distance >= particles.GetRadius(i) + particles.GetRadius(j) - 
+          1e-2);
+    }
+  }
+}
+
+TEST_CASE("Simulator runs the event driven engine", "[event driven]") {
+  ParticleSimulator simulator;
+  
+  SECTION("Fast particles can only be added to the event driven engine") {
+    REQUIRE_THROWS_AS(simulator.AddParticles(1, 5, 10, "red", 600, 400, 50, 
+                                             0), std::invalid_argument);
+    
+    simulator.SetEngine(Engine::kEventDriven);
+    REQUIRE(simulator.GetEngine() == Engine::kEventDriven);
+    REQUIRE_NOTHROW(simulator.AddParticles(1, 5, 10, "red", 600, 400, 50, 
+                                           0));
+  }
+  
+  SECTION("Each update advances by one unit of time") {
+    simulator.SetEngine(Engine::kEventDriven);
+    simulator.AddParticles(1, 10, 10, "red", 500, 500, 2, 0);
+    simulator.AddParticles(1, 10, 10, "red", 540, 500, -2, 0);
+    for (size_t step = 0; step < 10; step++) {
+      simulator.Update();
+    }
+    
+    REQUIRE(simulator.GetParticles().GetVelocity(0) == vec2(-2, 0));
+    REQUIRE(simulator.GetParticles().GetPosition(0).x == Approx(500));
+    
+    SECTION("Particles added later are picked up by the engine") {
+      simulator.AddParticles(1, 10, 10, "red", 800, 500, 3, 0);
+      simulator.Update();
+      REQUIRE(simulator.GetParticles().GetPosition(2).x == Approx(803));
+      REQUIRE(simulator.GetParticles().GetPosition(0).x == Approx(498));
+    }
+  }
+}
@@ -20,8 +20,8 @@ TEST_CASE("Particles fall into the correct speed ranges") {
   particle_simulator.AddParticles(25, 50, 30, "blue",
                                   600, 90, 15, 0);
   
-  Histogram red_histogram(10);
-  Histogram blue_histogram(30);
+  Histogram red_histogram(0, 10);
+  Histogram blue_histogram(1, 30);
   
   std::vector<Particle> particles = particle_simulator.GetParticles();
 
@@ -118,4 +118,202 @@ TEST_CASE("Particles fall into the correct speed ranges") {
       REQUIRE(blue_histogram.GetBins()[3] != 40);
     }
   }
-}
\ No newline at end of file
+  
+  SECTION("Filling the bins straight from the simulator's particles gives "
+          "the same bins as filtering them by mass first") {
+    red_histogram.FillBins(red_histogram.FindAllParticlesWithMass(particles));
+    std::vector<size_t> filtered_bins = red_histogram.GetBins();
+    
+    red_histogram.FillBins(particle_simulator.GetParticles());
+    REQUIRE(red_histogram.GetBins() == filtered_bins);
+  }
+}
+
+TEST_CASE("Filling every histogram in one pass matches filling them one at "
+          "a time") {
+  ParticleSimulator particle_simulator;
+  particle_simulator.SetSeed(7);
+  particle_simulator.AddParticles(300, 5, 10, "red");
+  particle_simulator.AddParticles(200, 8, 30, "blue");
+  particle_simulator.AddParticles(100, 12, 90, "green");
+  
+  std::vector<Histogram> histograms = {Histogram(0, 10), Histogram(1, 30), 
+                                       Histogram(2, 90), Histogram(3, 50)};
+  Histogram::FillBins(particle_simulator.GetParticles(), histograms);
+  
+  for (const Histogram &histogram : histograms) {
+    Histogram single(histogram.GetSpecies(), histogram.GetMass());
+    single.FillBins(particle_simulator.GetParticles());
+    REQUIRE(histogram.GetBins() == single.GetBins());
+    REQUIRE(histogram.GetParticleCount() == single.GetParticleCount());
+    REQUIRE(histogram.GetColor() == single.GetColor());
+  }
+  REQUIRE(histograms[1].GetParticleCount() == 200);
+  REQUIRE(histograms[1].GetColor() == "blue");
+  REQUIRE(histograms[3].GetParticleCount() == 0);
+  
+  SECTION("Filling again replaces the old counts") {
+    std::vector<size_t> bins = histograms[0].GetBins();
+    Histogram::FillBins(particle_simulator.GetParticles(), histograms);
+    REQUIRE(histograms[0].GetBins() == bins);
+    REQUIRE(histograms[0].GetParticleCount() == 300);
+  }
+}
+
+TEST_CASE("Species with the same mass get their own histograms") {
+  ParticleStore particles;
+  particles.AddParticles(30, 5, 10, "red");
+  particles.AddParticles(20, 8, 10, "blue");
+  std::vector<Histogram> histograms = {Histogram(0, 10), Histogram(1, 10)};
+  
+  Histogram::FillBins(particles, histograms);
+  REQUIRE(histograms[0].GetParticleCount() == 30);
+  REQUIRE(histograms[0].GetColor() == "red");
+  REQUIRE(histograms[1].GetParticleCount() == 20);
+  REQUIRE(histograms[1].GetColor() == "blue");
+  
+  std::vector<SpeedChange> added = {{50, kNoSpeed, 2}};
+  particles.AddParticle(glm::vec2(500, 500), glm::vec2(2, 0), 1);
+  Histogram::ApplySpeedChanges(particles, added, histograms);
+  REQUIRE(histograms[0].GetParticleCount() == 30);
+  REQUIRE(histograms[1].GetParticleCount() == 21);
+}
+
+TEST_CASE("Every species finds its histogram, however many there are") {
+  ParticleStore particles;
+  for (size_t s = 0; s < 100; s++) {
+    particles.AddParticle(glm::vec2(500, 500), glm::vec2(s % 40, 0), 5, 
+                          10 + s, "red");
+  }
+  std::vector<Histogram> histograms = {Histogram(90, 100), Histogram(3, 13),
+                                       Histogram(70, 80)};
+  
+  Histogram::FillBins(particles, histograms);
+  for (const Histogram &histogram : histograms) {
+    Histogram single(histogram.GetSpecies(), histogram.GetMass());
+    single.FillBins(particles);
+    REQUIRE(histogram.GetParticleCount() == 1);
+    REQUIRE(histogram.GetBins() == single.GetBins());
+  }
+  REQUIRE(histograms[0].GetBins()[2] == 1);
+}
+
+TEST_CASE("Speeds on the edge of a bin go in the higher bin") {
+  ParticleStore particles;
+  particles.AddParticle(glm::vec2(500, 500), glm::vec2(5, 0), 5, 10, "red");
+  particles.AddParticle(glm::vec2(600, 500), glm::vec2(0, 45), 5, 10, "red");
+  particles.AddParticle(glm::vec2(700, 500), glm::vec2(50, 0), 5, 10, "red");
+  particles.AddParticle(glm::vec2(800, 500), glm::vec2(0, 0), 5, 10, "red");
+  
+  Histogram histogram(0, 10);
+  histogram.FillBins(particles);
+  
+  // The speed of 50 is past the last bin, so it isn't in any bin but is
+  // still counted as a particle of the histogram
+  REQUIRE(histogram.GetBins() == std::vector<size_t>{1, 1, 0, 0, 0, 0, 0, 0, 
+                                                    0, 1});
+  REQUIRE(histogram.GetParticleCount() == 4);
+}
+
+TEST_CASE("Histograms kept up to date from speed changes match filling them "
+          "from scratch") {
+  ParticleSimulator particle_simulator;
+  particle_simulator.SetSeed(11);
+  particle_simulator.SetSpeedChangeTracking(true);
+  particle_simulator.AddParticles(300, 6, 10, "red");
+  particle_simulator.AddParticles(150, 10, 30, "blue");
+  
+  std::vector<Histogram> histograms = {Histogram(0, 10), Histogram(1, 30)};
+  
+  SECTION("Brute force") {
+    particle_simulator.SetBroadphase(Broadphase::kBruteForce);
+  }
+  
+  SECTION("Uniform grid") {
+    particle_simulator.SetBroadphase(Broadphase::kUniformGrid);
+  }
+  
+  SECTION("Sort and sweep") {
+    particle_simulator.SetBroadphase(Broadphase::kSortAndSweep);
+  }
+  
+  SECTION("Parallel uniform grid") {
+    particle_simulator.SetThreadCount(3);
+  }
+  
+  SECTION("Continuous collisions") {
+    particle_simulator.SetCollisionDetection(CollisionDetection::kContinuous);
+  }
+  
+  SECTION("Event driven") {
+    particle_simulator.SetEngine(Engine::kEventDriven);
+  }
+  
+  size_t collision_changes = 0;
+  for (size_t frame = 0; frame < 30; frame++) {
+    particle_simulator.Update();
+    if (frame == 10) {
+      particle_simulator.SpeedUp();
+    }
+    if (frame == 20) {
+      particle_simulator.SlowDown();
+      particle_simulator.AddParticles(20, 6, 10, "red", 500, 400, 1, 2);
+    }
+    
+    if (frame > 0 && frame != 10 && frame != 20) {
+      collision_changes += particle_simulator.GetSpeedChanges().size();
+    }
+    Histogram::ApplySpeedChanges(particle_simulator.GetParticles(),
+                                 particle_simulator.GetSpeedChanges(),
+                                 histograms);
+    particle_simulator.ClearSpeedChanges();
+  }
+  
+  // Apart from the first frame, which has the added particles, and the 
+  // frames that change every speed, only collisions change speeds
+  REQUIRE(collision_changes > 0);
+  std::vector<Histogram> rebuilt = {Histogram(0, 10), Histogram(1, 30)};
+  Histogram::FillBins(particle_simulator.GetParticles(), rebuilt);
+  for (size_t h = 0; h < histograms.size(); h++) {
+    REQUIRE(histograms[h].GetBins() == rebuilt[h].GetBins());
+    REQUIRE(histograms[h].GetParticleCount() == rebuilt[h].GetParticleCount());
+    REQUIRE(histograms[h].GetColor() == rebuilt[h].GetColor());
+  }
+  REQUIRE(histograms[0].GetParticleCount() == 320);
+}
+
+TEST_CASE("Speed changes are only recorded while tracking") {
+  
+  // Seeded, so none of the random particles can land by the wall and hit
+  // the particle bouncing off it
+  ParticleSimulator particle_simulator;
+  particle_simulator.SetSeed(2);
+  particle_simulator.AddParticles(10, 6, 10, "red");
+  REQUIRE(particle_simulator.GetSpeedChanges().empty());
+  
+  particle_simulator.SetSpeedChangeTracking(true);
+  particle_simulator.AddParticles(1, 6, 10, "red", 500, 400, 2, 0);
+  REQUIRE(particle_simulator.GetSpeedChanges().size() == 1);
+  REQUIRE(particle_simulator.GetSpeedChanges()[0].particle == 10);
+  REQUIRE(particle_simulator.GetSpeedChanges()[0].old_speed == kNoSpeed);
+  REQUIRE(particle_simulator.GetSpeedChanges()[0].new_speed == 2);
+  
+  SECTION("Bouncing off a wall doesn't change a speed") {
+    particle_simulator.ClearSpeedChanges();
+    particle_simulator.AddParticles(1, 6, 10, "red", 
+                                    ParticleSimulator::kXUpperBound - 7, 600,
+                                    2, 0);
+    particle_simulator.ClearSpeedChanges();
+    particle_simulator.Update();
+    for (const SpeedChange &change : particle_simulator.GetSpeedChanges()) {
+      REQUIRE(change.particle != 11);
+    }
+  }
+  
+  SECTION("Turning tracking off clears the changes") {
+    particle_simulator.SetSpeedChangeTracking(false);
+    REQUIRE(particle_simulator.GetSpeedChanges().empty());
+    particle_simulator.SpeedUp();
+    REQUIRE(particle_simulator.GetSpeedChanges().empty());
+  }
+}
@@ -0,0 +1,141 @@
+#include <catch2/catch.hpp>
+#include <histogram.h>
+#include <instrumentation.h>
+#include <integrator.h>
+#include <particle_simulator.h>
+
+using namespace idealgas;
+
+namespace {
+
+/**
+ * Adds a pair of particles that collide in the first update and a particle
+ * that bounces off the left wall in the first update
+ */
+void AddCollidingParticles(ParticleSimulator &particle_simulator) {
+  particle_simulator.AddParticles(1, 10, 10, "red", 500, 500, 2, 0);
+  particle_simulator.AddParticles(1, 10, 10, "red", 515, 500, -2, 0);
+  particle_simulator.AddParticles(1, 10, 10, "red",
+                                  ParticleSimulator::kXLowerBound + 11, 600,
+                                  -2, 0);
+}
+
+} // namespace
+
+TEST_CASE("The simulator records each update", "[instrumentation]") {
+  ParticleSimulator particle_simulator;
+  AddCollidingParticles(particle_simulator);
+
+  SECTION("Uniform grid") {
+    particle_simulator.SetBroadphase(Broadphase::kUniformGrid);
+  }
+
+  SECTION("Sort and sweep") {
+    particle_simulator.SetBroadphase(Broadphase::kSortAndSweep);
+  }
+
+  SECTION("Brute force") {
+    particle_simulator.SetBroadphase(Broadphase::kBruteForce);
+  }
+
+  SECTION("Parallel uniform grid") {
+    particle_simulator.SetThreadCount(2);
+  }
+
+  SECTION("Continuous collisions") {
+    particle_simulator.SetCollisionDetection(CollisionDetection::kContinuous);
+  }
+
+  SECTION("Event driven") {
+    particle_simulator.SetEngine(Engine::kEventDriven);
+  }
+
+  particle_simulator.Update();
+  InstrumentationSnapshot snapshot =
+      particle_simulator.GetInstrumentationSnapshot();
+
+  if (Instrumentation::kEnabled) {
+    REQUIRE(snapshot.GetCount(Counter::kUpdates) == 1);
+    REQUIRE(snapshot.GetCount(Counter::kCandidatePairs) ==
+        particle_simulator.GetCandidatePairCount());
+    REQUIRE(snapshot.GetCount(Counter::kCollisions) == 1);
+    REQUIRE(snapshot.GetCount(Counter::kWallBounces) == 1);
+    for (size_t phase = 0; phase < kPhaseCount; phase++) {
+      REQUIRE(snapshot.seconds[phase] >= 0);
+    }
+  } else {
+    for (size_t counter = 0; counter < kCounterCount; counter++) {
+      REQUIRE(snapshot.counts[counter] == 0);
+    }
+    for (size_t phase = 0; phase < kPhaseCount; phase++) {
+      REQUIRE(snapshot.seconds[phase] == 0);
+    }
+  }
+
+  particle_simulator.ResetInstrumentation();
+  snapshot = particle_simulator.GetInstrumentationSnapshot();
+  REQUIRE(snapshot.GetCount(Counter::kUpdates) == 0);
+  REQUIRE(snapshot.GetCount(Counter::kCollisions) == 0);
+}
+
+TEST_CASE("The histogram records its binning", "[instrumentation]") {
+  ParticleSimulator particle_simulator;
+  AddCollidingParticles(particle_simulator);
+  Histogram histogram(0, 10);
+  histogram.FillBins(particle_simulator.GetParticles());
+  histogram.FillBins(particle_simulator.GetParticles());
+
+  InstrumentationSnapshot snapshot = histogram.GetInstrumentationSnapshot();
+  REQUIRE(snapshot.GetCount(Counter::kBinnedParticles) ==
+      (Instrumentation::kEnabled ? 6 : 0));
+
+  histogram.ResetInstrumentation();
+  REQUIRE(histogram.GetInstrumentationSnapshot().GetCount(
+      Counter::kBinnedParticles) == 0);
+}
+
+TEST_CASE("Moving particles can count the wall bounces",
+          "[instrumentation]") {
+
+  // Enough particles to fill the SIMD lanes and leave a few for the scalar
+  // loop. Every third one hits the left wall and every fifth one the top
+  const size_t kCount = 37;
+  std::vector<float> x(kCount, 600);
+  std::vector<float> y(kCount, 400);
+  std::vector<float> x_velocity(kCount, 1);
+  std::vector<float> y_velocity(kCount, 1);
+  std::vector<uint32_t> species(kCount, 0);
+  const double kRadius = 5;
+  size_t expected = 0;
+  for (size_t i = 0; i < kCount; i++) {
+    if (i % 3 == 0) {
+      x[i] = 106;
+      x_velocity[i] = -2;
+      expected++;
+    }
+    if (i % 5 == 0) {
+      y[i] = 56;
+      y_velocity[i] = -2;
+      expected++;
+    }
+  }
+
+  std::vector<float> plain_x = x;
+  std::vector<float> plain_y = y;
+  std::vector<float> plain_x_velocity = x_velocity;
+  std::vector<float> plain_y_velocity = y_velocity;
+  MoveParticles(plain_x.data(), plain_y.data(), plain_x_velocity.data(),
+                plain_y_velocity.data(), species.data(), &kRadius, kCount, 1,
+                100, 50, 1000, 800);
+
+  REQUIRE(MoveParticlesCountingWallBounces(x.data(), y.data(),
+                                           x_velocity.data(),
+                                           y_velocity.data(), species.data(),
+                                           &kRadius, kCount, 1, 100, 50, 1000,
+                                           800) ==
+      expected);
+  REQUIRE(x == plain_x);
+  REQUIRE(y == plain_y);
+  REQUIRE(x_velocity == plain_x_velocity);
+  REQUIRE(y_velocity == plain_y_velocity);
+}
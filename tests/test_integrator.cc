@@ -0,0 +1,97 @@
+#include <catch2/catch.hpp>
+#include <integrator.h>
+#include <particle.h>
+#include <particle_simulator.h>
+#include <random>
+
+using namespace idealgas;
+using glm::vec2;
+
+TEST_CASE("Batch integrator matches Particle::Update bit for bit", 
+          "[integrator]") {
+  
+  // An amount that doesn't fill the last group of SIMD lanes so the scalar
+  // tail is used too
+  const size_t kAmount = 1003;
+  std::mt19937 mt(42);
+  
+  // Most particles start close to a wall so the bounces get tested
+  std::uniform_real_distribution<float> x_distribution(
+      ParticleSimulator::kXLowerBound - 5, ParticleSimulator::kXLowerBound + 30);
+  std::uniform_real_distribution<float> y_distribution(
+      ParticleSimulator::kYUpperBound - 30, ParticleSimulator::kYUpperBound + 5);
+  std::uniform_real_distribution<float> velocity_distribution(-6, 6);
+  std::uniform_real_distribution<double> radius_distribution(0.1, 20);
+  
+  std::vector<Particle> particles;
+  std::vector<float> x, y, x_velocity, y_velocity;
+  
+  // Every particle gets its own species, listed backwards so the lookups
+  // don't just walk the table in order
+  std::vector<double> radii(kAmount);
+  std::vector<uint32_t> species;
+  for (size_t i = 0; i < kAmount; i++) {
+    vec2 position(x_distribution(mt), y_distribution(mt));
+    if (i % 2 == 0) {
+      
+      // Mirror half of them over to the other two walls
+      position = vec2(ParticleSimulator::kXLowerBound + 
+          ParticleSimulator::kXUpperBound - position.x,
+                      ParticleSimulator::kYLowerBound + 
+                          ParticleSimulator::kYUpperBound - position.y);
+    }
+    vec2 velocity(velocity_distribution(mt), velocity_distribution(mt));
+    double radius = radius_distribution(mt);
+    
+    particles.emplace_back(position, velocity, radius, 10, "red");
+    x.push_back(position.x);
+    y.push_back(position.y);
+    x_velocity.push_back(velocity.x);
+    y_velocity.push_back(velocity.y);
+    species.push_back((uint32_t) (kAmount - 1 - i));
+    radii[species.back()] = radius;
+  }
+  
+  std::vector<float> scalar_x = x, scalar_y = y;
+  std::vector<float> scalar_x_velocity = x_velocity;
+  std::vector<float> scalar_y_velocity = y_velocity;
+  
+  // Whole steps first, then smaller steps like the substeps of a frame
+  for (size_t step = 0; step < 40; step++) {
+    float time_step = step < 20 ? 1 : 0.375f;
+    for (Particle &particle : particles) {
+      particle.Update(time_step);
+    }
+    MoveParticles(x.data(), y.data(), x_velocity.data(), y_velocity.data(), 
+                  species.data(), radii.data(), kAmount, time_step, 
+                  ParticleSimulator::kXLowerBound,
+                  ParticleSimulator::kYLowerBound, 
+                  ParticleSimulator::kXUpperBound,
+                  ParticleSimulator::kYUpperBound);
+    MoveParticlesScalar(scalar_x.data(), scalar_y.data(), 
+                        scalar_x_velocity.data(), scalar_y_velocity.data(), 
+                        species.data(), radii.data(), kAmount, time_step, 
+                        ParticleSimulator::kXLowerBound,
+                        ParticleSimulator::kYLowerBound,
+                        ParticleSimulator::kXUpperBound,
+                        ParticleSimulator::kYUpperBound);
+  }
+  
+  bool batch_matches = true;
+  bool scalar_matches = true;
+  for (size_t i = 0; i < kAmount; i++) {
+    vec2 position = particles[i].GetPosition();
+    vec2 velocity = particles[i].GetVelocity();
+    if (position != vec2(x[i], y[i]) || 
+        velocity != vec2(x_velocity[i], y_velocity[i])) {
+      batch_matches = false;
+    }
+    if (position != vec2(scalar_x[i], scalar_y[i]) ||
+        velocity != vec2(scalar_x_velocity[i], scalar_y_velocity[i])) {
+      scalar_matches = false;
+    }
+  }
+  
+  REQUIRE(batch_matches);
+  REQUIRE(scalar_matches);
+}
@@ -0,0 +1,104 @@
+#include <catch2/catch.hpp>
+#include <narrowphase.h>
+#include <random>
+
+using namespace idealgas;
+using glm::vec2;
+
+TEST_CASE("Narrowphase finds the overlapping pairs", "[narrowphase]") {
+  ParticleStore particles;
+  
+  // Overlapping and moving toward each other
+  particles.AddParticle(vec2(500, 500), vec2(2, 0), 10, 10, "red");
+  particles.AddParticle(vec2(515, 500), vec2(-2, 0), 10, 10, "red");
+  
+  // Overlapping but moving apart
+  particles.AddParticle(vec2(600, 500), vec2(-2, 0), 10, 10, "red");
+  particles.AddParticle(vec2(615, 500), vec2(2, 0), 10, 10, "red");
+  
+  // Moving toward each other but not touching
+  particles.AddParticle(vec2(700, 500), vec2(2, 0), 10, 10, "red");
+  particles.AddParticle(vec2(721, 500), vec2(-2, 0), 10, 10, "red");
+  
+  std::vector<ParticlePair> pairs = {ParticlePair(0, 1), ParticlePair(2, 3),
+                                     ParticlePair(4, 5)};
+  std::vector<ParticlePair> colliding(pairs.size());
+  size_t found = FindCollidingPairs(pairs.data(), pairs.size(), particles,
+                                    colliding.data());
+  
+  // The pair moving apart is kept, since a collision earlier in the step
+  // could turn it around before it is resolved
+  REQUIRE(found == 2);
+  REQUIRE(colliding[0] == ParticlePair(0, 1));
+  REQUIRE(colliding[1] == ParticlePair(2, 3));
+  
+  SECTION("Resolving only bounces the particles moving toward each other") {
+    REQUIRE(ResolveCollisions(colliding.data(), found, particles) == 1);
+    REQUIRE(particles.GetVelocity(0) == vec2(-2, 0));
+    REQUIRE(particles.GetVelocity(1) == vec2(2, 0));
+    REQUIRE(particles.GetVelocity(2) == vec2(-2, 0));
+    
+    SECTION("Resolving it again does nothing since they are moving apart") {
+      REQUIRE(ResolveCollisions(colliding.data(), found, particles) == 0);
+      REQUIRE(particles.GetVelocity(0) == vec2(-2, 0));
+    }
+  }
+}
+
+TEST_CASE("Narrowphase kernel matches the scalar version", "[narrowphase]") {
+  std::mt19937 mt(7);
+  std::uniform_real_distribution<float> position_distribution(500, 560);
+  std::uniform_real_distribution<float> velocity_distribution(-3, 3);
+  std::uniform_real_distribution<double> radius_distribution(1, 8);
+  
+  ParticleStore particles;
+  for (size_t i = 0; i < 60; i++) {
+    particles.AddParticle(vec2(position_distribution(mt), 
+                               position_distribution(mt)),
+                          vec2(velocity_distribution(mt),
+                               velocity_distribution(mt)),
+                          radius_distribution(mt), 10, "red");
+  }
+  
+  std::vector<ParticlePair> pairs;
+  for (uint32_t i = 0; i < particles.size(); i++) {
+    for (uint32_t j = i + 1; j < particles.size(); j++) {
+      pairs.emplace_back(i, j);
+    }
+  }
+  
+  std::vector<ParticlePair> colliding(pairs.size());
+  std::vector<ParticlePair> scalar_colliding(pairs.size());
+  size_t found = FindCollidingPairs(pairs.data(), pairs.size(), particles,
+                                    colliding.data());
+  size_t scalar_found = FindCollidingPairsScalar(pairs.data(), pairs.size(),
+                                                 particles, 
+                                                 scalar_colliding.data());
+  
+  REQUIRE(found > 0);
+  REQUIRE(found == scalar_found);
+  colliding.resize(found);
+  scalar_colliding.resize(scalar_found);
+  REQUIRE(colliding == scalar_colliding);
+}
+
+TEST_CASE("Collisions are checked with the velocities at that point", 
+          "[narrowphase]") {
+  ParticleStore particles;
+  
+  // The middle particle is moving away from the right one, until the left
+  // one knocks it back into it
+  particles.AddParticle(vec2(492, 500), vec2(4, 0), 6, 10, "red");
+  particles.AddParticle(vec2(500, 500), vec2(1, 0), 6, 10, "red");
+  particles.AddParticle(vec2(508, 500), vec2(2, 0), 6, 10, "red");
+  
+  std::vector<ParticlePair> pairs = {ParticlePair(0, 1), ParticlePair(1, 2)};
+  std::vector<ParticlePair> overlapping(pairs.size());
+  size_t found = FindCollidingPairs(pairs.data(), pairs.size(), particles,
+                                    overlapping.data());
+  REQUIRE(found == 2);
+  REQUIRE(ResolveCollisions(overlapping.data(), found, particles) == 2);
+  REQUIRE(particles.GetVelocity(0) == vec2(1, 0));
+  REQUIRE(particles.GetVelocity(1) == vec2(2, 0));
+  REQUIRE(particles.GetVelocity(2) == vec2(4, 0));
+}
@@ -1,5 +1,7 @@
 #include <catch2/catch.hpp>
 #include <particle_simulator.h>
+#include <algorithm>
+#include <limits>
 
 using namespace idealgas;
 
@@ -13,6 +15,18 @@ TEST_CASE("Particle controller able to add particles correctly", "[controller]")
                       std::invalid_argument);
   }
   
+  SECTION("Adding random particles with a NaN radius or a mass less than "
+          "0.1 throws an error") {
+    const double kNaN = std::numeric_limits<double>::quiet_NaN();
+    REQUIRE_THROWS_AS(particle_simulator.AddParticles(50, kNaN, 10, "red"),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(particle_simulator.AddParticles(50, 5, 0, "red"),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(particle_simulator.AddParticles(50, 5, kNaN, "red"),
+                      std::invalid_argument);
+    REQUIRE(particle_simulator.GetParticles().empty());
+  }
+  
   SECTION("Adding particles with no initial velocity throws an error") {
     REQUIRE_THROWS_AS(particle_simulator.AddParticles(5, 10, 10, "red", 
                                                        250, 250, 0, 0), 
@@ -32,6 +46,9 @@ TEST_CASE("Particle controller able to add particles correctly", "[controller]")
   }
   
   SECTION("Adding 5 particles actually adds 5 particles") {
+    // Seeded so that none of the particles start out touching a wall or each
+    // other, which would change their path in the first update
+    particle_simulator.SetSeed(7);
     particle_simulator.AddParticles(5, 5, 10, "red");
     REQUIRE(particle_simulator.GetParticles().size() == 5);
 
@@ -405,3 +422,438 @@ TEST_CASE("Kinetic energy is conserved throughout the simulation with "
   // We use approx because of doubles and rounding while updating 
   REQUIRE(initial_tot_KE == Approx(new_tot_KE).epsilon(1));
 }
+
+TEST_CASE("Broadphases find the same collisions", "[broadphase]") {
+  
+  SECTION("Uniform grid and sort and sweep give exactly the same results") {
+    ParticleSimulator grid_simulator;
+    grid_simulator.AddParticles(100, 5, 10, "red");
+    grid_simulator.AddParticles(50, 10, 20, "blue");
+    REQUIRE(grid_simulator.GetBroadphase() == Broadphase::kUniformGrid);
+    
+    // Copying the simulator gives both of them the same random particles
+    ParticleSimulator sweep_simulator = grid_simulator;
+    sweep_simulator.SetBroadphase(Broadphase::kSortAndSweep);
+    
+    for (size_t i = 0; i < 200; i++) {
+      grid_simulator.Update();
+      sweep_simulator.Update();
+    }
+    
+    std::vector<Particle> grid_particles = grid_simulator.GetParticles();
+    std::vector<Particle> sweep_particles = sweep_simulator.GetParticles();
+    
+    bool same = true;
+    for (size_t i = 0; i < grid_particles.size(); i++) {
+      if (grid_particles[i].GetPosition() != sweep_particles[i]
+          .GetPosition() || grid_particles[i].GetVelocity() !=
+          sweep_particles[i].GetVelocity()) {
+        same = false;
+      }
+    }
+    REQUIRE(same);
+  }
+  
+  SECTION("Broadphases give the same results as brute force over many "
+          "steps") {
+    ParticleSimulator brute_force_simulator;
+    brute_force_simulator.SetSeed(3);
+    brute_force_simulator.AddParticles(600, 5, 10, "red");
+    brute_force_simulator.AddParticles(300, 10, 20, "blue");
+    brute_force_simulator.SetBroadphase(Broadphase::kBruteForce);
+    
+    // Copying the simulator gives all of them the same random particles
+    ParticleSimulator grid_simulator = brute_force_simulator;
+    grid_simulator.SetBroadphase(Broadphase::kUniformGrid);
+    ParticleSimulator sweep_simulator = brute_force_simulator;
+    sweep_simulator.SetBroadphase(Broadphase::kSortAndSweep);
+    
+    for (size_t i = 0; i < 50; i++) {
+      brute_force_simulator.Update();
+      grid_simulator.Update();
+      sweep_simulator.Update();
+    }
+    
+    // Every path collides the pairs in the same order with the same 
+    // arithmetic, so only the last bits of a float can differ
+    const float kTolerance = 1e-4f;
+    const ParticleStore &brute_force_particles = brute_force_simulator
+        .GetParticles();
+    const ParticleStore &grid_particles = grid_simulator.GetParticles();
+    const ParticleStore &sweep_particles = sweep_simulator.GetParticles();
+    float largest_difference = 0;
+    for (size_t i = 0; i < brute_force_particles.size(); i++) {
+      glm::vec2 position = brute_force_particles.GetPosition(i);
+      glm::vec2 velocity = brute_force_particles.GetVelocity(i);
+      largest_difference = std::max({
+          largest_difference,
+          glm::length(grid_particles.GetPosition(i) - position),
+          glm::length(grid_particles.GetVelocity(i) - velocity),
+          glm::length(sweep_particles.GetPosition(i) - position),
+          glm::length(sweep_particles.GetVelocity(i) - velocity)});
+    }
+    REQUIRE(largest_difference <= kTolerance);
+  }
+  
+  SECTION("Broadphases collide the same pairs as brute force") {
+    ParticleSimulator brute_force_simulator;
+    brute_force_simulator.SetBroadphase(Broadphase::kBruteForce);
+    
+    // Rows of particles that overlap their neighbor and move toward it
+    for (size_t row = 0; row < 10; row++) {
+      for (size_t column = 0; column < 10; column++) {
+        brute_force_simulator.AddParticles(1, 7, 10 + column, "red", 
+                                           500 + 60 * column, 
+                                           100 + 50 * row, 2, 0.5);
+        brute_force_simulator.AddParticles(1, 7, 20, "blue",
+                                           512 + 60 * column,
+                                           100 + 50 * row, -3, 1);
+      }
+    }
+    
+    ParticleSimulator grid_simulator = brute_force_simulator;
+    grid_simulator.SetBroadphase(Broadphase::kUniformGrid);
+    ParticleSimulator sweep_simulator = brute_force_simulator;
+    sweep_simulator.SetBroadphase(Broadphase::kSortAndSweep);
+    
+    brute_force_simulator.Update();
+    grid_simulator.Update();
+    sweep_simulator.Update();
+    
+    // The narrowphase compares squared distances and uses the reduced mass,
+    // so it can round differently from CanCollide and Collide
+    const ParticleStore &brute_force_particles = brute_force_simulator
+        .GetParticles();
+    const ParticleStore &grid_particles = grid_simulator.GetParticles();
+    const ParticleStore &sweep_particles = sweep_simulator.GetParticles();
+    for (size_t i = 0; i < brute_force_particles.size(); i++) {
+      glm::vec2 expected = brute_force_particles.GetVelocity(i);
+      REQUIRE(grid_particles.GetVelocity(i).x == Approx(expected.x));
+      REQUIRE(grid_particles.GetVelocity(i).y == Approx(expected.y));
+      REQUIRE(sweep_particles.GetVelocity(i).x == Approx(expected.x));
+      REQUIRE(sweep_particles.GetVelocity(i).y == Approx(expected.y));
+    }
+    
+    // Every pair actually collided
+    REQUIRE(brute_force_particles.GetVelocity(0) != glm::vec2(2, 0.5));
+  }
+}
+
+TEST_CASE("Parallel updates give the same results with any thread count",
+          "[threads]") {
+  ParticleSimulator particle_simulator;
+  particle_simulator.AddParticles(300, 5, 10, "red");
+  particle_simulator.AddParticles(100, 10, 20, "blue");
+  particle_simulator.SetThreadCount(2);
+  REQUIRE(particle_simulator.GetThreadCount() == 2);
+  
+  ParticleSimulator other_simulator = particle_simulator;
+  
+  SECTION("Three threads") {
+    other_simulator.SetThreadCount(3);
+  }
+  
+  SECTION("Eight threads") {
+    other_simulator.SetThreadCount(8);
+  }
+
+  double initial_KE = 0.0;
+  for (const Particle& particle : particle_simulator.GetParticles()) {
+    initial_KE += 0.5 * particle.GetMass() * 
+        glm::dot(particle.GetVelocity(), particle.GetVelocity());
+  }
+
+  for (size_t i = 0; i < 100; i++) {
+    particle_simulator.Update();
+    other_simulator.Update();
+  }
+  
+  const ParticleStore &particles = particle_simulator.GetParticles();
+  const ParticleStore &other_particles = other_simulator.GetParticles();
+  bool same = true;
+  double new_KE = 0.0;
+  for (size_t i = 0; i < particles.size(); i++) {
+    if (particles.GetPosition(i) != other_particles.GetPosition(i) || 
+        particles.GetVelocity(i) != other_particles.GetVelocity(i)) {
+      same = false;
+    }
+    new_KE += 0.5 * particles.GetMass(i) * 
+        glm::dot(particles.GetVelocity(i), particles.GetVelocity(i));
+  }
+  REQUIRE(same);
+  
+  // We use approx because of doubles and rounding while updating 
+  REQUIRE(new_KE == Approx(initial_KE).epsilon(0.01));
+}
+
+TEST_CASE("Fixed time steps advance the simulation", "[time step]") {
+  ParticleSimulator particle_simulator;
+  particle_simulator.AddParticles(1, 10, 10, "red", 600, 400, 2, 1);
+  
+  SECTION("The time step and substeps have to be valid") {
+    REQUIRE_THROWS_AS(particle_simulator.SetTimeStep(0), 
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(particle_simulator.SetTimeStep(-1), 
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(particle_simulator.SetMaxSubsteps(0), 
+                      std::invalid_argument);
+  }
+  
+  SECTION("Particles move by their velocity times the time step") {
+    particle_simulator.SetTimeStep(0.5);
+    particle_simulator.Update();
+    REQUIRE(particle_simulator.GetParticles()[0].GetPosition() == 
+        glm::vec2(601, 400.5));
+  }
+  
+  SECTION("Time that doesn't fill a step is kept for the next call") {
+    particle_simulator.SetTimeStep(0.5);
+    REQUIRE(particle_simulator.Advance(0.75) == 1);
+    REQUIRE(particle_simulator.Advance(0.25) == 1);
+    REQUIRE(particle_simulator.Advance(0.25) == 0);
+    REQUIRE(particle_simulator.GetParticles()[0].GetPosition() == 
+        glm::vec2(602, 401));
+  }
+  
+  SECTION("Advance runs at most the maximum amount of substeps") {
+    particle_simulator.SetTimeStep(0.5);
+    particle_simulator.SetMaxSubsteps(3);
+    REQUIRE(particle_simulator.Advance(10) == 3);
+    
+    // The steps that didn't fit were dropped
+    REQUIRE(particle_simulator.Advance(0.4) == 0);
+    REQUIRE(particle_simulator.GetParticles()[0].GetPosition() == 
+        glm::vec2(603, 401.5));
+  }
+  
+  SECTION("Smaller time steps allow faster particles") {
+    REQUIRE_THROWS_AS(particle_simulator.AddParticles(1, 10, 10, "red", 600,
+                                                       400, 20, 0),
+                      std::invalid_argument);
+    particle_simulator.SetTimeStep(0.25);
+    REQUIRE_NOTHROW(particle_simulator.AddParticles(1, 10, 10, "red", 600, 
+                                                     400, 20, 0));
+  }
+  
+  SECTION("Random velocities are limited by the time step") {
+    particle_simulator.SetTimeStep(0.25);
+    particle_simulator.SetSeed(2);
+    particle_simulator.AddParticles(200, 10, 10, "red");
+    
+    // Up to half the radius per time step, so up to 20 per unit of time
+    float fastest = 0;
+    const ParticleStore &particles = particle_simulator.GetParticles();
+    for (size_t i = 1; i < particles.size(); i++) {
+      fastest = std::max({fastest, particles.GetXVelocity()[i], 
+                          particles.GetYVelocity()[i]});
+    }
+    REQUIRE(fastest > 5);
+    REQUIRE(fastest <= 20);
+  }
+}
+
+TEST_CASE("The simulator counts the pairs it tests", "[controller]") {
+  ParticleSimulator particle_simulator;
+  particle_simulator.AddParticles(1, 10, 10, "red", 500, 500, 2, 0);
+  particle_simulator.AddParticles(1, 10, 10, "red", 515, 500, -2, 0);
+  particle_simulator.AddParticles(1, 10, 10, "red", 900, 500, 2, 0);
+  particle_simulator.AddParticles(1, 10, 10, "red", 1100, 500, 2, 0);
+  
+  SECTION("Brute force tests every pair") {
+    particle_simulator.SetBroadphase(Broadphase::kBruteForce);
+    particle_simulator.Update();
+    REQUIRE(particle_simulator.GetCandidatePairCount() == 6);
+  }
+  
+  SECTION("The uniform grid skips the far apart pairs") {
+    particle_simulator.SetBroadphase(Broadphase::kUniformGrid);
+    particle_simulator.Update();
+    REQUIRE(particle_simulator.GetCandidatePairCount() >= 1);
+    REQUIRE(particle_simulator.GetCandidatePairCount() < 6);
+  }
+  
+  SECTION("Sort and sweep only tests the overlapping pair") {
+    particle_simulator.SetBroadphase(Broadphase::kSortAndSweep);
+    particle_simulator.Update();
+    REQUIRE(particle_simulator.GetCandidatePairCount() == 1);
+  }
+}
+
+TEST_CASE("Seeded simulations add the same particles", "[controller]") {
+  ParticleSimulator particle_simulator;
+  ParticleSimulator same_seed;
+  particle_simulator.SetSeed(12);
+  same_seed.SetSeed(12);
+  REQUIRE(particle_simulator.GetSeed() == 12);
+  
+  particle_simulator.AddParticles(20, 10, 10, "red");
+  same_seed.AddParticles(5, 10, 10, "red");
+  same_seed.AddParticles(15, 10, 10, "red");
+  
+  SECTION("The same seed gives the same particles") {
+    for (size_t i = 0; i < 20; i++) {
+      REQUIRE(particle_simulator.GetParticles()[i].GetPosition() == 
+          same_seed.GetParticles()[i].GetPosition());
+      REQUIRE(particle_simulator.GetParticles()[i].GetVelocity() == 
+          same_seed.GetParticles()[i].GetVelocity());
+    }
+  }
+  
+  SECTION("The particles are in the container with allowed velocities") {
+    const double kXLower = ParticleSimulator::kXLowerBound;
+    const double kXUpper = ParticleSimulator::kXUpperBound;
+    const double kYLower = ParticleSimulator::kYLowerBound;
+    const double kYUpper = ParticleSimulator::kYUpperBound;
+    for (const Particle &particle : particle_simulator.GetParticles()) {
+      REQUIRE(particle.GetPosition().x >= kXLower);
+      REQUIRE(particle.GetPosition().x <= kXUpper);
+      REQUIRE(particle.GetPosition().y >= kYLower);
+      REQUIRE(particle.GetPosition().y <= kYUpper);
+      REQUIRE(particle.GetVelocity().x >= 0.5);
+      REQUIRE(particle.GetVelocity().x <= 5);
+    }
+  }
+  
+  SECTION("Setting the seed again starts the numbers over") {
+    ParticleSimulator reseeded;
+    reseeded.SetSeed(3);
+    reseeded.AddParticles(1, 10, 10, "red");
+    reseeded.SetSeed(12);
+    reseeded.AddParticles(1, 10, 10, "red");
+    REQUIRE(reseeded.GetParticles()[1].GetPosition() == 
+        particle_simulator.GetParticles()[0].GetPosition());
+  }
+  
+  SECTION("A different seed gives different particles") {
+    ParticleSimulator other_seed;
+    other_seed.SetSeed(13);
+    other_seed.AddParticles(20, 10, 10, "red");
+    bool any_different = false;
+    for (size_t i = 0; i < 20; i++) {
+      any_different = any_different || 
+          other_seed.GetParticles()[i].GetPosition() != 
+          particle_simulator.GetParticles()[i].GetPosition();
+    }
+    REQUIRE(any_different);
+  }
+}
+
+TEST_CASE("Particles can be added in bulk", "[controller]") {
+  ParticleSimulator particle_simulator;
+  
+  SECTION("Random particles are the same on any amount of threads") {
+    ParticleSimulator threaded;
+    particle_simulator.SetSeed(5);
+    threaded.SetSeed(5);
+    threaded.SetThreadCount(4);
+    particle_simulator.AddParticles(10000, 10, 10, "red");
+    threaded.AddParticles(10000, 10, 10, "red");
+    
+    const ParticleStore &particles = particle_simulator.GetParticles();
+    const ParticleStore &threaded_particles = threaded.GetParticles();
+    REQUIRE(std::equal(particles.GetX(), particles.GetX() + 10000, 
+                       threaded_particles.GetX()));
+    REQUIRE(std::equal(particles.GetYVelocity(), 
+                       particles.GetYVelocity() + 10000,
+                       threaded_particles.GetYVelocity()));
+  }
+  
+  SECTION("Particles can be taken from arrays") {
+    std::vector<float> x = {500, 600, 700};
+    std::vector<float> y = {400, 450, 500};
+    std::vector<float> x_velocity = {1, -2, 3};
+    std::vector<float> y_velocity = {0, 1, -1};
+    particle_simulator.AddParticles(3, 10, 10, "red", x.data(), y.data(), 
+                                    x_velocity.data(), y_velocity.data());
+    
+    REQUIRE(particle_simulator.GetParticles().size() == 3);
+    REQUIRE(particle_simulator.GetParticles()[1].GetPosition() == 
+        glm::vec2(600, 450));
+    REQUIRE(particle_simulator.GetParticles()[2].GetVelocity() == 
+        glm::vec2(3, -1));
+    REQUIRE(particle_simulator.GetParticles()[2].GetColor() == "red");
+  }
+  
+  SECTION("A bad particle in the arrays adds none of them") {
+    std::vector<float> x = {500, 600, 10};
+    std::vector<float> y = {400, 450, 500};
+    std::vector<float> x_velocity = {1, -2, 3};
+    std::vector<float> y_velocity = {0, 1, -1};
+    REQUIRE_THROWS_AS(particle_simulator.AddParticles(3, 10, 10, "red", 
+                                                      x.data(), y.data(),
+                                                      x_velocity.data(),
+                                                      y_velocity.data()),
+                      std::invalid_argument);
+    REQUIRE(particle_simulator.GetParticles().empty());
+  }
+}
+
+TEST_CASE("The container can be moved", "[controller]") {
+  ParticleSimulator particle_simulator;
+  
+  SECTION("Containers that are inside out or off the screen throw an error") {
+    REQUIRE_THROWS_AS(particle_simulator.SetContainer({100, 100, 50, 200}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(particle_simulator.SetContainer({100, 100, 200, 100}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(particle_simulator.SetContainer({-10, 100, 200, 200}),
+                      std::invalid_argument);
+  }
+  
+  SECTION("Containers too narrow to place particles in throw an error") {
+    REQUIRE_THROWS_AS(particle_simulator.SetContainer({100, 100, 101, 500}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(particle_simulator.SetContainer({100, 100, 500, 103.5}),
+                      std::invalid_argument);
+    
+    // Random particles land on the only pixel 2 away from both walls
+    particle_simulator.SetContainer({100, 100, 104, 500});
+    particle_simulator.SetSeed(1);
+    particle_simulator.AddParticles(20, 1, 10, "red");
+    bool inside = true;
+    for (const Particle &particle : particle_simulator.GetParticles()) {
+      inside &= particle.GetPosition().x == 102;
+    }
+    REQUIRE(inside);
+  }
+  
+  SECTION("Random particles bigger than the container throw an error") {
+    particle_simulator.SetContainer({100, 100, 120, 500});
+    REQUIRE_THROWS_AS(particle_simulator.AddParticles(5, 11, 10, "red"),
+                      std::invalid_argument);
+    REQUIRE(particle_simulator.GetParticles().empty());
+  }
+  
+  SECTION("Every engine keeps the particles inside the new walls") {
+    Container container = {100, 50, 300, 250};
+    bool inside = true;
+    for (Broadphase broadphase : {Broadphase::kBruteForce, 
+                                  Broadphase::kUniformGrid,
+                                  Broadphase::kSortAndSweep}) {
+      ParticleSimulator simulator;
+      simulator.SetContainer(container);
+      simulator.SetSeed(9);
+      simulator.SetBroadphase(broadphase);
+      simulator.AddParticles(40, 6, 10, "red");
+      for (size_t step = 0; step < 200; step++) {
+        simulator.Update();
+      }
+      simulator.SetCollisionDetection(CollisionDetection::kContinuous);
+      for (size_t step = 0; step < 200; step++) {
+        simulator.Update();
+      }
+      simulator.SetEngine(Engine::kEventDriven);
+      for (size_t step = 0; step < 200; step++) {
+        simulator.Update();
+      }
+      
+      for (const Particle &particle : simulator.GetParticles()) {
+        inside &= particle.GetPosition().x > container.x_lower_bound && 
+            particle.GetPosition().x < container.x_upper_bound &&
+            particle.GetPosition().y > container.y_lower_bound && 
+            particle.GetPosition().y < container.y_upper_bound;
+      }
+    }
+    REQUIRE(inside);
+  }
+}
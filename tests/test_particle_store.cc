@@ -0,0 +1,116 @@
+#include <catch2/catch.hpp>
+#include <particle_store.h>
+
+using namespace idealgas;
+using glm::vec2;
+
+TEST_CASE("Particle store keeps particles in columns", "[store]") {
+  ParticleStore store;
+  store.AddParticle(vec2(500, 300), vec2(2, -3), 5, 10, "red");
+  store.AddParticle(vec2(700, 400), vec2(-1, 4), 8, 20, "blue");
+  
+  REQUIRE(store.size() == 2);
+  
+  SECTION("Columns hold the values of each particle") {
+    REQUIRE(store.GetX()[1] == 700);
+    REQUIRE(store.GetY()[1] == 400);
+    REQUIRE(store.GetXVelocity()[0] == 2);
+    REQUIRE(store.GetYVelocity()[0] == -3);
+    REQUIRE(store.GetRadius(1) == 8);
+    REQUIRE(store.GetInverseMass(1) == 1.0 / 20);
+  }
+  
+  SECTION("Indexing builds the same particle that was added") {
+    Particle particle = store[1];
+    REQUIRE(particle.GetPosition() == vec2(700, 400));
+    REQUIRE(particle.GetVelocity() == vec2(-1, 4));
+    REQUIRE(particle.GetRadius() == 8);
+    REQUIRE(particle.GetMass() == 20);
+    REQUIRE(particle.GetColor() == "blue");
+  }
+  
+  SECTION("Indexing past the end with at() throws an error") {
+    REQUIRE_THROWS_AS(store.at(2), std::out_of_range);
+  }
+  
+  SECTION("Setting the velocity only changes that particle") {
+    store.SetVelocity(0, vec2(6, 7));
+    REQUIRE(store.GetVelocity(0) == vec2(6, 7));
+    REQUIRE(store.GetVelocity(1) == vec2(-1, 4));
+  }
+  
+  SECTION("Store converts to a vector of particles in the same order") {
+    std::vector<Particle> particles = store;
+    REQUIRE(particles.size() == 2);
+    REQUIRE(particles[0].GetColor() == "red");
+    REQUIRE(particles[1].GetColor() == "blue");
+  }
+  
+  SECTION("Iterating visits every particle") {
+    double total_mass = 0;
+    for (const Particle &particle : store) {
+      total_mass += particle.GetMass();
+    }
+    REQUIRE(total_mass == 30);
+  }
+}
+
+TEST_CASE("Particle store adds many particles at once", "[store]") {
+  ParticleStore store;
+  store.AddParticle(vec2(500, 300), vec2(2, -3), 5, 10, "red");
+  
+  REQUIRE(store.AddParticles(3, 8, 20, "blue") == 1);
+  REQUIRE(store.size() == 4);
+  
+  SECTION("The new particles share their radius, mass and color") {
+    for (size_t i = 1; i < 4; i++) {
+      REQUIRE(store.GetRadius(i) == 8);
+      REQUIRE(store.GetMass(i) == 20);
+      REQUIRE(store.GetInverseMass(i) == 1.0 / 20);
+      REQUIRE(store.GetColor(i) == "blue");
+      REQUIRE(store.GetPosition(i) == vec2(0, 0));
+    }
+  }
+  
+  SECTION("Particles of the same kind share a species") {
+    store.AddParticle(vec2(600, 300), vec2(1, 1), 5, 10, "red");
+    REQUIRE(store.GetSpecies().size() == 2);
+    REQUIRE(store.GetSpeciesIndex(0) == 0);
+    REQUIRE(store.GetSpeciesIndex(3) == 1);
+    REQUIRE(store.GetSpeciesIndex(4) == 0);
+    REQUIRE(store[4].GetColor() == "red");
+  }
+}
+
+TEST_CASE("Particle store keeps a table of species", "[store]") {
+  ParticleStore store;
+  uint32_t small = store.AddSpecies(5, 10, "red");
+  uint32_t big = store.AddSpecies(8, 20, "blue");
+  
+  SECTION("Adding the same species again gives back its index") {
+    REQUIRE(store.AddSpecies(5, 10, "red") == small);
+    REQUIRE(store.GetSpecies().size() == 2);
+  }
+  
+  SECTION("Species that differ in anything get their own index") {
+    REQUIRE(store.AddSpecies(5, 10, "blue") == 2);
+    REQUIRE(store.AddSpecies(5, 20, "red") == 3);
+    REQUIRE(store.AddSpecies(6, 10, "red") == 4);
+  }
+  
+  SECTION("The table columns are indexed by species") {
+    REQUIRE(store.GetSpeciesRadii()[big] == 8);
+    REQUIRE(store.GetSpeciesMasses()[big] == 20);
+    REQUIRE(store.GetSpeciesInverseMasses()[small] == 1.0 / 10);
+    REQUIRE(store.GetSpecies()[big].color == "blue");
+  }
+  
+  SECTION("Particles are added by species") {
+    store.AddParticle(vec2(500, 300), vec2(2, -3), big);
+    REQUIRE(store.AddParticles(2, small) == 1);
+    REQUIRE(store.GetSpeciesIndices()[0] == big);
+    REQUIRE(store.GetSpeciesIndices()[2] == small);
+    REQUIRE(store[0].GetRadius() == 8);
+    REQUIRE(store[2].GetColor() == "red");
+  }
+}
@@ -0,0 +1,116 @@
+#include <catch2/catch.hpp>
+#include <particle_simulator.h>
+#include <placement.h>
+#include <cmath>
+#include <vector>
+
+using namespace idealgas;
+
+namespace {
+
+const double kXLower = ParticleSimulator::kXLowerBound;
+const double kYLower = ParticleSimulator::kYLowerBound;
+const double kXUpper = ParticleSimulator::kXUpperBound;
+const double kYUpper = ParticleSimulator::kYUpperBound;
+
+/**
+ * Checks that no two particles overlap and that none overlap the walls
+ */
+bool HasOverlaps(const ParticleStore &particles) {
+  for (size_t i = 0; i < particles.size(); i++) {
+    double x = particles.GetX()[i];
+    double y = particles.GetY()[i];
+    double radius = particles.GetRadius(i);
+    if (x - radius < kXLower || x + radius > kXUpper || 
+        y - radius < kYLower || y + radius > kYUpper) {
+      return true;
+    }
+    for (size_t j = i + 1; j < particles.size(); j++) {
+      double x_distance = x - particles.GetX()[j];
+      double y_distance = y - particles.GetY()[j];
+      double min_distance = radius + particles.GetRadius(j);
+      if (x_distance * x_distance + y_distance * y_distance < 
+          min_distance * min_distance) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * Finds the amount of particles of a radius that cover a fraction of the 
+ * container
+ */
+size_t CountForPackingFraction(double packing_fraction, double radius) {
+  double area = (kXUpper - kXLower) * (kYUpper - kYLower);
+  double particle_area = std::acos(-1.0) * radius * radius;
+  return (size_t) (packing_fraction * area / particle_area);
+}
+
+} // namespace
+
+TEST_CASE("Particles are placed without overlaps", "[placement]") {
+  ParticleSimulator particle_simulator;
+  particle_simulator.SetSeed(8);
+  particle_simulator.SetPlacement(Placement::kNonOverlapping);
+  
+  SECTION("Sparse particles") {
+    particle_simulator.AddParticles(300, 10, 10, "red");
+    REQUIRE(particle_simulator.GetParticles().size() == 300);
+    REQUIRE_FALSE(HasOverlaps(particle_simulator.GetParticles()));
+  }
+  
+  SECTION("Dense particles") {
+    particle_simulator.AddParticles(CountForPackingFraction(0.7, 12), 12, 10,
+                                    "red");
+    REQUIRE_FALSE(HasOverlaps(particle_simulator.GetParticles()));
+  }
+  
+  SECTION("Particles of several sizes avoid the ones added before them") {
+    particle_simulator.AddParticles(50, 20, 100, "blue");
+    particle_simulator.AddParticles(200, 12, 25, "green");
+    particle_simulator.AddParticles(400, 8, 5, "red");
+    REQUIRE(particle_simulator.GetParticles().size() == 650);
+    REQUIRE_FALSE(HasOverlaps(particle_simulator.GetParticles()));
+  }
+  
+  SECTION("Random placement still allows overlaps") {
+    particle_simulator.SetPlacement(Placement::kRandom);
+    particle_simulator.AddParticles(CountForPackingFraction(0.3, 10), 10, 10,
+                                    "red");
+    REQUIRE(HasOverlaps(particle_simulator.GetParticles()));
+  }
+}
+
+TEST_CASE("Placing too many particles throws an error", "[placement]") {
+  ParticleSimulator particle_simulator;
+  particle_simulator.SetPlacement(Placement::kNonOverlapping);
+  
+  SECTION("More than the densest packing") {
+    REQUIRE_THROWS_AS(particle_simulator.AddParticles(
+        CountForPackingFraction(0.95, 10), 10, 10, "red"), 
+                      std::invalid_argument);
+    REQUIRE(particle_simulator.GetParticles().empty());
+  }
+  
+  SECTION("Particles bigger than the container") {
+    REQUIRE_THROWS_AS(particle_simulator.AddParticles(1, 400, 10, "red"),
+                      std::invalid_argument);
+  }
+}
+
+TEST_CASE("Placement is reproducible", "[placement]") {
+  ParticleStore particles;
+  std::vector<float> x(500);
+  std::vector<float> y(500);
+  std::vector<float> same_x(500);
+  std::vector<float> same_y(500);
+  PlaceWithoutOverlaps(particles, 500, 5, CounterRng(3), 0, 5, kXLower, 
+                       kYLower, kXUpper, kYUpper, x.data(), y.data());
+  PlaceWithoutOverlaps(particles, 500, 5, CounterRng(3), 0, 5, kXLower, 
+                       kYLower, kXUpper, kYUpper, same_x.data(), 
+                       same_y.data());
+  REQUIRE(x == same_x);
+  REQUIRE(y == same_y);
+}
@@ -0,0 +1,135 @@
+#include <catch2/catch.hpp>
+#include <simulation_thread.h>
+#include <triple_buffer.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace idealgas;
+
+namespace {
+
+/**
+ * Waits for the simulation thread to publish a snapshot that passes a check,
+ * giving up after a few seconds
+ */
+template <typename Check>
+const SimulationSnapshot &WaitForSnapshot(SimulationThread &simulation_thread,
+                                          Check check) {
+  std::chrono::steady_clock::time_point give_up =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!check(simulation_thread.GetLatestSnapshot()) &&
+      std::chrono::steady_clock::now() < give_up) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return simulation_thread.GetLatestSnapshot();
+}
+
+} // namespace
+
+TEST_CASE("Triple buffer hands over the newest value", "[threads]") {
+  TripleBuffer<int> buffer;
+
+  SECTION("There is no new value before one is published") {
+    REQUIRE_FALSE(buffer.Update());
+  }
+
+  SECTION("Values published before a read are skipped for the newest") {
+    for (int value = 1; value <= 3; value++) {
+      buffer.GetWriteBuffer() = value;
+      buffer.Publish();
+    }
+    REQUIRE(buffer.Update());
+    REQUIRE(buffer.GetReadBuffer() == 3);
+
+    // The value stays until another one is published
+    REQUIRE_FALSE(buffer.Update());
+    REQUIRE(buffer.GetReadBuffer() == 3);
+  }
+
+  SECTION("The reader never sees a half written value") {
+    TripleBuffer<std::vector<int>> vectors;
+    const int kLastValue = 20000;
+    std::thread writer([&vectors, kLastValue]() {
+      for (int value = 1; value <= kLastValue; value++) {
+        std::vector<int> &values = vectors.GetWriteBuffer();
+        values.assign(64, value);
+        vectors.Publish();
+      }
+    });
+
+    bool torn = false;
+    bool backwards = false;
+    int last_value = 0;
+    while (last_value != kLastValue) {
+      if (!vectors.Update()) {
+        continue;
+      }
+      const std::vector<int> &values = vectors.GetReadBuffer();
+      for (int value : values) {
+        torn |= value != values.front();
+      }
+      backwards |= values.front() < last_value;
+      last_value = values.front();
+    }
+    writer.join();
+
+    REQUIRE_FALSE(torn);
+    REQUIRE_FALSE(backwards);
+  }
+}
+
+TEST_CASE("Simulation thread advances on its own and publishes snapshots",
+          "[threads]") {
+  ParticleSimulator particle_simulator;
+  particle_simulator.SetSeed(7);
+  particle_simulator.AddParticles(40, 10, 5, "red");
+  particle_simulator.AddParticles(20, 15, 25, "blue");
+  std::vector<Histogram> histograms = {Histogram(0, 5), Histogram(1, 25)};
+
+  // A fast clock, so the test sees plenty of steps quickly
+  SimulationThread simulation_thread(particle_simulator, histograms, 2000);
+  simulation_thread.Start();
+
+  SECTION("The first snapshot is the simulation it was given") {
+    const SimulationSnapshot &snapshot =
+        simulation_thread.GetLatestSnapshot();
+    REQUIRE(snapshot.particles.size() == 60);
+    REQUIRE(snapshot.histograms.size() == 2);
+  }
+
+  SECTION("The snapshot's histograms match its particles") {
+    const SimulationSnapshot &snapshot = WaitForSnapshot(
+        simulation_thread, [](const SimulationSnapshot &snapshot) {
+          return snapshot.steps >= 200;
+        });
+    REQUIRE(snapshot.steps >= 200);
+
+    std::vector<Histogram> filled = {Histogram(0, 5), Histogram(1, 25)};
+    Histogram::FillBins(snapshot.particles, filled);
+    for (size_t h = 0; h < filled.size(); h++) {
+      REQUIRE(snapshot.histograms[h].GetBins() == filled[h].GetBins());
+    }
+  }
+
+  SECTION("Posted commands run on the simulation") {
+    std::atomic<bool> ran(false);
+    simulation_thread.Post([&ran](ParticleSimulator &simulator) {
+      simulator.AddParticles(1, 10, 5, "red");
+      ran = true;
+    });
+    const SimulationSnapshot &snapshot = WaitForSnapshot(
+        simulation_thread, [](const SimulationSnapshot &snapshot) {
+          return snapshot.particles.size() == 61;
+        });
+    REQUIRE(ran);
+    REQUIRE(snapshot.particles.size() == 61);
+  }
+
+  SECTION("Stopping ends the thread and keeps the last snapshot") {
+    simulation_thread.Stop();
+    uint64_t steps = simulation_thread.GetLatestSnapshot().steps;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(simulation_thread.GetLatestSnapshot().steps == steps);
+  }
+}
@@ -0,0 +1,35 @@
+#include <catch2/catch.hpp>
+#include <thread_pool.h>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace idealgas;
+
+TEST_CASE("Thread pool runs every task once", "[threads]") {
+  ThreadPool thread_pool(4);
+  REQUIRE(thread_pool.GetThreadCount() == 4);
+  
+  std::vector<size_t> runs(1000);
+  thread_pool.ParallelFor(runs.size(), [&](size_t index) {
+    runs[index]++;
+  });
+  
+  REQUIRE(std::count(runs.begin(), runs.end(), 1) == 1000);
+  
+  SECTION("The pool can be reused for more jobs") {
+    for (size_t job = 0; job < 50; job++) {
+      thread_pool.ParallelFor(runs.size(), [&](size_t index) {
+        runs[index]++;
+      });
+    }
+    REQUIRE(std::count(runs.begin(), runs.end(), 51) == 1000);
+  }
+  
+  SECTION("An exception thrown by a task is rethrown to the caller") {
+    REQUIRE_THROWS_AS(thread_pool.ParallelFor(10, [](size_t index) {
+      if (index == 7) {
+        throw std::runtime_error("Task failed");
+      }
+    }), std::runtime_error);
+  }
+}
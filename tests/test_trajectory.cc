@@ -0,0 +1,183 @@
+#include <catch2/catch.hpp>
+#include <trajectory.h>
+#include <particle_simulator.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+using namespace idealgas;
+
+namespace {
+
+/**
+ * Checks that a frame read back is within half a resolution of the particles
+ */
+void RequireCloseFrame(const TrajectoryFrame &frame,
+                       const ParticleStore &particles,
+                       const TrajectoryReader &reader) {
+  REQUIRE(frame.x.size() == particles.size());
+  double position_tolerance = reader.GetPositionResolution() / 2 + 1e-3;
+  double velocity_tolerance = reader.GetVelocityResolution() / 2 + 1e-5;
+  bool close = true;
+  for (size_t i = 0; i < particles.size(); i++) {
+    close &= std::fabs(frame.x[i] - particles.GetX()[i]) <= position_tolerance;
+    close &= std::fabs(frame.y[i] - particles.GetY()[i]) <= position_tolerance;
+    close &= std::fabs(frame.x_velocity[i] - particles.GetXVelocity()[i]) <=
+        velocity_tolerance;
+    close &= std::fabs(frame.y_velocity[i] - particles.GetYVelocity()[i]) <=
+        velocity_tolerance;
+  }
+  REQUIRE(close);
+}
+
+} // namespace
+
+TEST_CASE("Trajectories read back what was written", "[trajectory]") {
+  const std::string path = "trajectory_test.bin";
+  ParticleSimulator particle_simulator;
+  particle_simulator.SetSeed(3);
+  particle_simulator.AddParticles(200, 6, 10, "red");
+
+  // Keeps a copy of every frame to compare with, including one after the
+  // particle count changes
+  std::vector<ParticleStore> frames;
+  TrajectoryOptions options;
+  options.keyframe_interval = 4;
+  {
+    TrajectoryWriter writer(path, 300, options);
+    for (size_t step = 1; step <= 10; step++) {
+      particle_simulator.Update();
+      if (step == 7) {
+        particle_simulator.AddParticles(100, 10, 40, "blue");
+      }
+      REQUIRE(writer.AddFrame(particle_simulator.GetParticles(), step));
+      frames.push_back(particle_simulator.GetParticles());
+    }
+    writer.Close();
+    REQUIRE(writer.GetWrittenFrameCount() == 10);
+    REQUIRE(writer.GetDroppedFrameCount() == 0);
+
+    // Slow particles change by a byte or two a step instead of four
+    REQUIRE(writer.GetWrittenBytes() < 10 * 300 * 4 * sizeof(float));
+  }
+
+  TrajectoryReader reader(path);
+  TrajectoryFrame frame;
+  for (size_t step = 1; step <= 10; step++) {
+    REQUIRE(reader.ReadFrame(&frame));
+    REQUIRE(frame.step == step);
+    RequireCloseFrame(frame, frames[step - 1], reader);
+  }
+  REQUIRE_FALSE(reader.ReadFrame(&frame));
+  std::remove(path.c_str());
+}
+
+TEST_CASE("Trajectory overflow policies", "[trajectory]") {
+  const std::string path = "trajectory_test.bin";
+  ParticleSimulator particle_simulator;
+  particle_simulator.SetSeed(4);
+  particle_simulator.AddParticles(20000, 2, 10, "red");
+  const size_t frame_count = 30;
+
+  TrajectoryOptions options;
+  options.buffer_frames = 1;
+
+  SECTION("Blocking keeps every frame") {
+    TrajectoryWriter writer(path, 20000, options);
+    for (size_t step = 0; step < frame_count; step++) {
+      REQUIRE(writer.AddFrame(particle_simulator.GetParticles(), step));
+    }
+    writer.Close();
+    REQUIRE(writer.GetWrittenFrameCount() == frame_count);
+    REQUIRE(writer.GetDroppedFrameCount() == 0);
+  }
+
+  SECTION("Dropping counts every frame it didn't write") {
+    options.overflow_policy = OverflowPolicy::kDrop;
+    TrajectoryWriter writer(path, 20000, options);
+    size_t kept = 0;
+    for (size_t step = 0; step < frame_count; step++) {
+      kept += writer.AddFrame(particle_simulator.GetParticles(), step);
+    }
+    writer.Close();
+    REQUIRE(writer.GetWrittenFrameCount() == kept);
+    REQUIRE(writer.GetDroppedFrameCount() == frame_count - kept);
+
+    // The frames that were kept are still whole and in order
+    TrajectoryReader reader(path);
+    TrajectoryFrame frame;
+    size_t read = 0;
+    uint64_t last_step = 0;
+    while (reader.ReadFrame(&frame)) {
+      REQUIRE((read == 0 || frame.step > last_step));
+      last_step = frame.step;
+      read++;
+    }
+    REQUIRE(read == kept);
+  }
+
+  std::remove(path.c_str());
+}
+
+TEST_CASE("Bad trajectories are refused", "[trajectory]") {
+  const std::string path = "trajectory_test.bin";
+  ParticleSimulator particle_simulator;
+  particle_simulator.AddParticles(50, 6, 10, "red");
+  {
+    TrajectoryWriter writer(path, 50);
+    writer.AddFrame(particle_simulator.GetParticles(), 0);
+    writer.AddFrame(particle_simulator.GetParticles(), 1);
+    writer.Close();
+
+    SECTION("Frames can't be added after closing") {
+      REQUIRE_THROWS_AS(writer.AddFrame(particle_simulator.GetParticles(), 2),
+                        std::invalid_argument);
+    }
+  }
+
+  std::string contents;
+  {
+    std::ifstream input(path, std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(input),
+                    std::istreambuf_iterator<char>());
+  }
+  TrajectoryFrame frame;
+
+  SECTION("A missing file can't be read") {
+    std::remove(path.c_str());
+    REQUIRE_THROWS_AS(TrajectoryReader(path), std::runtime_error);
+  }
+
+  SECTION("A file that isn't a trajectory is refused") {
+    std::ofstream(path, std::ios::binary) << "x,y\n1,2\n";
+    REQUIRE_THROWS_AS(TrajectoryReader(path), std::invalid_argument);
+  }
+
+  SECTION("A trajectory of another version is refused") {
+    contents[8]++;
+    std::ofstream(path, std::ios::binary) << contents;
+    REQUIRE_THROWS_AS(TrajectoryReader(path), std::invalid_argument);
+  }
+
+  SECTION("A file cut short is refused") {
+    std::ofstream(path, std::ios::binary) << contents.substr(
+        0, contents.size() - 4);
+    TrajectoryReader reader(path);
+    REQUIRE(reader.ReadFrame(&frame));
+    REQUIRE_THROWS_AS(reader.ReadFrame(&frame), std::invalid_argument);
+  }
+
+  SECTION("Bad options are refused") {
+    TrajectoryOptions options;
+    options.buffer_frames = 0;
+    REQUIRE_THROWS_AS(TrajectoryWriter(path, 50, options),
+                      std::invalid_argument);
+    options = TrajectoryOptions();
+    options.position_resolution = 0;
+    REQUIRE_THROWS_AS(TrajectoryWriter(path, 50, options),
+                      std::invalid_argument);
+  }
+
+  std::remove(path.c_str());
+}